@@ -3,20 +3,24 @@
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "app_background.h"
+#include "app_governor.h"
 #include "app_task_communication.h"
 #include "app_times.h"
 #include "global.h"
-#include "timer_ms.h"
 
 #include "button.h"
 #include "buzzer.h"
 #include "clearpath.h"
 #include "fan.h"
+#include "gcode.h"
 #include "hal_adc.h"
 #include "hal_system_speed.h"
+#include "hal_systick.h"
 #include "led_interpolator.h"
 #include "path_interpolator.h"
 #include "sensors.h"
+#include "sequence_clock.h"
+#include "sequence_replay.h"
 #include "shutter_release.h"
 #include "status.h"
 
@@ -24,20 +28,79 @@
 
 /* -------------------------------------------------------------------------- */
 
-PRIVATE timer_ms_t button_timer = 0;
-PRIVATE timer_ms_t buzzer_timer = 0;
-PRIVATE timer_ms_t fan_timer    = 0;
-PRIVATE timer_ms_t adc_timer    = 0;
+typedef struct
+{
+    void ( *run )( void );
+    bool     motion;         // strict priority, runs on every pass ahead of housekeeping
+    uint16_t period_ms;      // housekeeping release interval, 0 to be due on every pass
+    uint16_t deadline_ms;    // housekeeping: latest start after release
+                             // motion: longest gap between runs
+    uint32_t release_ms;     // housekeeping: when the job is next due
+                             // motion: when the job last ran
+    uint32_t overruns;       // deadlines missed
+} BackgroundJob_t;
+
+PRIVATE void background_button( void );
+PRIVATE void background_sensors( void );
+PRIVATE void background_servos( void );
+PRIVATE void background_governor( void );
+
+PRIVATE void
+background_run( BackgroundItem_t item );
+
+// Motion jobs run in table order
+PRIVATE BackgroundJob_t background_jobs[BACKGROUND_NUM] = {
+    [BACKGROUND_COMMS_RX]          = { .run = AppTaskCommunication_rx_tick, .deadline_ms = 2U },
+    [BACKGROUND_ADC]               = { .run = hal_adc_tick, .period_ms = 1U, .deadline_ms = 1U },
+    [BACKGROUND_BUTTON]            = { .run = background_button, .period_ms = BACKGROUND_RATE_BUTTON_MS, .deadline_ms = 10U },
+    [BACKGROUND_BUZZER]            = { .run = buzzer_process, .period_ms = BACKGROUND_RATE_BUZZER_MS, .deadline_ms = 5U },
+    [BACKGROUND_FAN]               = { .run = fan_process, .period_ms = FAN_EVALUATE_TIME, .deadline_ms = 100U },
+    [BACKGROUND_SENSORS]           = { .run = background_sensors, .period_ms = BACKGROUND_ADC_AVG_POLL_MS, .deadline_ms = 50U },
+    [BACKGROUND_SHUTTER]           = { .run = shutter_process, .period_ms = 1U, .deadline_ms = 1U },
+    [BACKGROUND_GOVERNOR]          = { .run = background_governor, .period_ms = GOVERNOR_EVALUATE_MS, .deadline_ms = 50U },
+    [BACKGROUND_TELEMETRY]         = { .run = config_telemetry_process, .period_ms = TELEMETRY_POLL_MS, .deadline_ms = 5U },
+    [BACKGROUND_GCODE]             = { .run = gcode_process, .period_ms = 1U, .deadline_ms = 10U },
+    [BACKGROUND_SEQUENCE_CLOCK]    = { .run = sequence_clock_process, .motion = true, .deadline_ms = BACKGROUND_MOTION_DEADLINE_MS },
+    [BACKGROUND_LED_INTERPOLATOR]  = { .run = led_interpolator_process, .motion = true, .deadline_ms = BACKGROUND_MOTION_DEADLINE_MS },
+    [BACKGROUND_PATH_INTERPOLATOR] = { .run = path_interpolator_process, .motion = true, .deadline_ms = BACKGROUND_MOTION_DEADLINE_MS },
+    [BACKGROUND_SERVO]             = { .run = background_servos, .motion = true, .deadline_ms = BACKGROUND_MOTION_DEADLINE_MS },
+};
+
+PRIVATE CycleStats_t background_cycles[BACKGROUND_NUM];
+
+// Housekeeping cycles allowed per pass once the motion jobs have run
+PRIVATE uint32_t housekeeping_budget;
+
+// Motion passes counted over the current window, and the rate they settle to
+PRIVATE uint32_t motion_window_start;
+PRIVATE uint32_t motion_window_passes;
+PRIVATE uint32_t motion_pass_rate;    // passes/second
 
 /* -------------------------------------------------------------------------- */
 
 PUBLIC void
 app_background_init( void )
 {
-    timer_ms_start( &button_timer, BACKGROUND_RATE_BUTTON_MS );
-    timer_ms_start( &buzzer_timer, BACKGROUND_RATE_BUZZER_MS );
-    timer_ms_start( &fan_timer, FAN_EVALUATE_TIME );
-    timer_ms_start( &adc_timer, BACKGROUND_ADC_AVG_POLL_MS );    //refresh ADC readings
+    uint32_t now = hal_systick_get_ms();
+
+    for( BackgroundItem_t item = BACKGROUND_COMMS_RX; item < BACKGROUND_NUM; item++ )
+    {
+        background_jobs[item].release_ms = now + background_jobs[item].period_ms;
+        background_jobs[item].overruns   = 0;
+        cycle_stats_clear( &background_cycles[item] );
+    }
+
+    app_governor_init();
+    housekeeping_budget = ( hal_system_speed_get_speed() / 1000000UL ) * BACKGROUND_HOUSEKEEPING_BUDGET_US;
+
+    // Only the deadline is guaranteed until a window has been measured
+    motion_window_start  = now;
+    motion_window_passes = 0;
+    motion_pass_rate     = 1000U / BACKGROUND_MOTION_DEADLINE_MS;
+
+    sequence_clock_init();
+    sequence_replay_init();
+    gcode_init();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -45,57 +108,180 @@ app_background_init( void )
 PUBLIC void
 app_background( void )
 {
-    //rate limit less important background processes
-    AppTaskCommunication_rx_tick();
-    hal_adc_tick();
+    uint32_t now = hal_systick_get_ms();
 
-    if( timer_ms_is_expired( &button_timer ) )
+    // Motion work runs every pass, and counts an overrun if it was starved
+    for( BackgroundItem_t item = BACKGROUND_COMMS_RX; item < BACKGROUND_NUM; item++ )
     {
-        // Need to turn the E-Stop light on to power the pullup for the E-STOP button
-        status_external_override( true );
-        button_process();
-        status_external_resume();
+        BackgroundJob_t *job = &background_jobs[item];
 
-        timer_ms_start( &button_timer, BACKGROUND_RATE_BUTTON_MS );
-    }
+        if( job->motion )
+        {
+            if( now - job->release_ms > job->deadline_ms )
+            {
+                job->overruns++;
+            }
+            job->release_ms = now;
 
-    if( timer_ms_is_expired( &buzzer_timer ) )
-    {
-        buzzer_process();
-        timer_ms_start( &buzzer_timer, BACKGROUND_RATE_BUZZER_MS );
+            background_run( item );
+        }
     }
 
-    if( timer_ms_is_expired( &fan_timer ) )
+    motion_window_passes++;
+
+    if( now - motion_window_start >= BACKGROUND_MOTION_RATE_WINDOW_MS )
     {
-        fan_process();
-        timer_ms_start( &fan_timer, FAN_EVALUATE_TIME );
+        uint32_t measured = ( motion_window_passes * 1000U ) / ( now - motion_window_start );
+
+        // Follow a slowdown at once but a speedup gradually, so a quiet spell
+        // doesn't promise more passes than a busy one delivers
+        if( measured < motion_pass_rate )
+        {
+            motion_pass_rate = measured;
+        }
+        else
+        {
+            motion_pass_rate += ( measured - motion_pass_rate ) / 8U;
+        }
+
+        motion_window_start  = now;
+        motion_window_passes = 0;
     }
 
-    if( timer_ms_is_expired( &adc_timer ) )
+    // Then due housekeeping jobs, earliest deadline first, until the budget
+    // for this pass is spent. At least one runs so nothing starves.
+    uint32_t started = CYCLE_COUNT();
+
+    do
     {
-        sensors_12v_regulator_C();
-        sensors_ambient_C();
-        sensors_expansion_C();
-        sensors_microcontroller_C();
-        sensors_input_V();
+        BackgroundJob_t *job  = NULL;
+        BackgroundItem_t next = BACKGROUND_NUM;
 
-        config_set_cpu_load( hal_system_speed_get_load() );
-        config_set_cpu_clock( hal_system_speed_get_speed() );    // todo only update this value if it changes
-        config_update_task_statistics();
+        for( BackgroundItem_t item = BACKGROUND_COMMS_RX; item < BACKGROUND_NUM; item++ )
+        {
+            BackgroundJob_t *candidate = &background_jobs[item];
 
-        timer_ms_start( &adc_timer, BACKGROUND_ADC_AVG_POLL_MS );
-    }
+            if( candidate->motion || (int32_t)( now - candidate->release_ms ) < 0 )
+            {
+                continue;
+            }
+
+            if( job == NULL
+                || (int32_t)( ( candidate->release_ms + candidate->deadline_ms )
+                              - ( job->release_ms + job->deadline_ms ) ) < 0 )
+            {
+                job  = candidate;
+                next = item;
+            }
+        }
+
+        if( job == NULL )
+        {
+            break;
+        }
 
-    shutter_process();
-    led_interpolator_process();
+        if( (int32_t)( now - ( job->release_ms + job->deadline_ms ) ) > 0 )
+        {
+            job->overruns++;
+        }
 
-    //process any running movements and allow servo drivers to process commands
-    path_interpolator_process();
+        // Late jobs skip the releases they missed rather than catching up
+        job->release_ms += job->period_ms ? job->period_ms : 1U;
+        if( (int32_t)( now - job->release_ms ) >= 0 )
+        {
+            job->release_ms = now + ( job->period_ms ? job->period_ms : 1U );
+        }
 
+        background_run( next );
+
+    } while( CYCLE_COUNT() - started < housekeeping_budget );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_background_cycles_report( BackgroundItem_t item, CycleReport_t *report )
+{
+    cycle_stats_take( &background_cycles[item], report );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+app_background_overruns( BackgroundItem_t item )
+{
+    return background_jobs[item].overruns;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+app_background_motion_pass_rate( void )
+{
+    return motion_pass_rate;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE void
+background_run( BackgroundItem_t item )
+{
+    uint32_t started = CYCLE_COUNT();
+
+    background_jobs[item].run();
+    cycle_stats_add( &background_cycles[item], started );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+background_button( void )
+{
+    // Need to turn the E-Stop light on to power the pullup for the E-STOP button
+    status_external_override( true );
+    button_process();
+    status_external_resume();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+background_sensors( void )
+{
+    sensors_12v_regulator_C();
+    sensors_ambient_C();
+    sensors_expansion_C();
+    sensors_microcontroller_C();
+    sensors_input_V();
+
+    uint32_t clock = hal_system_speed_get_speed();
+
+    config_set_cpu_load( hal_system_speed_get_load() );
+    config_set_cpu_clock( clock );    // todo only update this value if it changes
+    config_update_task_statistics();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+background_servos( void )
+{
+    //allow servo drivers to process commands
     for( ClearpathServoInstance_t servo = _CLEARPATH_1; servo < _NUMBER_CLEARPATH_SERVOS; servo++ )
     {
         servo_process( servo );
     }
 }
 
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+background_governor( void )
+{
+    app_governor_process();
+
+    // The budget is in cycles, keep it the same length of time at either speed
+    housekeeping_budget = ( hal_system_speed_get_speed() / 1000000UL ) * BACKGROUND_HOUSEKEEPING_BUDGET_US;
+}
+
 /* ----- End ---------------------------------------------------------------- */
@@ -10,9 +10,30 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "global.h"
+#include "cycle_stats.h"
 
 /* ----- Defines ------------------------------------------------------------ */
 
+// Items polled from the main loop, for cycle accounting
+typedef enum
+{
+    BACKGROUND_COMMS_RX = 0,
+    BACKGROUND_ADC,
+    BACKGROUND_BUTTON,
+    BACKGROUND_BUZZER,
+    BACKGROUND_FAN,
+    BACKGROUND_SENSORS,
+    BACKGROUND_SHUTTER,
+    BACKGROUND_GOVERNOR,
+    BACKGROUND_TELEMETRY,
+    BACKGROUND_GCODE,
+    BACKGROUND_SEQUENCE_CLOCK,
+    BACKGROUND_LED_INTERPOLATOR,
+    BACKGROUND_PATH_INTERPOLATOR,
+    BACKGROUND_SERVO,
+    BACKGROUND_NUM,
+} BackgroundItem_t;
+
 /* ----- Public Functions --------------------------------------------------- */
 
 /** Startup initialisation for background processes in the main loop */
@@ -22,11 +43,37 @@ app_background_init( void );
 
 /* -------------------------------------------------------------------------- */
 
-/** Background processes that are handled in the main loop */
+/** Background processes that are handled in the main loop. Motion jobs run
+ *  on every call, due housekeeping jobs are then run earliest deadline first
+ *  within a fixed cycle budget.
+ */
 
 PUBLIC void
 app_background( void );
 
+/* -------------------------------------------------------------------------- */
+
+/** Summarise the cycles a background item used since the last call */
+
+PUBLIC void
+app_background_cycles_report( BackgroundItem_t item, CycleReport_t *report );
+
+/* -------------------------------------------------------------------------- */
+
+/** Number of times the item missed its deadline since boot */
+
+PUBLIC uint32_t
+app_background_overruns( BackgroundItem_t item );
+
+/* -------------------------------------------------------------------------- */
+
+/** Motion passes per second, measured over recent windows. Drops at once
+ *  when passes slow down and recovers gradually.
+ */
+
+PUBLIC uint32_t
+app_background_motion_pass_rate( void );
+
 /* ----- End ------------------------------~--------------------------------- */
 
 #ifdef __cplusplus
@@ -24,15 +24,19 @@ extern "C" {
 /* -------------------------------------------------------------------------- */
 
 #ifdef STM32F429xx
-//! Application uses 1ms timer ticks on the ARM platform with SysTick
-#define MS_PER_TICK 1U
+//! Application uses 1ms timer ticks on the ARM platform with SysTick.
+/// Backing the event timers with a faster timebase only needs this changed.
+#define US_PER_TICK 1000UL
 #else
 //! Application uses 10ms timer ticks on the PC
-#define MS_PER_TICK 10UL
+#define US_PER_TICK 10000UL
 #endif
 
 // Convert a ms time into timer ticks. Ensure that we round up when needed.
-#define MS_TO_TICKS( _ms_ ) ( ( ( _ms_ ) + ( MS_PER_TICK - 1 ) ) / MS_PER_TICK )
+#define MS_TO_TICKS( _ms_ ) ( ( ( _ms_ ) * 1000UL + ( US_PER_TICK - 1 ) ) / US_PER_TICK )
+
+// Convert a us time into timer ticks, rounding up to at least one tick.
+#define US_TO_TICKS( _us_ ) ( ( ( _us_ ) + ( US_PER_TICK - 1 ) ) / US_PER_TICK )
 
 /* ----- End ---------------------------------------------------------------- */
 
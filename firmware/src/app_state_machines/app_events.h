@@ -100,6 +100,27 @@ typedef struct BarrierSyncEvent__
 
 /* -------------------------------------------------------------------------- */
 
+/** Feed hold/resume request **/
+typedef struct FeedHoldEvent__
+{
+    StateEvent super;      // Encapsulated event reference
+    uint16_t   ramp_ms;    // time to stop or get back up to speed
+} FeedHoldEvent;
+
+/* -------------------------------------------------------------------------- */
+
+/** Replay of retained moves/animations **/
+typedef struct ReplayEvent__
+{
+    StateEvent super;       // Encapsulated event reference
+    uint16_t   first_id;    // first movement ID of the range
+    uint16_t   last_id;     // last movement ID of the range
+    float      scale;       // playback rate for the replay, 0 leaves it unchanged
+    uint8_t    repeats;     // number of passes through the range
+} ReplayEvent;
+
+/* -------------------------------------------------------------------------- */
+
 typedef struct CameraShutterEvent__
 {
     StateEvent super;    // Encapsulated event reference
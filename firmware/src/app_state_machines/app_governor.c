@@ -0,0 +1,146 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "app_governor.h"
+#include "app_task_ids.h"
+#include "app_tasks.h"
+#include "app_times.h"
+
+#include "clearpath.h"
+#include "configuration.h"
+#include "event_queue.h"
+#include "hal_system_speed.h"
+#include "hal_systick.h"
+#include "led_interpolator.h"
+#include "path_interpolator.h"
+#include "sequence_replay.h"
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE uint32_t         idle_since_ms;    // last time there was work to do
+PRIVATE uint32_t         low_since_ms;
+PRIVATE GovernorStatus_t governor;
+
+PRIVATE bool
+app_governor_work_pending( void );
+
+PRIVATE void
+app_governor_set_low( bool low );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_governor_init( void )
+{
+    governor.switches = 0;
+    governor.low_ms   = 0;
+    governor.low      = false;
+
+    hal_system_speed_high();
+    idle_since_ms = hal_systick_get_ms();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_governor_process( void )
+{
+    uint32_t now = hal_systick_get_ms();
+
+    if( !config_get_governor_enabled() || app_governor_work_pending() )
+    {
+        idle_since_ms = now;
+        app_governor_set_low( false );
+    }
+    else if( now - idle_since_ms >= GOVERNOR_IDLE_MS )
+    {
+        app_governor_set_low( true );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_governor_boost( void )
+{
+    idle_since_ms = hal_systick_get_ms();
+    app_governor_set_low( false );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_governor_status( GovernorStatus_t *status )
+{
+    *status = governor;
+
+    if( governor.low )
+    {
+        status->low_ms += hal_systick_get_ms() - low_since_ms;
+    }
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE bool
+app_governor_work_pending( void )
+{
+    StateTask *motion   = app_task_by_id( TASK_MOTION );
+    StateTask *lighting = app_task_by_id( TASK_LIGHTING );
+
+    if( !path_interpolator_is_empty() || !led_interpolator_is_empty() )
+    {
+        return true;
+    }
+
+    if( sequence_replay_moves_pending() || sequence_replay_fades_pending() )
+    {
+        return true;
+    }
+
+    if( eventQueueUsed( &motion->requestQueue ) || eventQueueUsed( &lighting->requestQueue ) )
+    {
+        return true;
+    }
+
+    // Servos still stepping towards their target
+    for( ClearpathServoInstance_t servo = _CLEARPATH_1; servo < _NUMBER_CLEARPATH_SERVOS; servo++ )
+    {
+        if( !servo_get_move_done( servo ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+app_governor_set_low( bool low )
+{
+    if( low == governor.low )
+    {
+        return;
+    }
+
+    uint32_t now = hal_systick_get_ms();
+
+    if( low )
+    {
+        hal_system_speed_low();
+        low_since_ms = now;
+    }
+    else
+    {
+        hal_system_speed_high();
+        governor.low_ms += now - low_since_ms;
+    }
+
+    governor.low = low;
+    governor.switches++;
+}
+
+/* ----- End ---------------------------------------------------------------- */
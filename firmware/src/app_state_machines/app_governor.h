@@ -0,0 +1,61 @@
+#ifndef APP_GOVERNOR_H
+#define APP_GOVERNOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t switches;    // speed changes since boot
+    uint32_t low_ms;      // time spent at the low clock since boot
+    uint8_t  low;         // running at the low clock now
+} GovernorStatus_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Start at full speed */
+
+PUBLIC void
+app_governor_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Drop the core clock once motion and lighting have been idle for a while,
+ *  polled from the background loop.
+ */
+
+PUBLIC void
+app_governor_process( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Return to full speed straight away and restart the idle timer. Called as
+ *  work is queued, so the clock is already up when the sequence starts.
+ */
+
+PUBLIC void
+app_governor_boost( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_governor_status( GovernorStatus_t *status );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* APP_GOVERNOR_H */
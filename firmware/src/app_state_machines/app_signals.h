@@ -55,9 +55,11 @@ enum AppSignals
     MOTION_QUEUE_START_SYNC,
     MOTION_QUEUE_ADD,      // Provide movement information for queue processing
     MOTION_QUEUE_CLEAR,    // empty out pending movements
+    MOTION_QUEUE_HOLD,      // decelerate to a stop along the path, keeping the queue. Should contain a FeedHoldEvent
+    MOTION_QUEUE_RESUME,    // accelerate back into the held sequence. Should contain a FeedHoldEvent
+    MOTION_QUEUE_REPLAY,    // run a range of retained moves. Should contain a ReplayEvent
 
-    PATHING_STARTED,     // started executing a move
-    PATHING_COMPLETE,    // finished moving along a provided profile path
+    PATHING_PROGRESS,    // one or more moves started/finished, read the ID's with a PathingCursor_t
 
     ANIMATION_COMPLETE,    // finished drawing out the led animated colour ramp
 
@@ -67,6 +69,7 @@ enum AppSignals
     LED_QUEUE_START_SYNC,
     LED_QUEUE_ADD,      // Provide led animation object to queue
     LED_CLEAR_QUEUE,    // empty pending animations
+    LED_QUEUE_REPLAY,    // run the retained animations for a range of ID's. Should contain a ReplayEvent
 
     LED_ALLOW_MANUAL_CONTROL,
     LED_RESTRICT_MANUAL_CONTROL,
@@ -76,6 +79,7 @@ enum AppSignals
     START_QUEUE_SYNC,    // Provide a start signal to tasks which follow the id indexed queues. Should contain a BarrierSyncEvent
     QUEUE_SYNC_MOTION_NEXT,
     QUEUE_SYNC_LED_NEXT,
+    SEQUENCE_REPLAY,    // Replay a range of retained moves and animations. Should contain a ReplayEvent
 
     CAMERA_CAPTURE,
 
@@ -8,13 +8,66 @@
 #include "app_events.h"
 #include "app_signals.h"
 #include "app_times.h"
+#include "qassert.h"
 
 #include "app_task_communication.h"
+#include "clearpath.h"
 #include "configuration.h"
+#include "hal_system_speed.h"
 #include "hal_uart.h"
+#include "hal_usb.h"
 
 #include "electricui.h"
 
+DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Longest frame split off the inbound stream, and the transmit block size.
+// eUI splits large variables across packets so its frames are well short of it.
+#define COMMS_FRAME_MAX 256U
+
+// Power of two
+#define COMMS_RX_DEFERRED_SIZE 512U
+#define COMMS_TX_QUEUE_SIZE    512U
+
+// Queued traffic is only handed to the transport while less than this waits
+// ahead of the block being sent, which bounds how long a command reply sits behind it
+#define COMMS_TX_AHEAD_MAX 64U
+
+// Channels below control queue up, control goes straight out
+#define COMMS_TX_QUEUES ( COMMS_CHANNEL_NUM - 1U )
+
+// eUI frames are COBS encoded and separated by zeros
+#define COMMS_FRAME_DELIMITER 0x00U
+
+// eUI packet header once the COBS framing is undone
+#define EUI_HEADER_SIZE        3U
+#define EUI_HEADER_INTERNAL    0x40U    // in the second byte, library traffic like heartbeats
+#define EUI_HEADER_ID_LEN_MASK 0x0FU    // in the third byte
+#define EUI_ID_MAX             15U
+
+typedef struct
+{
+    bool ready;
+
+    // Inbound frame being split off the byte stream
+    uint8_t  frame[COMMS_FRAME_MAX];
+    uint16_t frame_length;
+    bool     frame_oversize;    // longer than any eUI packet, dropped at the next delimiter
+
+    // Complete frames waiting behind the commands, with their delimiters
+    fifo_t   rx_deferred;
+    uint8_t  rx_deferred_buffer[COMMS_RX_DEFERRED_SIZE];
+    uint32_t rx_scan_started;     // cycle count at the start of this poll
+    uint32_t rx_scan_previous;    // and the previous one
+
+    // Outbound frames for the channels below control, each after its length
+    fifo_t   tx_queue[COMMS_TX_QUEUES];
+    uint8_t  tx_buffer[COMMS_TX_QUEUES][COMMS_TX_QUEUE_SIZE];
+    uint16_t tx_next[COMMS_TX_QUEUES];    // length of the frame at the front, its prefix already read
+} CommsLink_t;
+
 /* ----- Private Function Definitions --------------------------------------- */
 
 PRIVATE void AppTaskCommunicationConstructor( AppTaskCommunication *me );
@@ -31,7 +84,39 @@ PRIVATE void AppTaskCommunication_tx_put_usb( uint8_t *c, uint16_t length );
 
 PRIVATE void AppTaskCommunication_rx_callback_uart( HalUartPort_t port, uint8_t c );
 
-PRIVATE void AppTaskCommunication_rx_callback_cdc( uint8_t c );
+PRIVATE void AppTaskCommunication_rx_drain( uint8_t link );
+
+PRIVATE void AppTaskCommunication_link_init( uint8_t link );
+
+PRIVATE void AppTaskCommunication_stop_hook( void );
+
+PRIVATE void AppTaskCommunication_reliable_service( void );
+
+PRIVATE void AppTaskCommunication_reliable_ack( ReliableChannel_t channel );
+
+PRIVATE CommsChannel_t AppTaskCommunication_classify( const uint8_t *frame, uint32_t length );
+
+PRIVATE uint32_t AppTaskCommunication_rx_split( CommsLink_t *me, uint8_t link, const uint8_t *data, uint32_t length );
+
+PRIVATE bool AppTaskCommunication_rx_frame( CommsLink_t *me, uint8_t link );
+
+PRIVATE void AppTaskCommunication_rx_deferred( CommsLink_t *me, uint8_t link );
+
+PRIVATE void AppTaskCommunication_tx_frame( uint8_t link, const uint8_t *c, uint16_t length );
+
+PRIVATE void AppTaskCommunication_tx_pump( uint8_t link );
+
+PRIVATE uint32_t AppTaskCommunication_link_rx_span( uint8_t link, const uint8_t **data );
+
+PRIVATE void AppTaskCommunication_link_rx_consume( uint8_t link, uint32_t length );
+
+PRIVATE uint32_t AppTaskCommunication_link_tx_pending( uint8_t link );
+
+PRIVATE uint32_t AppTaskCommunication_link_tx_write( uint8_t link, const uint8_t *c, uint32_t length );
+
+PRIVATE uint8_t *AppTaskCommunication_link_tx_reserve( uint8_t link, uint32_t length );
+
+PRIVATE void AppTaskCommunication_link_tx_commit( uint8_t link, uint32_t length );
 
 PRIVATE STATE AppTaskCommunication_main( AppTaskCommunication *me, const StateEvent *e );
 
@@ -60,6 +145,52 @@ eui_interface_t communication_interface[] = {
     EUI_INTERFACE_CB( &AppTaskCommunication_tx_put_usb, &AppTaskCommunication_eui_callback_usb ),
 };
 
+// The UART each link other than USB runs over
+PRIVATE const HalUartPort_t link_port[LINK_USB] = {
+    [LINK_MODULE]   = HAL_UART_PORT_MODULE,
+    [LINK_INTERNAL] = HAL_UART_PORT_INTERNAL,
+    [LINK_EXTERNAL] = HAL_UART_PORT_EXTERNAL,
+};
+
+PRIVATE CommsLink_t comms_link[COMMS_LINK_NUM];
+
+PRIVATE CommsLatency_t   comms_stats;
+PRIVATE CommsLinkStats_t comms_link_stats[COMMS_LINK_NUM];
+
+// Set by the stop frame hook, the rest of the system hears about it from the superloop
+PRIVATE volatile bool comms_stop_pending;
+
+// Segments in [delivered, next) have all arrived and wait for room in their
+// queue, ones from next up to delivered + RELIABLE_WINDOW arrived out of order
+typedef struct
+{
+    bool     started;
+    bool     ack_due;
+    uint8_t  link;         // acknowledgements go back the way the segments came
+    uint16_t delivered;    // next sequence to hand on
+    uint16_t next;         // first sequence not yet arrived
+    uint16_t held;         // bit per window slot with a segment in it
+    uint8_t  payload[RELIABLE_WINDOW][RELIABLE_PAYLOAD_MAX];
+} ReliableStream_t;
+
+// Queue events handed on per stream per poll, keeps the supervisor queue clear
+#define RELIABLE_DELIVER_MAX 4U
+
+#define RELIABLE_SLOT( sequence_ ) ( 1U << ( ( sequence_ ) & ( RELIABLE_WINDOW - 1U ) ) )
+
+PRIVATE ReliableStream_t reliable_stream[RELIABLE_CHANNEL_NUM];
+PRIVATE ReliableStats_t  reliable_stats;
+
+// Commands that mustn't wait behind an upload. Only ones that don't depend on
+// the uploads ahead of them, starting or clearing the queue stays in order.
+PRIVATE const char *const control_ids[] = {
+    "estop", "arm", "disarm", "home", "req_mode", "hold", "resume", "super", "rack",
+};
+
+PRIVATE const char *const telemetry_ids[] = {
+    "telem", "cpos", "queue", "moStat", "servo", "rgb", "sys",
+};
+
 /* ----- Public Functions --------------------------------------------------- */
 
 PUBLIC StateTask *
@@ -110,7 +241,7 @@ PRIVATE STATE AppTaskCommunication_main( AppTaskCommunication *me,
     switch( e->signal )
     {
         case STATE_ENTRY_SIGNAL: {
-
+            hal_uart_stop_hook( &AppTaskCommunication_stop_hook );
             return 0;
         }
 
@@ -133,32 +264,50 @@ PRIVATE STATE AppTaskCommunication_electric_ui( AppTaskCommunication *me,
             switch( me->instance )
             {
                 case INTERFACE_UART_MODULE:
+                    AppTaskCommunication_link_init( LINK_MODULE );
                     hal_uart_init( HAL_UART_PORT_MODULE );
                     break;
 
                 case INTERFACE_UART_INTERNAL:
+                    AppTaskCommunication_link_init( LINK_INTERNAL );
                     hal_uart_init( HAL_UART_PORT_INTERNAL );
                     break;
 
                 case INTERFACE_UART_EXTERNAL:
+                    AppTaskCommunication_link_init( LINK_EXTERNAL );
                     hal_uart_init( HAL_UART_PORT_EXTERNAL );
                     break;
 
                 case INTERFACE_USB_EXTERNAL:
-                    //todo init cdc here
-                    //todo setup callback to AppTaskCommunication_rx_callback_cdc
-
+                    // Just the USB link below
                     break;
             }
 
+            // The USB port comes up alongside whichever UART this task serves,
+            // a host can use either
+            AppTaskCommunication_link_init( LINK_USB );
+
+            if( hal_usb_init() )
+            {
+                eventTimerStartOnce( &me->timer1,
+                                     (StateTask *)me,
+                                     (StateEvent *)&stateEventReserved[STATE_TIMEOUT1_SIGNAL],
+                                     MS_TO_TICKS( HAL_USB_MODE_SETTLE_MS ) );
+            }
+
             //eUI setup
             EUI_LINK( communication_interface );
             configuration_electric_setup();    //get the configuration driver to setup access to variables
 
             return 0;
 
-        case STATE_EXIT_SIGNAL:
+        case STATE_TIMEOUT1_SIGNAL:
+            // The core has settled into device mode
+            hal_usb_start();
+            return 0;
 
+        case STATE_EXIT_SIGNAL:
+            eventTimerStopIfActive( &me->timer1 );
             return 0;
     }
     return (STATE)AppTaskCommunication_main;
@@ -169,24 +318,25 @@ PRIVATE STATE AppTaskCommunication_electric_ui( AppTaskCommunication *me,
 PRIVATE void
 AppTaskCommunication_tx_put_external( uint8_t *c, uint16_t length )
 {
-    hal_uart_write( HAL_UART_PORT_EXTERNAL, c, length );
+    AppTaskCommunication_tx_frame( LINK_EXTERNAL, c, length );
 }
 
 PRIVATE void
 AppTaskCommunication_tx_put_internal( uint8_t *c, uint16_t length )
 {
-    hal_uart_write( HAL_UART_PORT_INTERNAL, c, length );
+    AppTaskCommunication_tx_frame( LINK_INTERNAL, c, length );
 }
 
 PRIVATE void
 AppTaskCommunication_tx_put_module( uint8_t *c, uint16_t length )
 {
-    hal_uart_write( HAL_UART_PORT_MODULE, c, length );
+    AppTaskCommunication_tx_frame( LINK_MODULE, c, length );
 }
 
 PRIVATE void
 AppTaskCommunication_tx_put_usb( uint8_t *c, uint16_t length )
 {
+    AppTaskCommunication_tx_frame( LINK_USB, c, length );
 }
 
 /* -------------------------------------------------------------------------- */
@@ -213,21 +363,589 @@ AppTaskCommunication_rx_callback_uart( HalUartPort_t port, uint8_t c )
     }
 }
 
-PRIVATE void
-AppTaskCommunication_rx_callback_cdc( uint8_t c )
+PUBLIC void
+AppTaskCommunication_parse_block( uint8_t link, const uint8_t *data, uint32_t length )
 {
-    eui_parse( c, &communication_interface[LINK_USB] );
+    eui_interface_t *interface = &communication_interface[link];
+
+    for( uint32_t i = 0; i < length; i++ )
+    {
+        eui_parse( data[i], interface );
+    }
 }
 
 PUBLIC void
 AppTaskCommunication_rx_tick( void )
 {
-    while( hal_uart_rx_data_available( HAL_UART_PORT_MODULE ) )
+    if( comms_stop_pending )
+    {
+        // The servos are already off, bring the state machines into line
+        comms_stop_pending = false;
+        eventPublish( EVENT_NEW( StateEvent, MOTION_EMERGENCY ) );
+    }
+
+    for( uint8_t link = LINK_MODULE; link < COMMS_LINK_NUM; link++ )
+    {
+        AppTaskCommunication_rx_drain( link );
+    }
+
+    // Move queued replies and telemetry along as the transports drain
+    for( uint8_t link = LINK_MODULE; link < COMMS_LINK_NUM; link++ )
+    {
+        AppTaskCommunication_tx_pump( link );
+    }
+
+    AppTaskCommunication_reliable_service();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+AppTaskCommunication_latency( CommsLatency_t *report )
+{
+    *report = comms_stats;
+}
+
+PUBLIC void
+AppTaskCommunication_latency_clear( void )
+{
+    memset( &comms_stats, 0, sizeof( comms_stats ) );
+    memset( comms_link_stats, 0, sizeof( comms_link_stats ) );
+}
+
+PUBLIC void
+AppTaskCommunication_link_stats( CommsLinkStats_t report[] )
+{
+    memcpy( report, comms_link_stats, sizeof( comms_link_stats ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+AppTaskCommunication_reliable_receive( uint8_t link, const ReliableSegment_t *segment )
+{
+    if( segment->channel >= RELIABLE_CHANNEL_NUM )
+    {
+        return;
+    }
+
+    ReliableStream_t *me    = &reliable_stream[segment->channel];
+    int16_t           ahead = (int16_t)( segment->sequence - me->next );
+
+    // A retransmitted start from the current session is just a duplicate
+    if( ( segment->flags & RELIABLE_FLAG_START )
+        && ( !me->started || ahead >= 0 || ahead < -(int16_t)RELIABLE_WINDOW ) )
+    {
+        // Anything still held went with the queues the host cleared
+        me->started   = true;
+        me->delivered = segment->sequence;
+        me->next      = segment->sequence;
+        me->held      = 0;
+        ahead         = 0;
+    }
+
+    if( !me->started )
+    {
+        return;
+    }
+
+    // Acknowledge even duplicates, the previous acknowledgement may have been lost
+    me->link    = link;
+    me->ack_due = true;
+
+    if( ahead < 0 || ( me->held & RELIABLE_SLOT( segment->sequence ) ) )
+    {
+        reliable_stats.duplicates++;
+        return;
+    }
+
+    if( (uint16_t)( segment->sequence - me->delivered ) >= RELIABLE_WINDOW )
+    {
+        reliable_stats.out_of_window++;
+        return;
+    }
+
+    memcpy( me->payload[segment->sequence & ( RELIABLE_WINDOW - 1U )], segment->payload, RELIABLE_PAYLOAD_MAX );
+    me->held |= RELIABLE_SLOT( segment->sequence );
+    reliable_stats.segments++;
+
+    while( (uint16_t)( me->next - me->delivered ) < RELIABLE_WINDOW && ( me->held & RELIABLE_SLOT( me->next ) ) )
+    {
+        me->next++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+AppTaskCommunication_reliable_stats( ReliableStats_t *stats )
+{
+    *stats = reliable_stats;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Hand arrived segments on in order, stopping when a queue is full so the
+// window closes and the host holds off, then acknowledge what changed
+
+PRIVATE void
+AppTaskCommunication_reliable_service( void )
+{
+    for( ReliableChannel_t channel = 0; channel < RELIABLE_CHANNEL_NUM; channel++ )
     {
-        eui_parse( hal_uart_rx_get( HAL_UART_PORT_MODULE ), &communication_interface[LINK_MODULE] );
+        ReliableStream_t *me = &reliable_stream[channel];
+
+        for( uint8_t handed = 0; handed < RELIABLE_DELIVER_MAX && me->delivered != me->next; handed++ )
+        {
+            uint8_t slot = me->delivered & ( RELIABLE_WINDOW - 1U );
+
+            if( !config_reliable_deliver( channel, me->payload[slot] ) )
+            {
+                break;
+            }
+
+            me->held &= ~RELIABLE_SLOT( me->delivered );
+            me->delivered++;
+            me->ack_due = true;
+            reliable_stats.delivered++;
+        }
+
+        if( me->ack_due )
+        {
+            AppTaskCommunication_reliable_ack( channel );
+            me->ack_due = false;
+        }
     }
 }
 
+PRIVATE void
+AppTaskCommunication_reliable_ack( ReliableChannel_t channel )
+{
+    ReliableStream_t *me  = &reliable_stream[channel];
+    ReliableAck_t     ack = { .next      = me->next,
+                          .selective = 0,
+                          .channel   = channel,
+                          .window    = RELIABLE_WINDOW - (uint16_t)( me->next - me->delivered ) };
+
+    for( uint8_t n = 0; n + 1U < RELIABLE_WINDOW; n++ )
+    {
+        uint16_t sequence = me->next + 1U + n;
+
+        if( (uint16_t)( sequence - me->delivered ) < RELIABLE_WINDOW && ( me->held & RELIABLE_SLOT( sequence ) ) )
+        {
+            ack.selective |= (uint16_t)( 1U << n );
+        }
+    }
+
+    eui_message_t ack_message = { .id   = "rack",
+                                  .type = TYPE_CUSTOM,
+                                  .size = sizeof( ack ),
+                                  { .data = &ack } };
+
+    eui_send_untracked_on( &ack_message, &communication_interface[me->link] );
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Runs in the UART receive interrupt, ahead of the FIFO and the parser
+
+PRIVATE void
+AppTaskCommunication_stop_hook( void )
+{
+    servo_emergency_stop();
+    comms_stop_pending = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+AppTaskCommunication_link_init( uint8_t link )
+{
+    CommsLink_t *me = &comms_link[link];
+
+    memset( me, 0, sizeof( CommsLink_t ) );
+    fifo_init( &me->rx_deferred, me->rx_deferred_buffer, COMMS_RX_DEFERRED_SIZE );
+
+    for( uint8_t queue = 0; queue < COMMS_TX_QUEUES; queue++ )
+    {
+        fifo_init( &me->tx_queue[queue], me->tx_buffer[queue], COMMS_TX_QUEUE_SIZE );
+    }
+
+    me->rx_scan_previous = CYCLE_COUNT();
+    me->ready            = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+AppTaskCommunication_id_in( const char *id, uint8_t length, const char *const table[], uint8_t entries )
+{
+    for( uint8_t i = 0; i < entries; i++ )
+    {
+        if( strlen( table[i] ) == length && memcmp( table[i], id, length ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Undo the COBS framing for just the header and message ID
+PRIVATE CommsChannel_t
+AppTaskCommunication_classify( const uint8_t *frame, uint32_t length )
+{
+    uint8_t  header[EUI_HEADER_SIZE + EUI_ID_MAX];
+    uint8_t  decoded = 0;
+    uint32_t i       = 0;
+
+    while( i < length && frame[i] == COMMS_FRAME_DELIMITER )
+    {
+        i++;
+    }
+
+    while( i < length && decoded < sizeof( header ) )
+    {
+        uint8_t code = frame[i++];
+
+        for( uint8_t k = 1; k < code && i < length && decoded < sizeof( header ); k++ )
+        {
+            header[decoded++] = frame[i++];
+        }
+
+        if( code < 0xFFU && decoded < sizeof( header ) )
+        {
+            header[decoded++] = 0;
+        }
+    }
+
+    if( decoded < EUI_HEADER_SIZE )
+    {
+        return COMMS_CHANNEL_BULK;
+    }
+
+    if( header[1] & EUI_HEADER_INTERNAL )
+    {
+        return COMMS_CHANNEL_CONTROL;
+    }
+
+    uint8_t     id_length = header[2] & EUI_HEADER_ID_LEN_MASK;
+    const char *id        = (const char *)&header[EUI_HEADER_SIZE];
+
+    if( decoded < EUI_HEADER_SIZE + id_length )
+    {
+        return COMMS_CHANNEL_BULK;
+    }
+
+    if( AppTaskCommunication_id_in( id, id_length, control_ids, DIM( control_ids ) ) )
+    {
+        return COMMS_CHANNEL_CONTROL;
+    }
+
+    if( AppTaskCommunication_id_in( id, id_length, telemetry_ids, DIM( telemetry_ids ) ) )
+    {
+        return COMMS_CHANNEL_TELEMETRY;
+    }
+
+    return COMMS_CHANNEL_BULK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Split what the DMA has delivered into frames, parsing commands as soon as
+// they're complete and queueing everything else behind them in arrival order
+
+PRIVATE void
+AppTaskCommunication_rx_drain( uint8_t link )
+{
+    CommsLink_t   *me = &comms_link[link];
+    const uint8_t *data;
+
+    if( !me->ready )
+    {
+        return;
+    }
+
+    me->rx_scan_started = CYCLE_COUNT();
+
+    // A run up to the end of the rx FIFO buffer, then one from its start, with
+    // room for the deferred frames to be cleared out part way through
+    for( uint8_t span = 0; span < 4; span++ )
+    {
+        uint32_t length = AppTaskCommunication_link_rx_span( link, &data );
+
+        if( length == 0 )
+        {
+            break;
+        }
+
+        uint32_t used = AppTaskCommunication_rx_split( me, link, data, length );
+        AppTaskCommunication_link_rx_consume( link, used );
+        comms_link_stats[link].rx_bytes += used;
+
+        if( used < length )
+        {
+            AppTaskCommunication_rx_deferred( me, link );
+        }
+    }
+
+    AppTaskCommunication_rx_deferred( me, link );
+
+    me->rx_scan_previous = me->rx_scan_started;
+}
+
+// Returns the bytes used, short when the deferred frames need clearing first
+
+PRIVATE uint32_t
+AppTaskCommunication_rx_split( CommsLink_t *me, uint8_t link, const uint8_t *data, uint32_t length )
+{
+    uint32_t used = 0;
+
+    while( used < length )
+    {
+        uint8_t byte = data[used];
+
+        if( byte == COMMS_FRAME_DELIMITER )
+        {
+            if( !AppTaskCommunication_rx_frame( me, link ) )
+            {
+                break;
+            }
+        }
+        else if( me->frame_length < COMMS_FRAME_MAX )
+        {
+            me->frame[me->frame_length++] = byte;
+        }
+        else
+        {
+            me->frame_oversize = true;
+        }
+
+        used++;
+    }
+
+    return used;
+}
+
+// A frame is complete. Returns false when it has to wait for room.
+
+PRIVATE bool
+AppTaskCommunication_rx_frame( CommsLink_t *me, uint8_t link )
+{
+    static const uint8_t delimiter = COMMS_FRAME_DELIMITER;
+
+    if( me->frame_oversize || me->frame_length == 0 )
+    {
+        // Not an eUI packet, or just the gap between two
+    }
+    else if( AppTaskCommunication_classify( me->frame, me->frame_length ) == COMMS_CHANNEL_CONTROL )
+    {
+        // The parser is always between frames here, deferred ones go in whole
+        AppTaskCommunication_parse_block( link, &delimiter, 1 );
+        AppTaskCommunication_parse_block( link, me->frame, me->frame_length );
+        AppTaskCommunication_parse_block( link, &delimiter, 1 );
+
+        // It finished arriving after the previous poll started, or that poll would have taken it
+        uint32_t waited  = CYCLE_COUNT() - me->rx_scan_previous;
+        uint32_t per_us  = MAX( hal_system_speed_get_speed() / 1000000UL, 1U );
+
+        comms_stats.control_us_max = MAX( comms_stats.control_us_max, waited / per_us );
+        comms_stats.control_frames++;
+
+        comms_link_stats[link].control_us_max = MAX( comms_link_stats[link].control_us_max, waited / per_us );
+    }
+    else
+    {
+        if( fifo_free( &me->rx_deferred ) < me->frame_length + 1U )
+        {
+            return false;
+        }
+
+        fifo_write( &me->rx_deferred, me->frame, me->frame_length );
+        fifo_put( &me->rx_deferred, COMMS_FRAME_DELIMITER );
+
+        comms_stats.rx_deferred_peak = MAX( comms_stats.rx_deferred_peak, fifo_used( &me->rx_deferred ) );
+    }
+
+    me->frame_length   = 0;
+    me->frame_oversize = false;
+
+    return true;
+}
+
+PRIVATE void
+AppTaskCommunication_rx_deferred( CommsLink_t *me, uint8_t link )
+{
+    const uint8_t *data;
+
+    for( uint8_t span = 0; span < 2; span++ )
+    {
+        uint32_t length = fifo_read_span( &me->rx_deferred, &data );
+
+        if( length == 0 )
+        {
+            break;
+        }
+
+        AppTaskCommunication_parse_block( link, data, length );
+        fifo_read_commit( &me->rx_deferred, length );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// eUI hands over whole packets. A partial one would corrupt the stream and
+// waiting for the line would stall every other task, so frames that don't fit
+// are dropped rather than split or waited on.
+
+PRIVATE void
+AppTaskCommunication_tx_frame( uint8_t link, const uint8_t *c, uint16_t length )
+{
+    CommsLink_t   *me      = &comms_link[link];
+    CommsChannel_t channel = AppTaskCommunication_classify( c, length );
+
+    if( !me->ready || channel == COMMS_CHANNEL_CONTROL )
+    {
+        // Ahead of anything still queued here, behind at most what the transport holds
+        comms_stats.tx_ahead_max = MAX( comms_stats.tx_ahead_max, AppTaskCommunication_link_tx_pending( link ) );
+        comms_link_stats[link].tx_bytes += AppTaskCommunication_link_tx_write( link, c, length );
+        return;
+    }
+
+    fifo_t  *queue  = &me->tx_queue[channel - COMMS_CHANNEL_TELEMETRY];
+    uint16_t prefix = length;
+
+    if( length > COMMS_FRAME_MAX || fifo_free( queue ) < sizeof( prefix ) + length )
+    {
+        comms_stats.tx_dropped++;
+        return;
+    }
+
+    fifo_write( queue, (const uint8_t *)&prefix, sizeof( prefix ) );
+    fifo_write( queue, c, length );
+
+    AppTaskCommunication_tx_pump( link );
+}
+
+// Hand queued frames to the transport, highest channel first. A channel that's
+// held back holds back the ones below it too.
+
+PRIVATE void
+AppTaskCommunication_tx_pump( uint8_t link )
+{
+    CommsLink_t *me = &comms_link[link];
+
+    if( !me->ready )
+    {
+        return;
+    }
+
+    for( uint8_t queue = 0; queue < COMMS_TX_QUEUES; queue++ )
+    {
+        uint16_t *next = &me->tx_next[queue];
+
+        for( ;; )
+        {
+            if( *next == 0 && fifo_read( &me->tx_queue[queue], (uint8_t *)next, sizeof( *next ) ) == 0 )
+            {
+                break;    // nothing waiting on this channel
+            }
+
+            if( AppTaskCommunication_link_tx_pending( link ) >= COMMS_TX_AHEAD_MAX )
+            {
+                return;
+            }
+
+            uint8_t *block = AppTaskCommunication_link_tx_reserve( link, *next );
+
+            if( block == NULL )
+            {
+                return;
+            }
+
+            fifo_read( &me->tx_queue[queue], block, *next );
+            AppTaskCommunication_link_tx_commit( link, *next );
+            comms_link_stats[link].tx_bytes += *next;
+            *next = 0;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// The UARTs and the USB CDC port share the same span and block interfaces,
+// these pick the transport behind a link
+
+PRIVATE uint32_t
+AppTaskCommunication_link_rx_span( uint8_t link, const uint8_t **data )
+{
+    if( link == LINK_USB )
+    {
+        return hal_usb_rx_span( data );
+    }
+
+    return hal_uart_rx_span( link_port[link], data );
+}
+
+PRIVATE void
+AppTaskCommunication_link_rx_consume( uint8_t link, uint32_t length )
+{
+    if( link == LINK_USB )
+    {
+        hal_usb_rx_consume( length );
+        return;
+    }
+
+    hal_uart_rx_consume( link_port[link], length );
+}
+
+PRIVATE uint32_t
+AppTaskCommunication_link_tx_pending( uint8_t link )
+{
+    if( link == LINK_USB )
+    {
+        return hal_usb_tx_pending();
+    }
+
+    return hal_uart_tx_pending( link_port[link] );
+}
+
+// All or nothing, like the rest of a packet's handling
+
+PRIVATE uint32_t
+AppTaskCommunication_link_tx_write( uint8_t link, const uint8_t *c, uint32_t length )
+{
+    if( link == LINK_USB )
+    {
+        return hal_usb_write( c, length );
+    }
+
+    return hal_uart_send( link_port[link], c, length, HAL_UART_TX_DROP );
+}
+
+PRIVATE uint8_t *
+AppTaskCommunication_link_tx_reserve( uint8_t link, uint32_t length )
+{
+    if( link == LINK_USB )
+    {
+        return hal_usb_tx_reserve( length );
+    }
+
+    return hal_uart_tx_reserve( link_port[link], length );
+}
+
+PRIVATE void
+AppTaskCommunication_link_tx_commit( uint8_t link, uint32_t length )
+{
+    if( link == LINK_USB )
+    {
+        hal_usb_tx_commit( length );
+        return;
+    }
+
+    hal_uart_tx_commit( link_port[link], length );
+}
+
 /* -------------------------------------------------------------------------- */
 
 PRIVATE void
@@ -12,6 +12,7 @@ extern "C" {
 
 /* ----- Local Includes ----------------------------------------------------- */
 #include "event_timer.h"
+#include "fifo.h"
 #include "global.h"
 #include "state_task.h"
 
@@ -48,6 +49,76 @@ typedef enum
     INTERFACE_COUNT
 } CommunicationInstance_t;
 
+// Logical channels sharing a link, in priority order
+typedef enum
+{
+    COMMS_CHANNEL_CONTROL = 0,    // safety and state commands, and eUI's own traffic
+    COMMS_CHANNEL_TELEMETRY,      // live values the UI plots
+    COMMS_CHANNEL_BULK,           // sequence uploads and everything else
+    COMMS_CHANNEL_NUM
+} CommsChannel_t;
+
+typedef struct
+{
+    uint32_t control_us_max;      // longest a command could have waited for dispatch, poll interval included
+    uint32_t control_frames;      // commands handled ahead of queued traffic
+    uint32_t tx_dropped;          // outbound frames refused because their channel queue was full
+    uint16_t tx_ahead_max;        // most bytes waiting in the UART ahead of a reply, plus the block on the wire
+    uint16_t rx_deferred_peak;    // most inbound bytes held back behind commands
+} CommsLatency_t;
+
+// One per eUI interface, the module, internal and external UARTs then USB
+#define COMMS_LINK_NUM 4U
+
+// Traffic through each link, for comparing the transports under the same load
+typedef struct
+{
+    uint32_t rx_bytes;          // handed to the frame splitter
+    uint32_t tx_bytes;          // accepted by the transport
+    uint32_t control_us_max;    // longest a command could have waited for dispatch
+} CommsLinkStats_t;
+
+// Sequence upload streams the reliable transport carries, each numbered separately
+typedef enum
+{
+    RELIABLE_CHANNEL_MOVEMENT = 0,
+    RELIABLE_CHANNEL_LIGHTING,
+    RELIABLE_CHANNEL_NUM
+} ReliableChannel_t;
+
+// Segments held per stream, a power of two no more than 16. At 500 kbaud this
+// keeps the module link busy through about 20ms of round trip.
+#define RELIABLE_WINDOW 16U
+
+// Sized for a Movement_t, the largest upload, checked in configuration.c
+#define RELIABLE_PAYLOAD_MAX 56U
+
+#define RELIABLE_FLAG_START 0x01U    // first segment of a session, restarts the stream at its sequence
+
+typedef struct
+{
+    uint16_t sequence;
+    uint8_t  channel;    // ReliableChannel_t
+    uint8_t  flags;
+    uint8_t  payload[RELIABLE_PAYLOAD_MAX];
+} ReliableSegment_t;
+
+typedef struct
+{
+    uint16_t next;         // cumulative, everything before this sequence has arrived
+    uint16_t selective;    // bit n is set when next + 1 + n has arrived as well
+    uint8_t  channel;
+    uint8_t  window;       // sequences from next the sender may have in flight
+} ReliableAck_t;
+
+typedef struct
+{
+    uint32_t segments;         // accepted into a window
+    uint32_t duplicates;       // arrived again, acknowledged again
+    uint32_t out_of_window;    // beyond the window, dropped
+    uint32_t delivered;        // handed on to the queues
+} ReliableStats_t;
+
 /* ----- Public Functions --------------------------------------------------- */
 
 PUBLIC StateTask *
@@ -58,9 +129,47 @@ appTaskCommunicationCreate( AppTaskCommunication *        me,
 
 /* -------------------------------------------------------------------------- */
 
+/** Feed a block of received bytes to the eUI parser for a link */
+
+PUBLIC void
+AppTaskCommunication_parse_block( uint8_t link, const uint8_t *data, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
 AppTaskCommunication_rx_tick( void );
 
+/* -------------------------------------------------------------------------- */
+
+/** Combined channel statistics for all the links since the last clear */
+
+PUBLIC void
+AppTaskCommunication_latency( CommsLatency_t *report );
+
+PUBLIC void
+AppTaskCommunication_latency_clear( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Per link byte counts and command latency, COMMS_LINK_NUM entries.
+ *  Cleared along with the combined statistics.
+ */
+
+PUBLIC void
+AppTaskCommunication_link_stats( CommsLinkStats_t report[] );
+
+/* -------------------------------------------------------------------------- */
+
+/** Accept a segment for the reliable upload transport. It's passed on through
+ *  config_reliable_deliver() in sequence order and acknowledged on 'link'.
+ */
+
+PUBLIC void
+AppTaskCommunication_reliable_receive( uint8_t link, const ReliableSegment_t *segment );
+
+PUBLIC void
+AppTaskCommunication_reliable_stats( ReliableStats_t *stats );
+
 /* ----- End ---------------------------------------------------------------- */
 
 #ifdef __cplusplus
@@ -6,12 +6,14 @@
 /* ----- Local Includes ----------------------------------------------------- */
 #include "app_config.h"
 #include "app_events.h"
+#include "app_governor.h"
 #include "app_signals.h"
 #include "app_times.h"
 #include "qassert.h"
 
 #include "app_task_led.h"
 #include "led_interpolator.h"
+#include "sequence_replay.h"
 
 #include "configuration.h"
 
@@ -28,6 +30,7 @@ PRIVATE STATE AppTaskLed_active( AppTaskLed *me, const StateEvent *e );
 PRIVATE STATE AppTaskLed_active_manual( AppTaskLed *me, const StateEvent *e );
 
 PRIVATE void AppTaskLed_clear_queue( AppTaskLed *me );
+PRIVATE void AppTaskLed_discard_queued( AppTaskLed *me, uint8_t count );
 PRIVATE void AppTaskLed_add_event_to_queue( AppTaskLed *me, const StateEvent *e );
 PRIVATE void AppTaskLed_commit_queued_fade( AppTaskLed *me );
 
@@ -72,16 +75,18 @@ PRIVATE void AppTaskLed_initial( AppTaskLed *me, const StateEvent *e __attribute
     eventSubscribe( (StateTask *)me, LED_CLEAR_QUEUE );
     eventSubscribe( (StateTask *)me, LED_QUEUE_START );
     eventSubscribe( (StateTask *)me, LED_QUEUE_START_SYNC );
+    eventSubscribe( (StateTask *)me, LED_QUEUE_REPLAY );
 
     eventSubscribe( (StateTask *)me, LED_ALLOW_MANUAL_CONTROL );
     eventSubscribe( (StateTask *)me, LED_RESTRICT_MANUAL_CONTROL );
     eventSubscribe( (StateTask *)me, LED_MANUAL_SET );
 
     eventSubscribe( (StateTask *)me, ANIMATION_COMPLETE );
-    eventSubscribe( (StateTask *)me, PATHING_STARTED );
-    eventSubscribe( (StateTask *)me, PATHING_COMPLETE );
+    eventSubscribe( (StateTask *)me, PATHING_PROGRESS );
 
     led_interpolator_init();
+    path_interpolator_cursor_sync( &me->pathing );
+    sync_index_init( &me->queue_index );
 
     STATE_INIT( &AppTaskLed_main );
 }
@@ -130,17 +135,29 @@ PRIVATE STATE AppTaskLed_inactive( AppTaskLed *me, const StateEvent *e )
             return 0;
 
         case LED_QUEUE_START_SYNC: {
-            if( eventQueueUsed( &me->super.requestQueue ) )
+            uint8_t queued      = eventQueueUsed( &me->super.requestQueue );
+            uint8_t fades_ahead = 0;
+
+            if( queued )
             {
+                uint16_t id_requested     = ( (BarrierSyncEvent *)e )->id;    // ID coming in from the barrier event
+                me->identifier_to_execute = id_requested;
+
+                // Jump straight to the first fade with the requested ID
+                if( sync_index_find( &me->queue_index, id_requested, queued, &fades_ahead ) )
+                {
+                    AppTaskLed_discard_queued( me, fades_ahead );
+                    STATE_TRAN( AppTaskLed_active );
+                    return 0;
+                }
+
+                // No fades for that ID, so cull the fades which are behind it
                 // peek at the next queue item
                 StateEvent *next = eventQueuePeek( &me->super.requestQueue );
                 ASSERT( next );
                 LightingPlannerEvent *lpe          = (LightingPlannerEvent *)next;
                 Fade_t *              pending_fade = &lpe->animation;
 
-                uint16_t id_requested     = ( (BarrierSyncEvent *)e )->id;    // ID coming in from the barrier event
-                me->identifier_to_execute = id_requested;
-
                 // Handle when lighting event queue ID is behind the requested ID
                 while( id_requested > pending_fade->identifier
                        && eventQueueUsed( &me->super.requestQueue ) )
@@ -169,10 +186,28 @@ PRIVATE STATE AppTaskLed_inactive( AppTaskLed *me, const StateEvent *e )
             return 0;
         }
 
+        case LED_QUEUE_REPLAY: {
+            ReplayEvent *re = (ReplayEvent *)e;
+
+            // Moves without any retained fades replay dark
+            if( sequence_replay_start_fades( re->first_id, re->last_id, re->repeats ) )
+            {
+                me->identifier_to_execute = re->first_id;
+                STATE_TRAN( AppTaskLed_active );
+            }
+
+            return 0;
+        }
+
         case LED_ALLOW_MANUAL_CONTROL:
             STATE_TRAN( AppTaskLed_active_manual );
             return 0;
 
+        case PATHING_PROGRESS:
+            // Moves started while idle don't have animations to follow
+            path_interpolator_cursor_sync( &me->pathing );
+            return 0;
+
         case STATE_EXIT_SIGNAL:
 
             return 0;
@@ -188,6 +223,7 @@ PRIVATE STATE AppTaskLed_active( AppTaskLed *me, const StateEvent *e )
     {
         case STATE_ENTRY_SIGNAL:
             // todo tell the ui about the led state in use
+            app_governor_boost();
 
             AppTaskLed_commit_queued_fade( me );
             stateTaskPostReservedEvent( STATE_STEP1_SIGNAL );
@@ -201,7 +237,11 @@ PRIVATE STATE AppTaskLed_active( AppTaskLed *me, const StateEvent *e )
         case ANIMATION_COMPLETE: {
             // the led interpolation engine has completed the animation execution,
             // loop around to process another event with the same ID, or go back to inactive and wait for sync
-            if( eventQueueUsed( &me->super.requestQueue ) )
+            if( sequence_replay_fades_pending() )
+            {
+                stateTaskPostReservedEvent( STATE_STEP1_SIGNAL );
+            }
+            else if( eventQueueUsed( &me->super.requestQueue ) )
             {
                 StateEvent *next = eventQueuePeek( &me->super.requestQueue );
                 ASSERT( next );
@@ -226,17 +266,22 @@ PRIVATE STATE AppTaskLed_active( AppTaskLed *me, const StateEvent *e )
             return 0;
         }
 
-        case PATHING_STARTED:
-            me->identifier_to_execute = ( (BarrierSyncEvent *)e )->id;
-            led_interpolator_start_id( ( (BarrierSyncEvent *)e )->id );    // start queued LED animation
-            return 0;
+        case PATHING_PROGRESS: {
+            uint16_t started_id = 0;
 
-        case PATHING_COMPLETE:
-            // todo use this 'move completed' along with ANIMATION_COMPLETE to work out:
+            // Catch up on every move started since the last notification
+            while( path_interpolator_next_started( &me->pathing, &started_id ) )
+            {
+                me->identifier_to_execute = started_id;
+                led_interpolator_start_id( started_id );    // start queued LED animation
+            }
+
+            // todo use path_interpolator_next_completed() along with ANIMATION_COMPLETE to work out:
             //      if the lighting is over-running the movement -> off -> inactive
             //      if the movement has stopped and no LED queue items are -> inactive
 
             return 0;
+        }
 
         case LED_QUEUE_ADD:
             AppTaskLed_add_event_to_queue( me, e );
@@ -244,12 +289,14 @@ PRIVATE STATE AppTaskLed_active( AppTaskLed *me, const StateEvent *e )
 
         case LED_CLEAR_QUEUE:
             AppTaskLed_clear_queue( me );
+            sequence_replay_stop_fades();
             STATE_TRAN( AppTaskLed_inactive );
             return 0;
 
         case STATE_EXIT_SIGNAL:
             eventTimerStopIfActive( &me->timer1 );
             led_interpolator_stop();
+            sequence_replay_stop_fades();
             return 0;
     }
     return (STATE)hsmTop;
@@ -310,17 +357,36 @@ AppTaskLed_clear_queue( AppTaskLed *me )
 
 /* -------------------------------------------------------------------------- */
 
+PRIVATE void
+AppTaskLed_discard_queued( AppTaskLed *me, uint8_t count )
+{
+    // Remove fades from the head of the queue
+    while( count-- )
+    {
+        StateEvent *next = eventQueueGet( &me->super.requestQueue );
+        ASSERT( next );
+        eventPoolGarbageCollect( (StateEvent *)next );
+    }
+
+    config_set_led_queue_depth( eventQueueUsed( &me->super.requestQueue ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PRIVATE void AppTaskLed_add_event_to_queue( AppTaskLed *me, const StateEvent *e )
 {
     LightingPlannerEvent *lpe = (LightingPlannerEvent *)e;
 
+    app_governor_boost();
+
     // Add the LED animation request to the queue if we have room
     uint8_t queue_usage = eventQueueUsed( &me->super.requestQueue );
     if( queue_usage <= LED_QUEUE_DEPTH_MAX )
     {
-        if( lpe->animation.duration )
+        if( lpe->animation.duration
+            && eventQueuePutFIFO( &me->super.requestQueue, (StateEvent *)e ) )
         {
-            eventQueuePutFIFO( &me->super.requestQueue, (StateEvent *)e );
+            sync_index_add( &me->queue_index, lpe->animation.identifier, queue_usage );
         }
     }
     else
@@ -334,6 +400,16 @@ PRIVATE void AppTaskLed_add_event_to_queue( AppTaskLed *me, const StateEvent *e
 
 PRIVATE void AppTaskLed_commit_queued_fade( AppTaskLed *me )
 {
+    // A running replay feeds from the retained fades ahead of the queue
+    if( sequence_replay_fades_pending() )
+    {
+        if( led_interpolator_is_ready_for_next() )
+        {
+            led_interpolator_set_objective( sequence_replay_next_fade() );
+        }
+        return;
+    }
+
     if( led_interpolator_is_ready_for_next()
         && eventQueueUsed( &me->super.requestQueue ) )
     {
@@ -346,6 +422,7 @@ PRIVATE void AppTaskLed_commit_queued_fade( AppTaskLed *me )
         if( next_animation->duration )
         {
             // Add the valid lighting 'fade' animation to the ping-pong buffer
+            sequence_replay_store_fade( next_animation );
             led_interpolator_set_objective( next_animation );
             eventPoolGarbageCollect( (StateEvent *)next );
         }
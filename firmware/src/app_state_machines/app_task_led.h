@@ -13,7 +13,9 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 #include "event_timer.h"
 #include "global.h"
+#include "path_interpolator.h"
 #include "state_task.h"
+#include "sync_index.h"
 
 /* ----- State Task Control Block ------------------------------------------- */
 
@@ -30,7 +32,9 @@ struct AppTaskLed
     EventTimer timer2;
 
     // ~~~ Task Variables ~~~
-    uint16_t identifier_to_execute;
+    uint16_t        identifier_to_execute;
+    sync_index_t    queue_index;    // queue position of each queued ID
+    PathingCursor_t pathing;    // move starts already handled
 };
 
 /* ----- Public Functions --------------------------------------------------- */
@@ -6,6 +6,7 @@
 /* ----- Local Includes ----------------------------------------------------- */
 #include "app_config.h"
 #include "app_events.h"
+#include "app_governor.h"
 #include "app_signals.h"
 #include "app_times.h"
 #include "qassert.h"
@@ -16,6 +17,8 @@
 #include "kinematics.h"
 #include "motion_types.h"
 #include "path_interpolator.h"
+#include "sequence_clock.h"
+#include "sequence_replay.h"
 
 #include "configuration.h"
 
@@ -34,7 +37,9 @@ PRIVATE STATE AppTaskMotion_recovery( AppTaskMotion *me, const StateEvent *e );
 
 PRIVATE void AppTaskMotion_commit_queued_move( AppTaskMotion *me );
 PRIVATE void AppTaskMotion_clear_queue( AppTaskMotion *me );
+PRIVATE void AppTaskMotion_discard_queued( AppTaskMotion *me, uint8_t count );
 PRIVATE void AppTaskMotion_add_event_to_queue( AppTaskMotion *me, const StateEvent *e );
+PRIVATE void AppTaskMotion_replay_scale_restore( AppTaskMotion *me );
 
 typedef enum
 {
@@ -89,11 +94,16 @@ PRIVATE void AppTaskMotion_initial( AppTaskMotion *me, const StateEvent *e __att
     eventSubscribe( (StateTask *)me, MOTION_QUEUE_CLEAR );
     eventSubscribe( (StateTask *)me, MOTION_QUEUE_START );
     eventSubscribe( (StateTask *)me, MOTION_QUEUE_START_SYNC );
+    eventSubscribe( (StateTask *)me, MOTION_QUEUE_HOLD );
+    eventSubscribe( (StateTask *)me, MOTION_QUEUE_RESUME );
+    eventSubscribe( (StateTask *)me, MOTION_QUEUE_REPLAY );
 
-    eventSubscribe( (StateTask *)me, PATHING_COMPLETE );
+    eventSubscribe( (StateTask *)me, PATHING_PROGRESS );
 
     kinematics_init();
     path_interpolator_init();
+    path_interpolator_cursor_sync( &me->pathing );
+    sync_index_init( &me->queue_index );
     config_set_motion_state( TASKSTATE_MOTION_INITIAL );
 
     STATE_INIT( &AppTaskMotion_main );
@@ -138,6 +148,7 @@ PRIVATE STATE AppTaskMotion_home( AppTaskMotion *me, const StateEvent *e )
             }
 
             config_set_motion_state( TASKSTATE_MOTION_HOME );
+            app_governor_boost();
 
             //check the motors every 500ms to see if they are homed
             eventTimerStartEvery( &me->timer1,
@@ -245,31 +256,52 @@ PRIVATE STATE AppTaskMotion_inactive( AppTaskMotion *me, const StateEvent *e )
             STATE_TRAN( AppTaskMotion_active );
             return 0;
 
-        case MOTION_QUEUE_START_SYNC: {
-            // Check that the ID we got the sync event for matches the current queue head ID
-            // TODO support sync events on ID's which aren't the current head
-            //      consider searching/ditching events until ID matches?
-            StateEvent *pendingMotion = eventQueuePeek( &me->super.requestQueue );
+        case MOTION_QUEUE_RESUME:
+            // Nothing running, release the hold so the next start isn't frozen
+            sequence_clock_resume( 0 );
+            return 0;
 
-            if( pendingMotion )
-            {
-                MotionPlannerEvent *ape          = (MotionPlannerEvent *)pendingMotion;
-                uint16_t            id_in_queue  = ( (Movement_t *)&ape->move )->identifier;
-                uint16_t            id_requested = ( (BarrierSyncEvent *)e )->id;
+        case MOTION_QUEUE_REPLAY: {
+            ReplayEvent *re = (ReplayEvent *)e;
 
-                if( id_in_queue == id_requested )
-                {
-                    STATE_TRAN( AppTaskMotion_active );
-                }
-                else
+            if( sequence_replay_start_moves( re->first_id, re->last_id, re->repeats ) )
+            {
+                // Only for the replay, the UI's rate comes back once it's done
+                if( re->scale > 0.0f )
                 {
-                    config_report_error( "Sync fail - queued ID mismatch" );
+                    sequence_clock_set_scale( re->scale );
+                    me->replay_scaled = true;
                 }
+
+                STATE_TRAN( AppTaskMotion_active );
             }
             else
+            {
+                config_report_error( "Replay fail - moves not retained" );
+            }
+
+            return 0;
+        }
+
+        case MOTION_QUEUE_START_SYNC: {
+            // Find the requested ID anywhere in the queue, and drop the moves queued ahead of it
+            uint8_t  queued       = eventQueueUsed( &me->super.requestQueue );
+            uint16_t id_requested = ( (BarrierSyncEvent *)e )->id;
+            uint8_t  moves_ahead  = 0;
+
+            if( !queued )
             {
                 config_report_error( "Sync fail - nothing queued" );
             }
+            else if( sync_index_find( &me->queue_index, id_requested, queued, &moves_ahead ) )
+            {
+                AppTaskMotion_discard_queued( me, moves_ahead );
+                STATE_TRAN( AppTaskMotion_active );
+            }
+            else
+            {
+                config_report_error( "Sync fail - ID not queued" );
+            }
 
             return 0;
         }
@@ -293,6 +325,10 @@ PRIVATE STATE AppTaskMotion_active( AppTaskMotion *me, const StateEvent *e )
     {
         case STATE_ENTRY_SIGNAL:
             config_set_motion_state( TASKSTATE_MOTION_ACTIVE );
+            app_governor_boost();
+
+            // Completions of moves from before this run aren't relevant
+            path_interpolator_cursor_sync( &me->pathing );
             AppTaskMotion_commit_queued_move( me );
 
             if( path_interpolator_is_ready_for_next() )
@@ -305,12 +341,27 @@ PRIVATE STATE AppTaskMotion_active( AppTaskMotion *me, const StateEvent *e )
             AppTaskMotion_commit_queued_move( me );
             return 0;
 
-        // todo add motion handler watching on PATHING_STARTED?
-        //      possibly not needed...
-        case PATHING_COMPLETE: {
+        case PATHING_PROGRESS: {
+            // Progress notifications are coalesced, so one event may cover several completions.
+            // Only starts were reported, nothing to do.
+            bool move_completed = false;
+            while( path_interpolator_next_completed( &me->pathing, NULL ) )
+            {
+                move_completed = true;
+            }
+
+            if( !move_completed )
+            {
+                return 0;
+            }
+
             // the pathing engine completed movement execution,
             // run another event, or go back to inactive to wait for new instructions
-            if( eventQueueUsed( &me->super.requestQueue ) )
+            if( sequence_replay_moves_pending() )
+            {
+                stateTaskPostReservedEvent( STATE_STEP1_SIGNAL );
+            }
+            else if( eventQueueUsed( &me->super.requestQueue ) )
             {
                 StateEvent *next = eventQueuePeek( &me->super.requestQueue );
                 ASSERT( next );
@@ -340,8 +391,19 @@ PRIVATE STATE AppTaskMotion_active( AppTaskMotion *me, const StateEvent *e )
             AppTaskMotion_add_event_to_queue( me, e );
             return 0;
 
+        case MOTION_QUEUE_HOLD:
+            // Decelerate along the path, the interpolators and queue are left intact
+            sequence_clock_hold( ( (FeedHoldEvent *)e )->ramp_ms );
+            return 0;
+
+        case MOTION_QUEUE_RESUME:
+            sequence_clock_resume( ( (FeedHoldEvent *)e )->ramp_ms );
+            return 0;
+
         case MOTION_QUEUE_CLEAR:
             AppTaskMotion_clear_queue( me );
+            sequence_replay_stop_moves();
+            sequence_clock_resume( 0 );
             STATE_TRAN( AppTaskMotion_inactive );
             return 0;
 
@@ -351,6 +413,7 @@ PRIVATE STATE AppTaskMotion_active( AppTaskMotion *me, const StateEvent *e )
 
         case STATE_EXIT_SIGNAL:
             eventTimerStopIfActive( &me->timer1 );
+            AppTaskMotion_replay_scale_restore( me );
             return 0;
     }
     return (STATE)hsmTop;
@@ -370,8 +433,10 @@ PRIVATE STATE AppTaskMotion_recovery( AppTaskMotion *me, const StateEvent *e )
                 servo_stop( servo );
             }
 
-            // Stop the motion interpolation engine
+            // Stop the motion interpolation engine, and drop any feed hold
             path_interpolator_stop();
+            sequence_replay_stop_moves();
+            sequence_clock_resume( 0 );
 
             //update state for UI
             config_set_motion_state( TASKSTATE_MOTION_RECOVERY );
@@ -430,6 +495,20 @@ PRIVATE STATE AppTaskMotion_recovery( AppTaskMotion *me, const StateEvent *e )
 
 PRIVATE void AppTaskMotion_commit_queued_move( AppTaskMotion *me )
 {
+    // A running replay feeds from the retained moves ahead of the queue
+    if( sequence_replay_moves_pending() )
+    {
+        if( path_interpolator_is_ready_for_next() )
+        {
+            path_interpolator_set_next( sequence_replay_next_move() );
+            path_interpolator_start();
+        }
+        return;
+    }
+
+    // Replay's done, queued moves run at the rate the UI asked for
+    AppTaskMotion_replay_scale_restore( me );
+
     // Check for pending events in the queue, and the pathing engine is able to accept one
     if( path_interpolator_is_ready_for_next()
         && eventQueueUsed( &me->super.requestQueue ) )
@@ -444,6 +523,7 @@ PRIVATE void AppTaskMotion_commit_queued_move( AppTaskMotion *me )
         if( next_move->duration )
         {
             // Pass this valid move to the pathing engine, and start it
+            sequence_replay_store_move( next_move );
             path_interpolator_set_next( next_move );
             path_interpolator_start();
 
@@ -473,6 +553,21 @@ PRIVATE void AppTaskMotion_clear_queue( AppTaskMotion *me )
 
 /* -------------------------------------------------------------------------- */
 
+PRIVATE void AppTaskMotion_discard_queued( AppTaskMotion *me, uint8_t count )
+{
+    // Remove moves from the head of the queue
+    while( count-- )
+    {
+        StateEvent *next = eventQueueGet( &me->super.requestQueue );
+        ASSERT( next );
+        eventPoolGarbageCollect( (StateEvent *)next );
+    }
+
+    config_set_motion_queue_depth( eventQueueUsed( &me->super.requestQueue ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PRIVATE void AppTaskMotion_add_event_to_queue( AppTaskMotion *me, const StateEvent *e )
 {
     //already in motion, so add this one to the queue
@@ -480,20 +575,37 @@ PRIVATE void AppTaskMotion_add_event_to_queue( AppTaskMotion *me, const StateEve
 
     ASSERT( mpe->move.duration != 0 );
 
+    // Full speed before the sequence that this move belongs to starts
+    app_governor_boost();
+
     // Add the movement request to the queue if we have room
     uint8_t queue_usage = eventQueueUsed( &me->super.requestQueue );
     if( queue_usage <= MOVEMENT_QUEUE_DEPTH_MAX )
     {
         int32_t speed = cartesian_move_speed( &mpe->move );
 
-        if( speed < EFFECTOR_SPEED_LIMIT )
+        // Only absolute paths have a known start, the rest are checked as they begin
+        float step_rate = 0.0f;
+        if( mpe->move.ref == _POS_ABSOLUTE && mpe->move.type != _POINT_TRANSIT )
         {
-            eventQueuePutFIFO( &me->super.requestQueue, (StateEvent *)e );
+            step_rate = path_interpolator_step_rate( &mpe->move );
         }
-        else
+
+        if( speed >= EFFECTOR_SPEED_LIMIT )
         {
             config_report_error( "Requested illegal speed" );
         }
+        else if( step_rate > servo_step_rate_limit() )
+        {
+            config_report_error( "Requested illegal step rate" );
+        }
+        else
+        {
+            if( eventQueuePutFIFO( &me->super.requestQueue, (StateEvent *)e ) )
+            {
+                sync_index_add( &me->queue_index, mpe->move.identifier, queue_usage );
+            }
+        }
     }
     else
     {
@@ -508,4 +620,15 @@ PRIVATE void AppTaskMotion_add_event_to_queue( AppTaskMotion *me, const StateEve
     config_set_motion_queue_depth( eventQueueUsed( &me->super.requestQueue ) );
 }
 
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void AppTaskMotion_replay_scale_restore( AppTaskMotion *me )
+{
+    if( me->replay_scaled )
+    {
+        sequence_clock_set_scale( config_get_time_scale_request() );
+        me->replay_scaled = false;
+    }
+}
+
 /* ----- End ---------------------------------------------------------------- */
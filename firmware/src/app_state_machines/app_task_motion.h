@@ -13,7 +13,9 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 #include "event_timer.h"
 #include "global.h"
+#include "path_interpolator.h"
 #include "state_task.h"
+#include "sync_index.h"
 
 /* ----- State Task Control Block ------------------------------------------- */
 
@@ -30,8 +32,11 @@ struct AppTaskMotion
     EventTimer timer2;
 
     // ~~~ Task Variables ~~~
-    uint8_t counter;
-    uint8_t retries;
+    uint8_t         counter;
+    uint8_t         retries;
+    sync_index_t    queue_index;    // queue position of each queued ID
+    PathingCursor_t pathing;    // completions already handled
+    bool            replay_scaled;    // a replay overrode the UI's playback rate
 };
 
 /* ----- Public Functions --------------------------------------------------- */
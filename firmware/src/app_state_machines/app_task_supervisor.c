@@ -93,6 +93,7 @@ PRIVATE void AppTaskSupervisor_initial( AppTaskSupervisor *me,
     eventSubscribe( (StateTask *)me, MODE_MANUAL );
 
     eventSubscribe( (StateTask *)me, START_QUEUE_SYNC );
+    eventSubscribe( (StateTask *)me, SEQUENCE_REPLAY );
 
     eventSubscribe( (StateTask *)me, QUEUE_SYNC_MOTION_NEXT );
     eventSubscribe( (StateTask *)me, QUEUE_SYNC_LED_NEXT );
@@ -431,6 +432,36 @@ PRIVATE STATE AppTaskSupervisor_armed_event( AppTaskSupervisor *me,
             return 0;
         }
 
+        case SEQUENCE_REPLAY: {
+            ReplayEvent *inbound_replay = (ReplayEvent *)e;
+
+            if( inbound_replay )
+            {
+                // Create replay events for the motion and led tasks
+                ReplayEvent *motor_replay = EVENT_NEW( ReplayEvent, MOTION_QUEUE_REPLAY );
+                ReplayEvent *led_replay   = EVENT_NEW( ReplayEvent, LED_QUEUE_REPLAY );
+
+                if( motor_replay )
+                {
+                    motor_replay->first_id = inbound_replay->first_id;
+                    motor_replay->last_id  = inbound_replay->last_id;
+                    motor_replay->scale    = inbound_replay->scale;
+                    motor_replay->repeats  = inbound_replay->repeats;
+                    eventPublish( (StateEvent *)motor_replay );
+                }
+
+                if( led_replay )
+                {
+                    led_replay->first_id = inbound_replay->first_id;
+                    led_replay->last_id  = inbound_replay->last_id;
+                    led_replay->scale    = inbound_replay->scale;
+                    led_replay->repeats  = inbound_replay->repeats;
+                    eventPublish( (StateEvent *)led_replay );
+                }
+            }
+            return 0;
+        }
+
         case MOVEMENT_REQUEST: {
             //catch the inbound movement event
             MotionPlannerEvent *mpe = (MotionPlannerEvent *)e;
@@ -11,7 +11,9 @@
 #include "app_task_ids.h"
 #include "app_times.h"
 #include "event_subscribe.h"
+#include "flight_recorder.h"
 #include "global.h"
+#include "memory_watermark.h"
 #include "qassert.h"
 #include "state_task.h"
 #include "state_tasker.h"
@@ -25,6 +27,7 @@
 #include "button.h"
 #include "hal_button.h"
 #include "hal_systick.h"
+#include "hal_uart.h"
 
 /* -------------------------------------------------------------------------- */
 
@@ -67,9 +70,23 @@ AppTaskLed  appTaskLed;
 StateEvent *appTaskLedEventQueue[LED_QUEUE_DEPTH_MAX];
 StateEvent *appTaskLedQueue[250];
 
+// Each request queue's sync index has to cover every event it can hold
+_Static_assert( SYNC_INDEX_FITS( DIM( appTaskMotionQueue ) ), "Motion queue deeper than its sync index" );
+_Static_assert( SYNC_INDEX_FITS( DIM( appTaskLedQueue ) ), "LED queue deeper than its sync index" );
+
 AppTaskSupervisor appTaskSupervisor;
 StateEvent *      appTaskSupervisorEventQueue[20];
 
+// Lock-free inboxes for timer events, sized to a power of two
+StateEvent *appTaskCommunicationInbox[8];
+StateEvent *appTaskMotionInbox[8];
+StateEvent *appTaskLedInbox[8];
+StateEvent *appTaskSupervisorInbox[8];
+uint16_t    appTaskCommunicationInboxStamps[DIM( appTaskCommunicationInbox )];
+uint16_t    appTaskMotionInboxStamps[DIM( appTaskMotionInbox )];
+uint16_t    appTaskLedInboxStamps[DIM( appTaskLedInbox )];
+uint16_t    appTaskSupervisorInboxStamps[DIM( appTaskSupervisorInbox )];
+
 // ~~~ Tasker ~~~
 
 PRIVATE StateTasker_t mainTasker;
@@ -105,6 +122,12 @@ void app_tasks_init( void )
     /* ~~~ Event Subscription Tables Initialisation ~~~ */
     eventSubscribeInit( mainTaskTable, eventSubscriberList, STATE_MAX_SIGNAL );
 
+    /* ~~~ Flight Recorder, keeps the history from before a soft reset ~~~ */
+    flight_recorder_init();
+
+    /* ~~~ Memory usage summary, also keeps the one from before a soft reset ~~~ */
+    memory_watermark_init();
+
     /* ~~~ Event Timers Initialisation ~~~ */
     eventTimerInit();
 
@@ -120,6 +143,10 @@ void app_tasks_init( void )
                                     DIM( appTaskCommunicationEventQueue ),
                                     INTERFACE_UART_MODULE );
 
+    stateTaskAddInbox( t,
+                       appTaskCommunicationInbox,
+                       appTaskCommunicationInboxStamps,
+                       DIM( appTaskCommunicationInbox ) );
     stateTaskerAddTask( &mainTasker, t, TASK_COMMUNICATION, "Comms" );
     stateTaskerStartTask( &mainTasker, t );
 
@@ -130,6 +157,10 @@ void app_tasks_init( void )
                              appTaskMotionQueue,
                              DIM( appTaskMotionQueue ) );
 
+    stateTaskAddInbox( t,
+                       appTaskMotionInbox,
+                       appTaskMotionInboxStamps,
+                       DIM( appTaskMotionInbox ) );
     stateTaskerAddTask( &mainTasker, t, TASK_MOTION, "Movement" );
     stateTaskerStartTask( &mainTasker, t );
 
@@ -140,6 +171,10 @@ void app_tasks_init( void )
                           appTaskLedQueue,
                           DIM( appTaskLedQueue ) );
 
+    stateTaskAddInbox( t,
+                       appTaskLedInbox,
+                       appTaskLedInboxStamps,
+                       DIM( appTaskLedInbox ) );
     stateTaskerAddTask( &mainTasker, t, TASK_LIGHTING, "Lighting" );
     stateTaskerStartTask( &mainTasker, t );
 
@@ -148,6 +183,10 @@ void app_tasks_init( void )
                                  appTaskSupervisorEventQueue,
                                  DIM( appTaskSupervisorEventQueue ) );
 
+    stateTaskAddInbox( t,
+                       appTaskSupervisorInbox,
+                       appTaskSupervisorInboxStamps,
+                       DIM( appTaskSupervisorInbox ) );
     stateTaskerAddTask( &mainTasker, t, TASK_SUPERVISOR, "Supervisor" );
     stateTaskerStartTask( &mainTasker, t );
 
@@ -191,4 +230,49 @@ app_task_clear_statistics( void )
     stateTaskerClearStatistics( &mainTasker );
 }
 
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+app_tasks_memory_watermarks( MemoryWatermarks_t *marks )
+{
+    memset( marks, 0, sizeof( MemoryWatermarks_t ) );
+
+    marks->stack_used = memory_watermark_stack_used();
+    marks->stack_size = memory_watermark_stack_size();
+
+    for( uint8_t pool = 0; pool < MEMORY_WATERMARK_POOLS; pool++ )
+    {
+        eventPoolHighWater( pool + 1, &marks->pool_peak[pool], &marks->pool_size[pool] );
+    }
+
+    REQUIRE( ( TASK_MAX - 1 ) * 2 <= MEMORY_WATERMARK_QUEUES );
+
+    for( uint8_t id = TASK_SUPERVISOR; id < TASK_MAX; id++ )
+    {
+        StateTask *t = stateTaskerGetTaskById( &mainTasker, id );
+        if( t )
+        {
+            uint8_t slot = ( id - 1 ) * 2;
+
+            marks->queue_peak[slot]     = eventQueueHighWater( &t->eventQueue );
+            marks->queue_size[slot]     = t->eventQueue.size;
+            marks->queue_peak[slot + 1] = eventQueueHighWater( &t->requestQueue );
+            marks->queue_size[slot + 1] = t->requestQueue.size;
+        }
+    }
+
+    REQUIRE( HAL_UART_NUM_PORTS * 2 <= MEMORY_WATERMARK_FIFOS );
+
+    for( HalUartPort_t port = HAL_UART_PORT_EXTERNAL; port < HAL_UART_NUM_PORTS; port++ )
+    {
+        hal_uart_high_water( port,
+                             &marks->fifo_peak[port * 2],
+                             &marks->fifo_size[port * 2],
+                             &marks->fifo_peak[port * 2 + 1],
+                             &marks->fifo_size[port * 2 + 1] );
+    }
+
+    memory_watermark_save( marks );
+}
+
 /* ----- End ---------------------------------------------------------------- */
@@ -10,6 +10,7 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "global.h"
+#include "memory_watermark.h"
 #include "state_task.h"
 
 /* ----- Public Functions --------------------------------------------------- */
@@ -41,6 +42,16 @@ app_task_by_id( uint8_t id );
 PUBLIC void
 app_task_clear_statistics( void );
 
+/* -------------------------------------------------------------------------- */
+
+/** Collect the memory high-water marks and keep them for the next boot.
+ *  Queues are reported per task id as the event queue then the request
+ *  queue, FIFOs per UART port as tx then rx.
+ */
+
+PUBLIC void
+app_tasks_memory_watermarks( MemoryWatermarks_t *marks );
+
 /* ----- End ---------------------------------------------------------------- */
 
 #ifdef __cplusplus
@@ -31,15 +31,52 @@ enum SystemDefines
     BACKGROUND_RATE_BUZZER_MS  = 10U,     // 100Hz
     BACKGROUND_ADC_AVG_POLL_MS = 100U,    //  10Hz
 
+    BACKGROUND_MOTION_DEADLINE_MS     = 2U,      // longest gap between motion job runs
+    BACKGROUND_MOTION_RATE_WINDOW_MS  = 100U,    // window the motion pass rate is measured over
+    BACKGROUND_HOUSEKEEPING_BUDGET_US = 200U,    // housekeeping time per pass after motion
+
+    TELEMETRY_POLL_MS         = 5U,     // how often the telemetry interval is checked
+    TELEMETRY_INTERVAL_MIN_MS = 10U,    // fastest telemetry frame rate the UI can ask for
+
+    GOVERNOR_EVALUATE_MS = 100U,     // how often the idle check runs
+    GOVERNOR_IDLE_MS     = 2000U,    // idle time before the core clock is halved
+
     MOVEMENT_QUEUE_DEPTH_MAX = 150U,    // movement events in the queue
     LED_QUEUE_DEPTH_MAX      = 250U,    // LED animations in the queue
 
+    REPLAY_MOVES_MAX = 256U,    // executed movements retained for replay
+    REPLAY_FADES_MAX = 256U,    // executed LED animations retained for replay
+
     EFFECTOR_SPEED_LIMIT    = 350U,    // mm/second
     SPEED_SAMPLE_RESOLUTION = 15U,     // number of samples to sum across line
 };
 
 /* -------------------------------------------------------------------------- */
 
+enum SequenceClockDefines
+{
+    SEQUENCE_SCALE_MIN_PERCENT    = 10U,     // slowest playback rate the UI can request
+    SEQUENCE_SCALE_MAX_PERCENT    = 400U,    // fastest playback rate the UI can request
+    SEQUENCE_SCALE_SLEW_PERCENT_S = 100U,    // maximum change in playback rate per second
+    FEED_HOLD_RAMP_MS             = 500U,    // default time to decelerate into, or accelerate out of, a hold
+};
+
+/* -------------------------------------------------------------------------- */
+
+enum GcodeDefines
+{
+    GCODE_BUFFER_SIZE    = 1024U,    // text waiting to be interpreted, a power of two
+    GCODE_LINE_MAX       = 96U,      // longest line, comments included
+    GCODE_CHUNK_MAX      = 64U,      // text carried by one "gcode" message
+    GCODE_QUEUE_HEADROOM = 16U,      // movement queue slots left for moves still on their way
+    GCODE_STEPS_PER_POLL = 8U,       // lines read plus moves handed on per background pass
+    GCODE_RAPID_SPEED    = 300U,     // mm/second for G0, under EFFECTOR_SPEED_LIMIT
+    GCODE_FEED_DEFAULT   = 20U,      // mm/second until the program sets F
+    GCODE_ARC_TOLERANCE  = 50U,      // microns the start and end radius of an arc can differ by
+};
+
+/* -------------------------------------------------------------------------- */
+
 enum CommunicationDefines
 {
     MODULE_BAUD   = 500000,
@@ -149,6 +186,11 @@ enum ServoDefines
     //ULN2303 NPN driver has rise time of ~5ns, fall of ~10nsec
     SERVO_PULSE_DURATION_US = 10U,
 
+    //servo_process() emits at most SERVO_PULSES_PER_PASS per servo per motion pass, one
+    //servo after another, so the step rate is bound by the measured pass rate and pulse timing
+    SERVO_PULSES_PER_PASS          = 8U,
+    SERVO_STEP_RATE_MARGIN_PERCENT = 75U,    // of the achievable step rate planned moves may use
+
     //Error evaluation parameters
     SERVO_IDLE_POWER_ALERT_W = 40U,
     SERVO_IDLE_TORQUE_ALERT  = 30U,
@@ -103,6 +103,23 @@ typedef union    ///< Allow mapping int16 to uint16
 
 /* -------------------------------------------------------------------------- */
 
+//! \def RAMFUNC
+/// Run a function from SRAM, copied there by the startup code. For the motion
+/// hot path, flash needs wait states at full clock speed.
+//! \def CCMRAM
+/// Keep zero initialised data in the core coupled RAM, which only the CPU can
+/// reach so the accesses don't contend with DMA. Not for DMA buffers.
+/// Build with HOT_PATH_IN_FLASH to put both back for comparison.
+#if defined( STM32F429xx ) && !defined( HOT_PATH_IN_FLASH )
+#define RAMFUNC __attribute__( ( section( ".ramfunc" ) ) )
+#define CCMRAM  __attribute__( ( section( ".ccmram" ) ) )
+#else
+#define RAMFUNC
+#define CCMRAM
+#endif
+
+/* -------------------------------------------------------------------------- */
+
 //! \def FORBID()
 /// Disable interrupts
 #ifdef STM32F429xx
@@ -119,44 +136,107 @@ typedef union    ///< Allow mapping int16 to uint16
 #define PERMIT()
 #endif
 
-//! \def CRITICAL_SECTION_START()
-/// Save the current interrupt state and then disable interrupts to
-/// enter a critical region of code.
+//! \def KERNEL_IRQ_PRIORITY
+/// Preemption priority of interrupts that use the event kernel (event timers,
+/// pools, queues and subscriptions). Critical sections only mask interrupts
+/// at this priority or lower, so device interrupts set to a higher priority
+/// (numerically lower) keep their latency. Those must not use the kernel.
+#define KERNEL_IRQ_PRIORITY 12U
+
+// Priority in the BASEPRI register format, the STM32F4 has 4 priority bits
+#define KERNEL_IRQ_BASEPRI  ( KERNEL_IRQ_PRIORITY << 4U )
+
+//! \def CRITICAL_SECTION_AUDIT
+/// Define to measure the longest time interrupts are masked by a critical
+/// section, see critical_section_audit.h
+#if defined( CRITICAL_SECTION_AUDIT ) && defined( STM32F429xx )
+void critical_section_audit( uint8_t saved, uint32_t started, const char *file, uint16_t line );
+#define CRITICAL_SECTION_AUDIT_VAR()   uint32_t cpuSRStarted
+#define CRITICAL_SECTION_AUDIT_ENTER() cpuSRStarted = CYCLE_COUNT()
+#define CRITICAL_SECTION_AUDIT_EXIT()  critical_section_audit( cpuSR, cpuSRStarted, __FILE__, __LINE__ )
+#else
+#define CRITICAL_SECTION_AUDIT_VAR()   do {} while(0)
+#define CRITICAL_SECTION_AUDIT_ENTER()
+#define CRITICAL_SECTION_AUDIT_EXIT()
+#endif
+
+//! \def CRITICAL_SECTION_VAR()
+/// Storage for the interrupt state saved by a critical section.
 #ifdef STM32F429xx
-#define CRITICAL_SECTION_VAR() uint8_t cpuSR
+#define CRITICAL_SECTION_VAR() uint8_t cpuSR; CRITICAL_SECTION_AUDIT_VAR()
 #else
 #define CRITICAL_SECTION_VAR()
 #endif
 
 //! \def CRITICAL_SECTION_START()
-/// Save the current interrupt state and then disable interrupts to
-/// enter a critical region of code.
+/// Save the current interrupt mask and then mask the kernel priority
+/// interrupts to enter a critical region of code.
 #ifdef STM32F429xx
 #define CRITICAL_SECTION_START()              \
         do {                                  \
-          asm (                               \
+          asm volatile (                      \
+          "MRS   R0, BASEPRI\n\t"             \
+          "MOV   R1, %[mask]\n\t"             \
+          "MSR   BASEPRI_MAX, R1\n\t"         \
+          "STRB  R0, %[output]"               \
+          : [output] "=m" (cpuSR)             \
+          : [mask] "i" (KERNEL_IRQ_BASEPRI)   \
+          : "r0", "r1", "memory" );           \
+          CRITICAL_SECTION_AUDIT_ENTER();     \
+        } while(0)
+#else
+#define CRITICAL_SECTION_START()
+#endif
+
+//! \def CRITICAL_SECTION_END()
+/// Exit critical section of code and restore the interrupt mask
+/// to what it was before \ref CRITICAL_SECTION_START.
+#ifdef STM32F429xx
+#define CRITICAL_SECTION_END()                \
+        do{                                   \
+          CRITICAL_SECTION_AUDIT_EXIT();      \
+          asm volatile (                      \
+          "ldrb r0, %[input]\n\t"             \
+          "msr BASEPRI,r0;\n\t"               \
+          ::[input] "m" (cpuSR) : "r0", "memory" ); \
+        } while(0)
+#else
+#define CRITICAL_SECTION_END()
+#endif
+
+//! \def CRITICAL_SECTION_ALL_START()
+/// Save the current interrupt state and then disable all interrupts. Only
+/// for data shared with interrupts above the kernel priority, and for
+/// sleeping, as WFI doesn't wake for interrupts masked by BASEPRI.
+/// Uses the same \ref CRITICAL_SECTION_VAR storage.
+#ifdef STM32F429xx
+#define CRITICAL_SECTION_ALL_START()          \
+        do {                                  \
+          asm volatile (                      \
           "MRS   R0, PRIMASK\n\t"             \
           "CPSID I\n\t"                       \
           "STRB R0, %[output]"                \
-          : [output] "=m" (cpuSR) :: "r0");   \
+          : [output] "=m" (cpuSR) :: "r0", "memory" ); \
+          CRITICAL_SECTION_AUDIT_ENTER();     \
         } while(0)
 #else
-#define CRITICAL_SECTION_START()
+#define CRITICAL_SECTION_ALL_START()
 #endif
 
-//! \def CRITICAL_SECTION_END()
+//! \def CRITICAL_SECTION_ALL_END()
 /// Exit critical section of code and restore interrupt state
-/// to what it was before \ref CRITICAL_SECTION_START.
+/// to what it was before \ref CRITICAL_SECTION_ALL_START.
 #ifdef STM32F429xx
-#define CRITICAL_SECTION_END()               \
+#define CRITICAL_SECTION_ALL_END()            \
         do{                                   \
-          asm (                               \
+          CRITICAL_SECTION_AUDIT_EXIT();      \
+          asm volatile (                      \
           "ldrb r0, %[input]\n\t"             \
           "msr PRIMASK,r0;\n\t"               \
-          ::[input] "m" (cpuSR) : "r0");      \
+          ::[input] "m" (cpuSR) : "r0", "memory" ); \
         } while(0)
 #else
-#define CRITICAL_SECTION_END()
+#define CRITICAL_SECTION_ALL_END()
 #endif
 
 //! \def ATOMIC()
@@ -172,6 +252,25 @@ typedef union    ///< Allow mapping int16 to uint16
                                      CRITICAL_SECTION_END();    \
                                  } while(0)
 
+/* -------------------------------------------------------------------------- */
+
+//! \def CYCLE_COUNT()
+/// Read the free running DWT cycle counter, enabled by hal_system_speed_init.
+#ifdef STM32F429xx
+#define CYCLE_COUNT() ( *(volatile uint32_t *)0xE0001004UL )
+#else
+#define CYCLE_COUNT() ( 0UL )
+#endif
+
+//! \def MEMORY_BARRIER()
+/// Order memory accesses around lock-free hand-overs between an interrupt
+/// and the main loop.
+#ifdef STM32F429xx
+#define MEMORY_BARRIER() asm volatile ( "dmb" ::: "memory" )
+#else
+#define MEMORY_BARRIER() asm volatile ( "" ::: "memory" )
+#endif
+
 /* ----- End ------------~--------------------------------------------------- */
 #ifdef    __cplusplus
 }
@@ -5,6 +5,7 @@
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "clearpath.h"
+#include "app_background.h"
 #include "sensors.h"
 
 #include "hal_delay.h"
@@ -50,7 +51,8 @@ typedef struct
     float   homing_feedback;
     int16_t angle_current_steps;
     int16_t angle_target_steps;
-    bool    enabled;
+
+    volatile bool enabled;    // also cleared by servo_emergency_stop() from an interrupt
 } Servo_t;
 
 typedef struct
@@ -74,7 +76,7 @@ typedef struct
 
 /* ----- Private Variables -------------------------------------------------- */
 
-PRIVATE Servo_t clearpath[_NUMBER_CLEARPATH_SERVOS];
+PRIVATE Servo_t CCMRAM clearpath[_NUMBER_CLEARPATH_SERVOS];
 
 PRIVATE const ServoHardware_t ServoHardwareMap[] = {
     [_CLEARPATH_1] = { .pin_enable    = _SERVO_1_ENABLE,
@@ -154,8 +156,21 @@ servo_stop( ClearpathServoInstance_t servo )
 
 /* -------------------------------------------------------------------------- */
 
-// Calculates and sets target position, constrains input to legal angles only
 PUBLIC void
+servo_emergency_stop( void )
+{
+    for( ClearpathServoInstance_t servo = _CLEARPATH_1; servo < _NUMBER_CLEARPATH_SERVOS; servo++ )
+    {
+        clearpath[servo].enabled = SERVO_DISABLE;
+        hal_gpio_write_pin( ServoHardwareMap[servo].pin_enable, SERVO_DISABLE );
+        hal_gpio_write_pin( ServoHardwareMap[servo].pin_step, false );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Calculates and sets target position, constrains input to legal angles only
+PUBLIC RAMFUNC void
 servo_set_target_angle_limited( ClearpathServoInstance_t servo, float angle_degrees )
 {
     Servo_t *me = &clearpath[servo];
@@ -222,8 +237,22 @@ servo_get_servo_did_error( ClearpathServoInstance_t servo )
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC float
+servo_step_rate_limit( void )
+{
+    // Pulses each motion pass may emit at the measured pass rate
+    float pass_rate = (float)( SERVO_PULSES_PER_PASS * app_background_motion_pass_rate() ) / 1000.0f;
+
+    // and what the pulse trains allow when every servo needs a full burst
+    float pulse_rate = 1000.0f / ( 2U * SERVO_PULSE_DURATION_US * _NUMBER_CLEARPATH_SERVOS );
+
+    return MIN( pass_rate, pulse_rate ) * SERVO_STEP_RATE_MARGIN_PERCENT / 100.0f;
+}
+
+/* -------------------------------------------------------------------------- */
+
 // Returns uncorrected servo feedback torque as a percentage from -100% to 100% of rated capability
-PRIVATE float
+PRIVATE RAMFUNC float
 servo_get_hlfb_percent( ClearpathServoInstance_t servo )
 {
 
@@ -241,7 +270,7 @@ servo_get_hlfb_percent( ClearpathServoInstance_t servo )
 }
 
 // Corrected servo feedback uses a trim value calculated during the arming procedure
-PRIVATE float
+PRIVATE RAMFUNC float
 servo_get_hlfb_percent_corrected( ClearpathServoInstance_t servo )
 {
     return servo_get_hlfb_percent( servo ) - clearpath[servo].ic_feedback_trim;
@@ -249,7 +278,7 @@ servo_get_hlfb_percent_corrected( ClearpathServoInstance_t servo )
 
 /* -------------------------------------------------------------------------- */
 
-PUBLIC void
+PUBLIC RAMFUNC void
 servo_process( ClearpathServoInstance_t servo )
 {
     Servo_t *me = &clearpath[servo];
@@ -564,9 +593,9 @@ servo_process( ClearpathServoInstance_t servo )
 
                 uint16_t pulses_needed = step_difference * step_direction;
 
-                if( pulses_needed > 8 )
+                if( pulses_needed > SERVO_PULSES_PER_PASS )
                 {
-                    pulses_needed = 8;
+                    pulses_needed = SERVO_PULSES_PER_PASS;
                     status_yellow( true );    // visual debugging aid to see when speed limits are hit
                 }
                 else
@@ -574,7 +603,8 @@ servo_process( ClearpathServoInstance_t servo )
                     status_yellow( false );
                 }
 
-                for( uint16_t pulses = 0; pulses < pulses_needed; pulses++ )
+                // An emergency stop can land part way through the burst
+                for( uint16_t pulses = 0; pulses < pulses_needed && me->enabled; pulses++ )
                 {
                     hal_gpio_toggle_pin( ServoHardwareMap[servo].pin_step );
                     hal_delay_us( SERVO_PULSE_DURATION_US );
@@ -615,7 +645,7 @@ servo_process( ClearpathServoInstance_t servo )
  * therefore we need to convert the angle into steps, and apply the adequate offset.
  * The servo's range is approx 2300 counts.
  */
-PRIVATE int16_t
+PRIVATE RAMFUNC int16_t
 convert_angle_steps( float kinematics_shoulder_angle )
 {
     float   converted_angle = kinematics_shoulder_angle + SERVO_MIN_ANGLE;
@@ -39,6 +39,13 @@ servo_stop( ClearpathServoInstance_t servo );
 
 /* -------------------------------------------------------------------------- */
 
+// Safe from an interrupt. Drops every enable line and cuts off any step
+// burst in progress, servo_process() then takes them into error recovery.
+PUBLIC void
+servo_emergency_stop( void );
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
 servo_set_target_angle_limited( ClearpathServoInstance_t servo, float angle_degrees );
 
@@ -59,6 +66,12 @@ servo_get_servo_did_error( ClearpathServoInstance_t servo );
 
 /* -------------------------------------------------------------------------- */
 
+// Fastest step rate a planned move may ask of any one servo, steps/ms
+PUBLIC float
+servo_step_rate_limit( void );
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
 servo_process( ClearpathServoInstance_t servo );
 
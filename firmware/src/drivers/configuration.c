@@ -5,7 +5,11 @@
 #include "configuration.h"
 #include "electricui.h"
 
+#include "app_background.h"
+#include "app_governor.h"
+#include "app_task_communication.h"
 #include "app_task_ids.h"
+#include "app_task_supervisor.h"
 #include "app_tasks.h"
 
 #include "app_events.h"
@@ -13,9 +17,21 @@
 #include "app_times.h"
 #include "app_version.h"
 #include "buzzer.h"
+#include "clearpath.h"
+#include "critical_section_audit.h"
 #include "event_subscribe.h"
+#include "fifo_benchmark.h"
+#include "flight_recorder.h"
+#include "gcode.h"
 #include "hal_flashmem.h"
+#include "hal_system_speed.h"
+#include "hal_systick.h"
+#include "hal_uart.h"
+#include "hal_usb.h"
 #include "hal_uuid.h"
+#include "hot_path_benchmark.h"
+#include "sequence_clock.h"
+#include "sequence_replay.h"
 
 typedef struct
 {
@@ -113,6 +129,47 @@ typedef struct
     uint8_t lighting;
 } QueueDepths_t;
 
+// Bump TELEMETRY_VERSION whenever the layout changes, the UI checks it
+#define TELEMETRY_VERSION 1U
+#define TELEMETRY_SERVOS  4U
+
+typedef enum
+{
+    TELEMETRY_FLAG_SUPERVISOR_ERROR = ( 1U << 0 ),
+    TELEMETRY_FLAG_SERVO_ERROR      = ( 1U << 1 ),    // a servo is recovering from a fault
+    TELEMETRY_FLAG_FAULT_RECORDED   = ( 1U << 2 ),    // the flight recorder holds an assert or fault
+    TELEMETRY_FLAG_COMMS_DROPPED    = ( 1U << 3 ),    // UART bytes were lost since the last frame
+} TelemetryFlags_t;
+
+// The live values gathered into one message. Each is the latest its source
+// has refreshed, so they don't all describe the same instant, e.g. the
+// temperatures update far less often than the servo feedback.
+typedef struct __attribute__( ( packed ) )
+{
+    uint8_t  version;
+    uint8_t  servo_count;    // servo entries in use
+    uint16_t sequence;
+    uint32_t timestamp_ms;
+    uint8_t  flags;    // TelemetryFlags_t
+    uint8_t  cpu_load;
+    uint8_t  queue_movements;
+    uint8_t  queue_lighting;
+    int32_t  position[3];                      // effector, microns
+    float    servo_angle[TELEMETRY_SERVOS];    // degrees
+    int16_t  servo_hlfb[TELEMETRY_SERVOS];     // 0.1% of rated torque
+    int16_t  servo_power[TELEMETRY_SERVOS];    // 0.1W
+    uint16_t input_mv;
+    int16_t  temperature[4];    // ambient, regulator, external probe, cpu in 0.1C
+} Telemetry_t;
+
+typedef struct
+{
+    uint16_t first_id;
+    uint16_t last_id;
+    float    scale;    // 0 keeps the current playback rate
+    uint8_t  repeats;
+} ReplayRequest_t;
+
 typedef struct
 {
     uint8_t enabled;
@@ -155,9 +212,39 @@ typedef struct
     int16_t balance_total;
 } LedSettings_t;
 
+// Power of two, at least twice the inbound messages to keep probes short
+#define CONFIG_INBOUND_SLOTS 32U
+
+typedef struct
+{
+    const char *id;
+    void ( *handler )( void );
+    bool needs_data;    // ignore the message when it arrives empty, i.e. a query
+} ConfigInbound_t;
+
 SystemData_t     sys_stats;
 BuildInfo_t      fw_info;
 Task_Info_t      task_info[TASK_MAX] = { 0 };
+CycleReport_t    task_cycles[TASK_MAX];
+CycleReport_t    background_cycles[BACKGROUND_NUM];
+CycleReport_t    isr_cycles[HAL_ISR_NUM];
+uint32_t         background_overruns[BACKGROUND_NUM];
+
+CriticalSectionAudit_t critical_audit;
+MemoryWatermarks_t     memory_marks;
+MemoryWatermarks_t     memory_marks_boot;    // left by the previous run
+LatencyReport_t        isr_latency;
+uint8_t                isr_latency_select;    // HalIsr_t shown in isr_latency
+HotPathBenchmark_t     hot_path_bench;
+FifoBenchmark_t        fifo_bench;
+GovernorStatus_t       governor_status;
+uint8_t                governor_enable = 1;
+uint32_t               uart_dropped[HAL_UART_NUM_PORTS];    // tx bytes refused per port
+uint32_t               uart_rx_dropped[HAL_UART_NUM_PORTS];    // rx bytes lost to a full FIFO per port
+CommsLatency_t         comms_latency;
+CommsLinkStats_t       link_stats[COMMS_LINK_NUM];
+HalUsbStats_t          usb_stats;
+HalUartStopLatency_t   estop_latency;
 KinematicsInfo_t mechanical_info;
 
 FanData_t  fan_stats;
@@ -184,6 +271,8 @@ MotorData_t  motion_servo[3];
 PowerCalibration_t power_trims;
 
 Movement_t       motion_inbound;
+ReplayRequest_t  replay_inbound;
+uint8_t          replay_retain = 0;
 CartesianPoint_t current_position;    //global position of end effector in cartesian space
 CartesianPoint_t target_position;
 
@@ -194,8 +283,27 @@ LedControl_t  rgb_manual_control;
 LedSettings_t rgb_led_settings;
 Fade_t        light_fade_inbound;
 
+// Uploads through the reliable transport, an alternative to "inmv" and "inlt"
+ReliableSegment_t reliable_inbound;
+ReliableStats_t   reliable_stats;
+
+// G-code text streamed in chunks, the host paces itself on the free space in "gc_stat"
+char         gcode_inbound[GCODE_CHUNK_MAX];
+GcodeStats_t gcode_status;
+
 float z_rotation = 0;
 
+FlightRecorderStatus_t flight_status;
+uint8_t                flight_page = 0;    // page of the flight recorder the UI wants next
+
+float time_scale_request = 1.0f;    // playback rate asked for by the UI
+float time_scale_current = 1.0f;    // playback rate after slewing and mechanism limits
+
+Telemetry_t telemetry_frame;
+uint16_t    telemetry_interval_ms = 0;    // 0 stops the periodic frame
+uint32_t    telemetry_sent_ms     = 0;
+uint32_t    telemetry_dropped     = 0;    // UART bytes lost as of the last frame
+
 char device_nickname[16] = "Zaphod Beeblebot";
 char reset_cause[20]     = "No Reset Cause";
 
@@ -205,6 +313,8 @@ PRIVATE void emergency_stop_cb( void );
 PRIVATE void home_mech_cb( void );
 PRIVATE void execute_motion_queue( void );
 PRIVATE void clear_all_queue( void );
+PRIVATE void hold_motion_queue( void );
+PRIVATE void resume_motion_queue( void );
 
 PRIVATE void rgb_manual_led_event( void );
 
@@ -213,13 +323,33 @@ PRIVATE void tracked_external_servo_request( void );
 PRIVATE void movement_generate_event( void );
 PRIVATE void lighting_generate_event( void );
 PRIVATE void sync_begin_queues( void );
+PRIVATE void replay_generate_event( void );
+PRIVATE void replay_clear_cb( void );
 PRIVATE void trigger_camera_capture( void );
+PRIVATE void flight_recorder_send_page( void );
+PRIVATE void flight_recorder_clear_cb( void );
+PRIVATE bool config_benchmark_allowed( void );
+PRIVATE void hot_path_benchmark_cb( void );
+PRIVATE void fifo_benchmark_cb( void );
+
+PRIVATE void mode_request_event( void );
+PRIVATE void time_scale_event( void );
+PRIVATE void replay_retain_event( void );
+PRIVATE void reliable_segment_event( void );
+PRIVATE void gcode_inbound_event( void );
+PRIVATE void gcode_reset_cb( void );
 
 PRIVATE void configuration_wipe( void );
+
+PRIVATE uint32_t configuration_id_hash( const char *id );
+PRIVATE void     configuration_build_inbound( void );
+PRIVATE const ConfigInbound_t *configuration_find_inbound( const char *id );
+
 uint16_t     sync_id_val  = 0;
 uint8_t      mode_request = 0;
 
 uint32_t camera_shutter_duration_ms = 0;
+uint16_t feed_hold_ramp_ms          = FEED_HOLD_RAMP_MS;
 
 eui_message_t ui_variables[] = {
     // Higher level system setup information
@@ -229,6 +359,56 @@ eui_message_t ui_variables[] = {
     EUI_CUSTOM( "super", sys_states ),
     EUI_CUSTOM( "fwb", fw_info ),
     EUI_CUSTOM( "tasks", task_info ),
+
+    // min/avg/max cycles per event, poll or interrupt since the last update
+    EUI_CUSTOM_RO( "cyc_task", task_cycles ),
+    EUI_CUSTOM_RO( "cyc_bg", background_cycles ),
+    EUI_CUSTOM_RO( "cyc_isr", isr_cycles ),
+    EUI_CUSTOM_RO( "bg_overrun", background_overruns ),
+
+    // longest interrupt masked window, needs a CRITICAL_SECTION_AUDIT build
+    EUI_CUSTOM_RO( "crit", critical_audit ),
+    EUI_FUNC( "crit_clr", critical_section_audit_clear ),
+
+    // halves the core clock while motion and lighting are idle
+    EUI_UINT8( "gov_en", governor_enable ),
+    EUI_CUSTOM_RO( "gov", governor_status ),
+
+    EUI_CUSTOM_RO( "uart_drop", uart_dropped ),
+    EUI_CUSTOM_RO( "uart_rx_drop", uart_rx_dropped ),
+
+    // worst wait for a command to be handled, and what queues behind it
+    EUI_CUSTOM_RO( "comm_lat", comms_latency ),
+    EUI_FUNC( "comm_lat_clr", AppTaskCommunication_latency_clear ),
+
+    // bytes moved and worst command wait per link, to compare UART and USB
+    EUI_CUSTOM_RO( "link_stat", link_stats ),
+    EUI_CUSTOM_RO( "usb_stat", usb_stats ),
+
+    // stop frames handled in the UART interrupt, and how long they took
+    EUI_CUSTOM_RO( "estop_lat", estop_latency ),
+    EUI_FUNC( "estop_lat_clr", hal_uart_stop_latency_clear ),
+
+    EUI_CUSTOM_RO( "mem", memory_marks ),
+    EUI_CUSTOM_RO( "mem_boot", memory_marks_boot ),
+
+    // trigger to handler latency histogram for the selected interrupt group,
+    // needs an ISR_LATENCY_PROFILE build
+    EUI_UINT8( "lat_isr", isr_latency_select ),
+    EUI_CUSTOM_RO( "lat", isr_latency ),
+    EUI_FUNC( "lat_clr", hal_system_speed_isr_latency_clear ),
+
+    // cycles per call for the motion maths, warm and straight after a flash
+    // cache flush, in_sram is false in HOT_PATH_IN_FLASH builds
+    EUI_CUSTOM_RO( "bench", hot_path_bench ),
+    EUI_FUNC( "bench_run", hot_path_benchmark_cb ),
+    EUI_CUSTOM_RO( "fifo_bench", fifo_bench ),
+    EUI_FUNC( "fifo_bench_run", fifo_benchmark_cb ),
+
+    // event history kept across resets, writing rec_page sends it as "rec_dump"
+    EUI_CUSTOM_RO( "rec", flight_status ),
+    EUI_UINT8( "rec_page", flight_page ),
+    EUI_FUNC( "rec_clr", flight_recorder_clear_cb ),
     EUI_CUSTOM_RO( "kinematics", mechanical_info ),
 
     // Temperature and cooling system
@@ -239,6 +419,10 @@ eui_message_t ui_variables[] = {
     EUI_UINT8( "fan_man_speed", fan_manual_setpoint ),
     EUI_UINT8( "fan_manual_en", fan_manual_enable ),
 
+    // latest of the live values batched every telem_ms, 0 to stop it
+    EUI_CUSTOM_RO( "telem", telemetry_frame ),
+    EUI_UINT16( "telem_ms", telemetry_interval_ms ),
+
     // motion related information
     EUI_CUSTOM_RO( "queue", queue_data ),
 
@@ -253,9 +437,22 @@ eui_message_t ui_variables[] = {
     //inbound movement buffer and 'add to queue' callback
     EUI_CUSTOM( "inlt", light_fade_inbound ),
     EUI_CUSTOM( "inmv", motion_inbound ),
+    EUI_CUSTOM( "rseg", reliable_inbound ),
+    EUI_CUSTOM( "gcode", gcode_inbound ),
+    EUI_CUSTOM_RO( "gc_stat", gcode_status ),
+    EUI_FUNC( "gc_reset", gcode_reset_cb ),
+    EUI_CUSTOM_RO( "rstat", reliable_stats ),
 
     EUI_FUNC( "stmv", execute_motion_queue ),
     EUI_FUNC( "clmv", clear_all_queue ),
+    EUI_FUNC( "hold", hold_motion_queue ),
+    EUI_FUNC( "resume", resume_motion_queue ),
+    EUI_UINT16( "hold_ms", feed_hold_ramp_ms ),
+
+    // retention of executed moves, and replay of a range of them
+    EUI_UINT8( "retain", replay_retain ),
+    EUI_CUSTOM( "replay", replay_inbound ),
+    EUI_FUNC( "replay_clr", replay_clear_cb ),
     EUI_FUNC( "sync", sync_begin_queues ),
     EUI_UINT16( "syncid", sync_id_val ),
 
@@ -274,6 +471,8 @@ eui_message_t ui_variables[] = {
     EUI_UINT8( "req_mode", mode_request ),
 
     EUI_FLOAT( "rotZ", z_rotation ),
+    EUI_FLOAT( "tscale", time_scale_request ),
+    EUI_FLOAT_RO( "tscale_now", time_scale_current ),
     EUI_UINT32( "capture", camera_shutter_duration_ms ),
 
     EUI_FUNC( "save", configuration_save ),
@@ -348,10 +547,40 @@ PRIVATE void configuration_wipe( void )
 
 /* -------------------------------------------------------------------------- */
 
+// Tracked messages that need more than a variable update when they arrive
+PRIVATE const ConfigInbound_t inbound_messages[] = {
+    { "req_mode", mode_request_event, false },
+    { "inmv", movement_generate_event, true },
+    { "inlt", lighting_generate_event, true },
+    { "rseg", reliable_segment_event, true },
+    { "gcode", gcode_inbound_event, false },
+    { "tpos", tracked_position_event, true },
+    { "exp_ang", tracked_external_servo_request, true },
+    { "hsv", rgb_manual_led_event, true },
+    { "ledset", rgb_manual_led_event, true },
+    { "capture", trigger_camera_capture, true },
+    { "tscale", time_scale_event, true },
+    { "retain", replay_retain_event, true },
+    { "replay", replay_generate_event, true },
+    { "rec_page", flight_recorder_send_page, true },
+};
+
+_Static_assert( ( CONFIG_INBOUND_SLOTS & ( CONFIG_INBOUND_SLOTS - 1U ) ) == 0U,
+                "inbound slots are masked, keep them a power of two" );
+_Static_assert( DIM( inbound_messages ) * 2U <= CONFIG_INBOUND_SLOTS,
+                "inbound slot table over half full, raise CONFIG_INBOUND_SLOTS" );
+
+// Open addressed on the ID hash, holds an index + 1 into inbound_messages[]
+PRIVATE uint8_t  inbound_link;      // link the message being handled came in on
+PRIVATE uint16_t inbound_length;    // and the bytes it carried
+PRIVATE uint8_t  inbound_slot[CONFIG_INBOUND_SLOTS];
+PRIVATE uint32_t inbound_hash[CONFIG_INBOUND_SLOTS];
+
 PUBLIC void
 configuration_electric_setup( void )
 {
     EUI_TRACK( ui_variables );
+    configuration_build_inbound();
     eui_setup_identifier( (char *)HAL_UUID, 12 );    //header byte is 96-bit, therefore 12-bytes
 }
 
@@ -364,68 +593,15 @@ configuration_eui_callback( uint8_t link, eui_interface_t *interface, uint8_t me
         case EUI_CB_TRACKED: {
             // UI received a tracked message ID and has completed processing
             eui_header_t header  = interface->packet.header;
-            void *       payload = interface->packet.data_in;
             uint8_t *    name_rx = interface->packet.id_in;
 
-            // See if the inbound packet name matches our intended variable
-            if( strcmp( (char *)name_rx, "req_mode" ) == 0 )
-            {
-
-                // Fire an event to the supervisor to change mode
-                switch( mode_request )
-                {
-                    case CONTROL_NONE:
-                        // TODO allow UI to request a no-mode setting?
-                        break;
-                    case CONTROL_MANUAL:
-                        eventPublish( EVENT_NEW( StateEvent, MODE_MANUAL ) );
-                        break;
-                    case CONTROL_EVENT:
-                        eventPublish( EVENT_NEW( StateEvent, MODE_EVENT ) );
-                        break;
-                    case CONTROL_DEMO:
-                        eventPublish( EVENT_NEW( StateEvent, MODE_DEMO ) );
-                        break;
-                    case CONTROL_TRACK:
-                        eventPublish( EVENT_NEW( StateEvent, MODE_TRACK ) );
-                        break;
-
-                    default:
-                        // Punish an incorrect attempt at mode changes with E-STOP
-                        eventPublish( EVENT_NEW( StateEvent, MOTION_EMERGENCY ) );
-                        break;
-                }
-            }
-
-            if( strcmp( (char *)name_rx, "inmv" ) == 0 && header.data_len )
-            {
-                movement_generate_event();
-            }
-
-            if( strcmp( (char *)name_rx, "inlt" ) == 0 && header.data_len )
-            {
-                lighting_generate_event();
-            }
-
-            if( strcmp( (char *)name_rx, "tpos" ) == 0 && header.data_len )
-            {
-                tracked_position_event();
-            }
-
-            if( strcmp( (char *)name_rx, "exp_ang" ) == 0 && header.data_len )
-            {
-                tracked_external_servo_request();
-            }
+            const ConfigInbound_t *inbound = configuration_find_inbound( (const char *)name_rx );
 
-            if( ( strcmp( (char *)name_rx, "hsv" ) == 0 || strcmp( (char *)name_rx, "ledset" ) == 0 )
-                && header.data_len )
+            if( inbound && ( header.data_len || !inbound->needs_data ) )
             {
-                rgb_manual_led_event();
-            }
-
-            if( strcmp( (char *)name_rx, "capture" ) == 0 && header.data_len )
-            {
-                trigger_camera_capture();
+                inbound_link   = link;
+                inbound_length = header.data_len;
+                inbound->handler();
             }
 
             break;
@@ -449,6 +625,67 @@ configuration_eui_callback( uint8_t link, eui_interface_t *interface, uint8_t me
 
 /* -------------------------------------------------------------------------- */
 
+// FNV-1a, IDs are at most 15 characters
+PRIVATE uint32_t
+configuration_id_hash( const char *id )
+{
+    uint32_t hash = 2166136261UL;
+
+    while( *id )
+    {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+PRIVATE void
+configuration_build_inbound( void )
+{
+    memset( inbound_slot, 0, sizeof( inbound_slot ) );
+
+    for( uint8_t i = 0; i < DIM( inbound_messages ); i++ )
+    {
+        uint32_t hash = configuration_id_hash( inbound_messages[i].id );
+        uint32_t slot = hash & ( CONFIG_INBOUND_SLOTS - 1U );
+
+        while( inbound_slot[slot] )
+        {
+            slot = ( slot + 1U ) & ( CONFIG_INBOUND_SLOTS - 1U );
+        }
+
+        inbound_slot[slot] = i + 1U;
+        inbound_hash[slot] = hash;
+    }
+}
+
+// One hash of the inbound ID and a single strcmp to confirm the match, however
+// many handlers there are. electricui has already matched the ID against
+// ui_variables[] by then, that scan still grows with the variables tracked.
+PRIVATE const ConfigInbound_t *
+configuration_find_inbound( const char *id )
+{
+    uint32_t hash = configuration_id_hash( id );
+    uint32_t slot = hash & ( CONFIG_INBOUND_SLOTS - 1U );
+
+    while( inbound_slot[slot] )
+    {
+        const ConfigInbound_t *inbound = &inbound_messages[inbound_slot[slot] - 1U];
+
+        if( inbound_hash[slot] == hash && strcmp( id, inbound->id ) == 0 )
+        {
+            return inbound;
+        }
+
+        slot = ( slot + 1U ) & ( CONFIG_INBOUND_SLOTS - 1U );
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
 config_set_reset_cause( const char *reset_description )
 {
@@ -486,6 +723,12 @@ config_set_cpu_clock( uint32_t clock )
     sys_stats.cpu_clock = clock / 1000000;    //convert to Mhz
 }
 
+PUBLIC bool
+config_get_governor_enabled( void )
+{
+    return ( governor_enable > 0 );
+}
+
 PUBLIC void
 config_update_task_statistics( void )
 {
@@ -503,11 +746,129 @@ config_update_task_statistics( void )
 
             memset( &task_info[id].name, 0, sizeof( task_info[0].name ) );
             strcpy( (char *)&task_info[id].name, t->name );
+
+            cycle_stats_take( &t->cycles, &task_cycles[id] );
         }
     }
+
+    for( BackgroundItem_t item = BACKGROUND_COMMS_RX; item < BACKGROUND_NUM; item++ )
+    {
+        app_background_cycles_report( item, &background_cycles[item] );
+        background_overruns[item] = app_background_overruns( item );
+    }
+
+    for( HalIsr_t isr = HAL_ISR_SYSTICK; isr < HAL_ISR_NUM; isr++ )
+    {
+        hal_system_speed_isr_report( isr, &isr_cycles[isr] );
+    }
+
+    hal_system_speed_isr_latency_report( MIN( isr_latency_select, HAL_ISR_NUM - 1 ), &isr_latency );
+
+    critical_section_audit_report( &critical_audit );
+
+    app_governor_status( &governor_status );
+
+    for( HalUartPort_t port = 0; port < HAL_UART_NUM_PORTS; port++ )
+    {
+        uart_dropped[port]    = hal_uart_tx_dropped( port );
+        uart_rx_dropped[port] = hal_uart_rx_dropped( port );
+    }
+
+    AppTaskCommunication_latency( &comms_latency );
+    AppTaskCommunication_link_stats( link_stats );
+    hal_usb_stats( &usb_stats );
+    hal_uart_stop_latency( &estop_latency );
+    AppTaskCommunication_reliable_stats( &reliable_stats );
+    gcode_stats( &gcode_status );
+
+    app_tasks_memory_watermarks( &memory_marks );
+    memory_watermark_previous( &memory_marks_boot );
     //app_task_clear_statistics();
 }
 
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+config_telemetry_gather( void )
+{
+    Telemetry_t *frame   = &telemetry_frame;
+    uint32_t     dropped = 0;
+
+    frame->version         = TELEMETRY_VERSION;
+    frame->servo_count     = DIM( motion_servo );
+    frame->sequence        = frame->sequence + 1U;
+    frame->timestamp_ms    = hal_systick_get_ms();
+    frame->flags           = 0;
+    frame->cpu_load        = sys_stats.cpu_load;
+    frame->queue_movements = queue_data.movements;
+    frame->queue_lighting  = queue_data.lighting;
+    frame->position[0]     = current_position.x;
+    frame->position[1]     = current_position.y;
+    frame->position[2]     = current_position.z;
+
+    for( uint8_t servo = 0; servo < TELEMETRY_SERVOS; servo++ )
+    {
+        bool fitted = ( servo < DIM( motion_servo ) );
+
+        frame->servo_angle[servo] = fitted ? motion_servo[servo].target_angle : 0.0f;
+        frame->servo_hlfb[servo]  = fitted ? motion_servo[servo].feedback : 0;
+        frame->servo_power[servo] = fitted ? (int16_t)( motion_servo[servo].power * 10.0f ) : 0;
+
+        if( fitted && servo_get_servo_did_error( servo ) )
+        {
+            frame->flags |= TELEMETRY_FLAG_SERVO_ERROR;
+        }
+    }
+
+    frame->input_mv       = (uint16_t)( sys_stats.input_voltage * 1000.0f );
+    frame->temperature[0] = (int16_t)( temp_sensors.pcb_ambient * 10.0f );
+    frame->temperature[1] = (int16_t)( temp_sensors.pcb_regulator * 10.0f );
+    frame->temperature[2] = (int16_t)( temp_sensors.external_probe * 10.0f );
+    frame->temperature[3] = (int16_t)( sys_stats.cpu_temp * 10.0f );
+
+    if( sys_states.supervisor == SUPERVISOR_ERROR )
+    {
+        frame->flags |= TELEMETRY_FLAG_SUPERVISOR_ERROR;
+    }
+
+    flight_recorder_status( &flight_status );
+
+    if( flight_status.fault_line )
+    {
+        frame->flags |= TELEMETRY_FLAG_FAULT_RECORDED;
+    }
+
+    for( HalUartPort_t port = 0; port < HAL_UART_NUM_PORTS; port++ )
+    {
+        dropped += hal_uart_tx_dropped( port ) + hal_uart_rx_dropped( port );
+    }
+
+    if( dropped != telemetry_dropped )
+    {
+        frame->flags |= TELEMETRY_FLAG_COMMS_DROPPED;
+        telemetry_dropped = dropped;
+    }
+}
+
+PUBLIC void
+config_telemetry_process( void )
+{
+    uint32_t now = hal_systick_get_ms();
+
+    if( telemetry_interval_ms == 0
+        || now - telemetry_sent_ms < MAX( telemetry_interval_ms, TELEMETRY_INTERVAL_MIN_MS ) )
+    {
+        return;
+    }
+
+    telemetry_sent_ms = now;
+
+    config_telemetry_gather();
+    eui_send_tracked( "telem" );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
 config_set_cpu_temp( float temp )
 {
@@ -693,6 +1054,18 @@ config_set_motion_queue_depth( uint8_t utilisation )
     //    eui_send_tracked("queue");
 }
 
+PUBLIC void
+config_set_time_scale( float scale )
+{
+    time_scale_current = scale;
+}
+
+PUBLIC float
+config_get_time_scale_request( void )
+{
+    return time_scale_request;
+}
+
 PUBLIC float
 config_get_rotation_z()
 {
@@ -867,6 +1240,69 @@ PRIVATE void clear_all_queue( void )
 {
     eventPublish( EVENT_NEW( StateEvent, MOTION_QUEUE_CLEAR ) );
     eventPublish( EVENT_NEW( StateEvent, LED_CLEAR_QUEUE ) );
+
+    // Otherwise the rest of the program refills the queue
+    gcode_reset( &current_position );
+}
+
+PRIVATE void hold_motion_queue( void )
+{
+    FeedHoldEvent *hold = EVENT_NEW( FeedHoldEvent, MOTION_QUEUE_HOLD );
+
+    if( hold )
+    {
+        hold->ramp_ms = feed_hold_ramp_ms;
+        eventPublish( (StateEvent *)hold );
+    }
+}
+
+PRIVATE void resume_motion_queue( void )
+{
+    FeedHoldEvent *resume = EVENT_NEW( FeedHoldEvent, MOTION_QUEUE_RESUME );
+
+    if( resume )
+    {
+        resume->ramp_ms = feed_hold_ramp_ms;
+        eventPublish( (StateEvent *)resume );
+    }
+}
+
+// Fire an event to the supervisor to change mode
+PRIVATE void mode_request_event( void )
+{
+    switch( mode_request )
+    {
+        case CONTROL_NONE:
+            // TODO allow UI to request a no-mode setting?
+            break;
+        case CONTROL_MANUAL:
+            eventPublish( EVENT_NEW( StateEvent, MODE_MANUAL ) );
+            break;
+        case CONTROL_EVENT:
+            eventPublish( EVENT_NEW( StateEvent, MODE_EVENT ) );
+            break;
+        case CONTROL_DEMO:
+            eventPublish( EVENT_NEW( StateEvent, MODE_DEMO ) );
+            break;
+        case CONTROL_TRACK:
+            eventPublish( EVENT_NEW( StateEvent, MODE_TRACK ) );
+            break;
+
+        default:
+            // Punish an incorrect attempt at mode changes with E-STOP
+            eventPublish( EVENT_NEW( StateEvent, MOTION_EMERGENCY ) );
+            break;
+    }
+}
+
+PRIVATE void time_scale_event( void )
+{
+    sequence_clock_set_scale( time_scale_request );
+}
+
+PRIVATE void replay_retain_event( void )
+{
+    sequence_replay_retain( replay_retain );
 }
 
 PRIVATE void tracked_position_event( void )
@@ -909,6 +1345,103 @@ PRIVATE void lighting_generate_event( void )
 
 /* -------------------------------------------------------------------------- */
 
+PRIVATE void reliable_segment_event( void )
+{
+    AppTaskCommunication_reliable_receive( inbound_link, &reliable_inbound );
+}
+
+// The payload size is part of the wire format, so it can't follow the types.
+// A Movement_t only fits with the one byte enums of the arm-none-eabi ABI.
+_Static_assert( RELIABLE_PAYLOAD_MAX >= sizeof( Movement_t ), "Movement_t outgrew a reliable segment" );
+_Static_assert( RELIABLE_PAYLOAD_MAX >= sizeof( Fade_t ), "Fade_t outgrew a reliable segment" );
+
+// Leave room in the queues for what's already on its way through the supervisor
+
+PUBLIC bool
+config_reliable_deliver( uint8_t channel, const uint8_t *payload )
+{
+    switch( channel )
+    {
+        case RELIABLE_CHANNEL_MOVEMENT: {
+            if( queue_data.movements + RELIABLE_WINDOW >= MOVEMENT_QUEUE_DEPTH_MAX )
+            {
+                return false;
+            }
+
+            MotionPlannerEvent *motion_request = EVENT_NEW( MotionPlannerEvent, MOVEMENT_REQUEST );
+
+            if( !motion_request )
+            {
+                return false;
+            }
+
+            memcpy( &motion_request->move, payload, sizeof( Movement_t ) );
+            eventPublish( (StateEvent *)motion_request );
+            return true;
+        }
+
+        case RELIABLE_CHANNEL_LIGHTING: {
+            if( queue_data.lighting + RELIABLE_WINDOW >= LED_QUEUE_DEPTH_MAX )
+            {
+                return false;
+            }
+
+            LightingPlannerEvent *lighting_request = EVENT_NEW( LightingPlannerEvent, LED_QUEUE_ADD );
+
+            if( !lighting_request )
+            {
+                return false;
+            }
+
+            memcpy( &lighting_request->animation, payload, sizeof( Fade_t ) );
+            eventPublish( (StateEvent *)lighting_request );
+            return true;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// An empty chunk just asks for the free space
+PRIVATE void gcode_inbound_event( void )
+{
+    gcode_write( (const uint8_t *)gcode_inbound, MIN( inbound_length, sizeof( gcode_inbound ) ) );
+    gcode_stats( &gcode_status );
+    eui_send_tracked( "gc_stat" );
+}
+
+PRIVATE void gcode_reset_cb( void )
+{
+    gcode_reset( &current_position );
+    gcode_stats( &gcode_status );
+}
+
+// Arcs expand into several moves, so the interpreter is held off sooner than the reliable transport
+
+PUBLIC bool
+config_gcode_deliver( const Movement_t *move )
+{
+    if( queue_data.movements + GCODE_QUEUE_HEADROOM >= MOVEMENT_QUEUE_DEPTH_MAX )
+    {
+        return false;
+    }
+
+    MotionPlannerEvent *motion_request = EVENT_NEW( MotionPlannerEvent, MOVEMENT_REQUEST );
+
+    if( !motion_request )
+    {
+        return false;
+    }
+
+    memcpy( &motion_request->move, move, sizeof( Movement_t ) );
+    eventPublish( (StateEvent *)motion_request );
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
 PRIVATE void sync_begin_queues( void )
 {
     BarrierSyncEvent *barrier_ev = EVENT_NEW( BarrierSyncEvent, START_QUEUE_SYNC );
@@ -921,6 +1454,26 @@ PRIVATE void sync_begin_queues( void )
     }
 }
 
+PRIVATE void replay_generate_event( void )
+{
+    ReplayEvent *replay_ev = EVENT_NEW( ReplayEvent, SEQUENCE_REPLAY );
+
+    if( replay_ev )
+    {
+        replay_ev->first_id = replay_inbound.first_id;
+        replay_ev->last_id  = replay_inbound.last_id;
+        replay_ev->scale    = replay_inbound.scale;
+        replay_ev->repeats  = replay_inbound.repeats;
+        eventPublish( (StateEvent *)replay_ev );
+        memset( &replay_inbound, 0, sizeof( replay_inbound ) );
+    }
+}
+
+PRIVATE void replay_clear_cb( void )
+{
+    sequence_replay_clear();
+}
+
 /* -------------------------------------------------------------------------- */
 PRIVATE void
 trigger_camera_capture( void )
@@ -935,4 +1488,70 @@ trigger_camera_capture( void )
     }
 }
 
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+flight_recorder_send_page( void )
+{
+    FlightRecord_t records[FLIGHT_RECORDER_PAGE];
+    uint8_t        count = flight_recorder_read_page( flight_page, records );
+
+    // An empty page tells the UI it has read past the oldest record
+    eui_message_t page_message = { .id   = "rec_dump",
+                                   .type = TYPE_CUSTOM,
+                                   .size = count * sizeof( FlightRecord_t ),
+                                   { .data = records } };
+
+    eui_send_untracked( &page_message );
+
+    flight_recorder_status( &flight_status );
+    eui_send_tracked( "rec" );
+}
+
+PRIVATE void
+flight_recorder_clear_cb( void )
+{
+    flight_recorder_clear();
+    flight_recorder_status( &flight_status );
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Benchmarks block the comms task while they run, only allow them while disarmed
+PRIVATE bool
+config_benchmark_allowed( void )
+{
+    if( sys_states.supervisor != SUPERVISOR_IDLE )
+    {
+        config_report_error( "Benchmark refused - disarm first" );
+        return false;
+    }
+
+    return true;
+}
+
+PRIVATE void
+hot_path_benchmark_cb( void )
+{
+    if( !config_benchmark_allowed() )
+    {
+        return;
+    }
+
+    hot_path_benchmark_run( &hot_path_bench );
+    eui_send_tracked( "bench" );
+}
+
+PRIVATE void
+fifo_benchmark_cb( void )
+{
+    if( !config_benchmark_allowed() )
+    {
+        return;
+    }
+
+    fifo_benchmark_run( &fifo_bench );
+    eui_send_tracked( "fifo_bench" );
+}
+
 /* ----- End ---------------------------------------------------------------- */
@@ -82,9 +82,17 @@ config_set_cpu_load( uint8_t percent );
 PUBLIC void
 config_set_cpu_clock( uint32_t clock );
 
+PUBLIC bool
+config_get_governor_enabled( void );
+
 PUBLIC void
 config_update_task_statistics( void );
 
+/** Send a telemetry frame when the interval the UI asked for has passed */
+
+PUBLIC void
+config_telemetry_process( void );
+
 PUBLIC void
 config_set_cpu_temp( float temp );
 
@@ -172,6 +180,29 @@ config_set_motion_state( uint8_t status );
 PUBLIC void
 config_set_motion_queue_depth( uint8_t utilisation );
 
+/** Queue a reliable transport segment for its channel, see
+ *  AppTaskCommunication_reliable_receive(). Returns false to hold it back
+ *  while the queue is nearly full.
+ */
+
+PUBLIC bool
+config_reliable_deliver( uint8_t channel, const uint8_t *payload );
+
+/** Queue a move interpreted from streamed G-code. Returns false to hold it
+ *  back while the queue is nearly full.
+ */
+
+PUBLIC bool
+config_gcode_deliver( const Movement_t *move );
+
+PUBLIC void
+config_set_time_scale( float scale );
+
+/** Playback rate last asked for with "tscale" */
+
+PUBLIC float
+config_get_time_scale_request( void );
+
 PUBLIC float
 config_get_rotation_z();
 
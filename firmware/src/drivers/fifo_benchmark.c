@@ -0,0 +1,162 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "fifo.h"
+#include "fifo_benchmark.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define FIFO_BENCHMARK_SIZE   256U
+#define FIFO_BENCHMARK_CHUNK  64U
+#define FIFO_BENCHMARK_BYTES  4096U
+#define FIFO_BENCHMARK_PASSES 4U
+
+// The FIFO this one replaced, kept as the baseline
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t capacity;
+} LegacyFifo_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+PRIVATE uint8_t benchmark_storage[FIFO_BENCHMARK_SIZE];
+PRIVATE uint8_t benchmark_source[FIFO_BENCHMARK_CHUNK];
+PRIVATE uint8_t benchmark_sink[FIFO_BENCHMARK_CHUNK];
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE uint32_t
+fifo_benchmark_legacy( void );
+
+PRIVATE uint32_t
+fifo_benchmark_bytewise( void );
+
+PRIVATE uint32_t
+fifo_benchmark_bulk( void );
+
+PRIVATE uint32_t
+fifo_benchmark_rate( uint32_t ( *transfer )( void ) );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+fifo_benchmark_run( FifoBenchmark_t *result )
+{
+    for( uint32_t i = 0; i < FIFO_BENCHMARK_CHUNK; i++ )
+    {
+        benchmark_source[i] = (uint8_t)i;
+    }
+
+    result->legacy   = fifo_benchmark_rate( fifo_benchmark_legacy );
+    result->bytewise = fifo_benchmark_rate( fifo_benchmark_bytewise );
+    result->bulk     = fifo_benchmark_rate( fifo_benchmark_bulk );
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+// Best of a few passes, so an interrupt landing in one doesn't count
+PRIVATE uint32_t
+fifo_benchmark_rate( uint32_t ( *transfer )( void ) )
+{
+    uint32_t fastest = UINT32_MAX;
+
+    for( uint32_t pass = 0; pass < FIFO_BENCHMARK_PASSES; pass++ )
+    {
+        fastest = MIN( fastest, transfer() );
+    }
+
+    return (uint32_t)( ( FIFO_BENCHMARK_BYTES * 1000ULL ) / MAX( fastest, 1U ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE uint32_t
+fifo_benchmark_legacy( void )
+{
+    LegacyFifo_t f = { .buf = benchmark_storage, .head = 0, .tail = 0, .capacity = FIFO_BENCHMARK_SIZE };
+
+    uint32_t started = CYCLE_COUNT();
+
+    for( uint32_t sent = 0; sent < FIFO_BENCHMARK_BYTES; sent += FIFO_BENCHMARK_CHUNK )
+    {
+        for( uint32_t i = 0; i < FIFO_BENCHMARK_CHUNK; i++ )
+        {
+            uint32_t next = f.head + 1U;
+
+            if( next >= f.capacity )
+            {
+                next = 0;
+            }
+
+            if( next != f.tail )
+            {
+                f.buf[f.head] = benchmark_source[i];
+                f.head        = next;
+            }
+        }
+
+        for( uint32_t i = 0; i < FIFO_BENCHMARK_CHUNK && f.tail != f.head; i++ )
+        {
+            benchmark_sink[i] = f.buf[f.tail];
+
+            if( ++f.tail >= f.capacity )
+            {
+                f.tail = 0;
+            }
+        }
+    }
+
+    return CYCLE_COUNT() - started;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE uint32_t
+fifo_benchmark_bytewise( void )
+{
+    fifo_t f;
+    fifo_init( &f, benchmark_storage, FIFO_BENCHMARK_SIZE );
+
+    uint32_t started = CYCLE_COUNT();
+
+    for( uint32_t sent = 0; sent < FIFO_BENCHMARK_BYTES; sent += FIFO_BENCHMARK_CHUNK )
+    {
+        for( uint32_t i = 0; i < FIFO_BENCHMARK_CHUNK; i++ )
+        {
+            fifo_put( &f, benchmark_source[i] );
+        }
+
+        for( uint32_t i = 0; i < FIFO_BENCHMARK_CHUNK && fifo_get( &f, &benchmark_sink[i] ); i++ )
+        {
+        }
+    }
+
+    return CYCLE_COUNT() - started;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE uint32_t
+fifo_benchmark_bulk( void )
+{
+    fifo_t f;
+    fifo_init( &f, benchmark_storage, FIFO_BENCHMARK_SIZE );
+
+    uint32_t started = CYCLE_COUNT();
+
+    for( uint32_t sent = 0; sent < FIFO_BENCHMARK_BYTES; sent += FIFO_BENCHMARK_CHUNK )
+    {
+        fifo_write( &f, benchmark_source, FIFO_BENCHMARK_CHUNK );
+        fifo_read( &f, benchmark_sink, FIFO_BENCHMARK_CHUNK );
+    }
+
+    return CYCLE_COUNT() - started;
+}
+
+/* ----- End ---------------------------------------------------------------- */
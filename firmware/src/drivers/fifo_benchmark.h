@@ -0,0 +1,39 @@
+#ifndef FIFO_BENCHMARK_H
+#define FIFO_BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+// Bytes pushed through a FIFO and back out per 1000 core cycles
+typedef struct
+{
+    uint32_t legacy;      // byte at a time with modulo indexing, as fifo.c used to
+    uint32_t bytewise;    // fifo_put() and fifo_get()
+    uint32_t bulk;        // fifo_write() and fifo_read()
+} FifoBenchmark_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Stream a few kB through each FIFO implementation in packet sized chunks,
+ *  as the UART pumps do. Takes well under a ms.
+ */
+
+PUBLIC void
+fifo_benchmark_run( FifoBenchmark_t *result );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIFO_BENCHMARK_H */
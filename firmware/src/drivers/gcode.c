@@ -0,0 +1,835 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <math.h>
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "gcode.h"
+
+#include "app_times.h"
+#include "fifo.h"
+
+#include "clearpath.h"
+#include "configuration.h"
+#include "path_interpolator.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define GCODE_MICRONS_PER_MM   1000.0f
+#define GCODE_MICRONS_PER_INCH 25400.0f
+
+#define GCODE_WORD_BIT( letter_ ) ( 1UL << ( ( letter_ ) - 'A' ) )
+
+// Words other than G that a line can carry. E, K, M, N, T and S outside of a dwell are ignored.
+#define GCODE_WORDS_ACCEPTED                                                                                      \
+    ( GCODE_WORD_BIT( 'E' ) | GCODE_WORD_BIT( 'F' ) | GCODE_WORD_BIT( 'I' ) | GCODE_WORD_BIT( 'J' )              \
+      | GCODE_WORD_BIT( 'K' ) | GCODE_WORD_BIT( 'M' ) | GCODE_WORD_BIT( 'N' ) | GCODE_WORD_BIT( 'P' )            \
+      | GCODE_WORD_BIT( 'R' ) | GCODE_WORD_BIT( 'S' ) | GCODE_WORD_BIT( 'T' ) | GCODE_WORD_BIT( 'X' )            \
+      | GCODE_WORD_BIT( 'Y' ) | GCODE_WORD_BIT( 'Z' ) )
+
+typedef enum
+{
+    GCODE_RAPID = 0,
+    GCODE_LINEAR,
+    GCODE_ARC_CW,
+    GCODE_ARC_CCW,
+    GCODE_MOTION_NONE,
+} GcodeMotion_t;
+
+typedef enum
+{
+    GCODE_COMMAND_NONE = 0,
+    GCODE_COMMAND_LINE,
+    GCODE_COMMAND_ARC,
+    GCODE_COMMAND_DWELL,
+} GcodeCommandType_t;
+
+// A line that expands into one or more moves, handed on a segment at a time
+typedef struct
+{
+    GcodeCommandType_t type;
+    uint16_t           segment;     // next one to hand on
+    uint16_t           segments;    // moves the command is split into
+    CartesianPoint_t   from;
+    CartesianPoint_t   to;
+    mm_per_second_t    speed;       // lines
+    uint32_t           duration;    // arcs: per segment, dwells: in total, milliseconds
+    float              centre_x;    // arcs, in microns
+    float              centre_y;
+    float              radius;
+    float              angle;    // of the start point around the centre
+    float              sweep;    // signed, positive is counter-clockwise
+} GcodeCommand_t;
+
+// Words found on one line
+typedef struct
+{
+    uint32_t      seen;    // GCODE_WORD_BIT per letter
+    float         value[26];
+    GcodeMotion_t motion;
+    bool          dwell;
+    bool          set_origin;
+    uint8_t       units;       // 20 or 21 when the line changes them
+    uint8_t       distance;    // 90 or 91 when the line changes it
+} GcodeWords_t;
+
+typedef struct
+{
+    fifo_t  text;
+    uint8_t text_buffer[GCODE_BUFFER_SIZE];
+
+    char    line[GCODE_LINE_MAX + 1];
+    uint8_t line_length;
+    bool    line_overflow;    // too long, thrown away up to the newline
+
+    // Modal state
+    GcodeMotion_t    motion;
+    bool             relative;
+    float            scale;       // microns per program unit
+    float            feed;        // mm/second
+    CartesianPoint_t position;    // where the moves handed on so far finish
+    CartesianPoint_t offset;      // from program to machine co-ordinates, set by G92
+
+    GcodeCommand_t command;
+    uint16_t       identifier;    // of the last move handed on
+    bool           reported;      // the first error has been passed to the UI
+
+    GcodeStats_t stats;
+} Gcode_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+PRIVATE Gcode_t gcode;
+
+PRIVATE bool
+gcode_read_line( void );
+
+PRIVATE bool
+gcode_parse_number( const char **cursor, float *value );
+
+PRIVATE bool
+gcode_parse_line( const char *line, GcodeWords_t *words );
+
+PRIVATE bool
+gcode_execute( GcodeWords_t *words );
+
+PRIVATE bool
+gcode_plan_line( CartesianPoint_t *target, mm_per_second_t speed );
+
+PRIVATE bool
+gcode_plan_arc( GcodeWords_t *words, CartesianPoint_t *target, bool clockwise );
+
+PRIVATE void
+gcode_command_move( GcodeCommand_t *command, Movement_t *move );
+
+PRIVATE mm_per_second_t
+gcode_feed_speed( void );
+
+PRIVATE void
+gcode_error( void );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+gcode_init( void )
+{
+    CartesianPoint_t origin = { 0, 0, 0 };
+
+    memset( &gcode, 0, sizeof( gcode ) );
+    gcode_reset( &origin );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+gcode_reset( CartesianPoint_t *origin )
+{
+    fifo_init( &gcode.text, gcode.text_buffer, sizeof( gcode.text_buffer ) );
+
+    gcode.line_length   = 0;
+    gcode.line_overflow = false;
+
+    gcode.motion   = GCODE_LINEAR;
+    gcode.relative = false;
+    gcode.scale    = GCODE_MICRONS_PER_MM;
+    gcode.feed     = GCODE_FEED_DEFAULT;
+
+    memcpy( &gcode.position, origin, sizeof( CartesianPoint_t ) );
+    memset( &gcode.offset, 0, sizeof( gcode.offset ) );
+    memset( &gcode.command, 0, sizeof( gcode.command ) );
+    memset( &gcode.stats, 0, sizeof( gcode.stats ) );
+
+    gcode.reported = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+gcode_write( const uint8_t *text, uint32_t length )
+{
+    uint32_t taken = fifo_write( &gcode.text, text, length );
+
+    gcode.stats.received += taken;
+    gcode.stats.dropped += length - taken;
+
+    return taken;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+gcode_process( void )
+{
+    for( uint8_t step = 0; step < GCODE_STEPS_PER_POLL; step++ )
+    {
+        GcodeCommand_t *command = &gcode.command;
+
+        if( command->type != GCODE_COMMAND_NONE )
+        {
+            Movement_t move;
+
+            gcode_command_move( command, &move );
+            move.identifier = gcode.identifier + 1U;
+
+            // Queue is full, the same segment goes again next pass
+            if( !config_gcode_deliver( &move ) )
+            {
+                return;
+            }
+
+            gcode.identifier++;
+            gcode.stats.moves++;
+
+            command->segment++;
+
+            if( command->segment >= command->segments )
+            {
+                command->type = GCODE_COMMAND_NONE;
+            }
+        }
+        else if( gcode_read_line() )
+        {
+            GcodeWords_t words;
+
+            gcode.stats.lines++;
+
+            if( !gcode_parse_line( gcode.line, &words ) || !gcode_execute( &words ) )
+            {
+                gcode_error();
+            }
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+gcode_stats( GcodeStats_t *report )
+{
+    memcpy( report, &gcode.stats, sizeof( GcodeStats_t ) );
+
+    report->free = fifo_free( &gcode.text );
+    report->busy = fifo_used( &gcode.text ) || gcode.line_length || gcode.command.type != GCODE_COMMAND_NONE;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+// Collect the next whole line, whitespace removed. Partial lines wait for the rest of their text.
+
+PRIVATE bool
+gcode_read_line( void )
+{
+    uint8_t ch;
+
+    while( fifo_get( &gcode.text, &ch ) )
+    {
+        if( ch == '\n' )
+        {
+            bool overflowed = gcode.line_overflow;
+
+            gcode.line[gcode.line_length] = '\0';
+            gcode.line_length             = 0;
+            gcode.line_overflow           = false;
+
+            if( overflowed )
+            {
+                gcode.stats.lines++;
+                gcode_error();
+                continue;
+            }
+
+            return true;
+        }
+
+        if( ch == ' ' || ch == '\t' || ch == '\r' )
+        {
+            continue;
+        }
+
+        if( gcode.line_length < GCODE_LINE_MAX )
+        {
+            gcode.line[gcode.line_length++] = (char)ch;
+        }
+        else
+        {
+            gcode.line_overflow = true;
+        }
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+gcode_parse_number( const char **cursor, float *value )
+{
+    const char *c        = *cursor;
+    bool        negative = false;
+    bool        fraction = false;
+    bool        digits   = false;
+    uint32_t    mantissa = 0;
+    float       divisor  = 1.0f;
+
+    if( *c == '-' || *c == '+' )
+    {
+        negative = ( *c == '-' );
+        c++;
+    }
+
+    for( ;; c++ )
+    {
+        if( *c >= '0' && *c <= '9' )
+        {
+            digits = true;
+
+            // Digits past float precision are dropped from the fraction
+            if( mantissa < 100000000UL )
+            {
+                mantissa = mantissa * 10U + (uint32_t)( *c - '0' );
+                divisor *= fraction ? 10.0f : 1.0f;
+            }
+            else if( !fraction )
+            {
+                return false;
+            }
+        }
+        else if( *c == '.' && !fraction )
+        {
+            fraction = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if( !digits )
+    {
+        return false;
+    }
+
+    *value  = (float)mantissa / divisor;
+    *value  = negative ? -*value : *value;
+    *cursor = c;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+gcode_parse_line( const char *line, GcodeWords_t *words )
+{
+    const char *c = line;
+
+    memset( words, 0, sizeof( GcodeWords_t ) );
+    words->motion = GCODE_MOTION_NONE;
+
+    while( *c )
+    {
+        char letter = *c++;
+
+        // Comments, checksum and program delimiters
+        if( letter == ';' || letter == '*' )
+        {
+            break;
+        }
+
+        if( letter == '(' )
+        {
+            while( *c && *c != ')' )
+            {
+                c++;
+            }
+
+            c += ( *c == ')' );
+            continue;
+        }
+
+        if( letter == '%' )
+        {
+            continue;
+        }
+
+        if( letter >= 'a' && letter <= 'z' )
+        {
+            letter = (char)( letter - 'a' + 'A' );
+        }
+
+        float value = 0.0f;
+
+        if( letter < 'A' || letter > 'Z' || !gcode_parse_number( &c, &value ) )
+        {
+            return false;
+        }
+
+        if( letter != 'G' )
+        {
+            if( !( GCODE_WORDS_ACCEPTED & GCODE_WORD_BIT( letter ) ) )
+            {
+                return false;
+            }
+
+            words->seen |= GCODE_WORD_BIT( letter );
+            words->value[letter - 'A'] = value;
+            continue;
+        }
+
+        // G90.1 and friends aren't supported
+        int32_t code = (int32_t)value;
+
+        if( (float)code != value )
+        {
+            return false;
+        }
+
+        switch( code )
+        {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                words->motion = (GcodeMotion_t)code;
+                break;
+
+            case 4:
+                words->dwell = true;
+                break;
+
+            case 17:
+                break;
+
+            case 20:
+            case 21:
+                words->units = (uint8_t)code;
+                break;
+
+            case 90:
+            case 91:
+                words->distance = (uint8_t)code;
+                break;
+
+            case 92:
+                words->set_origin = true;
+                break;
+
+            default:
+                // Arcs in the XZ or YZ plane, canned cycles, homing, etc
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+gcode_execute( GcodeWords_t *words )
+{
+    if( words->units )
+    {
+        gcode.scale = ( words->units == 20 ) ? GCODE_MICRONS_PER_INCH : GCODE_MICRONS_PER_MM;
+    }
+
+    if( words->distance )
+    {
+        gcode.relative = ( words->distance == 91 );
+    }
+
+    // Feed is in program units per minute
+    if( words->seen & GCODE_WORD_BIT( 'F' ) )
+    {
+        float feed = words->value['F' - 'A'] * gcode.scale / ( GCODE_MICRONS_PER_MM * 60.0f );
+
+        if( feed <= 0.0f )
+        {
+            return false;
+        }
+
+        gcode.feed = feed;
+    }
+
+    if( words->dwell )
+    {
+        float dwell_ms = 0.0f;
+
+        if( words->seen & GCODE_WORD_BIT( 'P' ) )
+        {
+            dwell_ms = words->value['P' - 'A'];
+        }
+        else if( words->seen & GCODE_WORD_BIT( 'S' ) )
+        {
+            dwell_ms = words->value['S' - 'A'] * 1000.0f;
+        }
+
+        if( dwell_ms < 0.0f )
+        {
+            return false;
+        }
+
+        GcodeCommand_t *command = &gcode.command;
+
+        memset( command, 0, sizeof( GcodeCommand_t ) );
+        command->duration = (uint32_t)lroundf( dwell_ms );
+        command->segments = (uint16_t)( command->duration / UINT16_MAX + 1U );
+        command->type     = command->duration ? GCODE_COMMAND_DWELL : GCODE_COMMAND_NONE;
+
+        return true;
+    }
+
+    uint32_t axes = words->seen & ( GCODE_WORD_BIT( 'X' ) | GCODE_WORD_BIT( 'Y' ) | GCODE_WORD_BIT( 'Z' ) );
+
+    CartesianPoint_t target = gcode.position;
+    int32_t *        axis_target[3]   = { &target.x, &target.y, &target.z };
+    int32_t *        axis_position[3] = { &gcode.position.x, &gcode.position.y, &gcode.position.z };
+    int32_t *        axis_offset[3]   = { &gcode.offset.x, &gcode.offset.y, &gcode.offset.z };
+
+    for( uint8_t axis = 0; axis < 3; axis++ )
+    {
+        char letter = (char)( 'X' + axis );
+
+        if( !( words->seen & GCODE_WORD_BIT( letter ) ) )
+        {
+            continue;
+        }
+
+        int32_t microns = (int32_t)lroundf( words->value[letter - 'A'] * gcode.scale );
+
+        if( words->set_origin )
+        {
+            // The effector stays put, the program's co-ordinates move around it
+            *axis_offset[axis] = *axis_position[axis] - microns;
+        }
+        else if( gcode.relative )
+        {
+            *axis_target[axis] = *axis_position[axis] + microns;
+        }
+        else
+        {
+            *axis_target[axis] = *axis_offset[axis] + microns;
+        }
+    }
+
+    if( words->set_origin )
+    {
+        return true;
+    }
+
+    if( words->motion != GCODE_MOTION_NONE )
+    {
+        gcode.motion = words->motion;
+    }
+
+    // Modal changes or a new feed on their own
+    if( !axes )
+    {
+        return true;
+    }
+
+    switch( gcode.motion )
+    {
+        case GCODE_RAPID:
+            return gcode_plan_line( &target, GCODE_RAPID_SPEED );
+
+        case GCODE_LINEAR:
+            return gcode_plan_line( &target, gcode_feed_speed() );
+
+        case GCODE_ARC_CW:
+        case GCODE_ARC_CCW:
+            return gcode_plan_arc( words, &target, ( gcode.motion == GCODE_ARC_CW ) );
+
+        default:
+            return false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+gcode_plan_line( CartesianPoint_t *target, mm_per_second_t speed )
+{
+    GcodeCommand_t *command = &gcode.command;
+
+    if( memcmp( target, &gcode.position, sizeof( CartesianPoint_t ) ) == 0 )
+    {
+        return true;
+    }
+
+    uint32_t duration = cartesian_duration_for_speed( &gcode.position, target, speed ) + 1U;
+
+    memset( command, 0, sizeof( GcodeCommand_t ) );
+    command->type     = GCODE_COMMAND_LINE;
+    command->segments = (uint16_t)( duration / UINT16_MAX + 1U );
+    command->from     = gcode.position;
+    command->to       = *target;
+    command->speed    = speed;
+
+    gcode.position = *target;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Arcs are split into sections of at most a quarter turn, each drawn as a cubic bezier.
+// Control points sit on the tangents, 4/3 tan(sweep/4) of the radius out.
+
+PRIVATE bool
+gcode_plan_arc( GcodeWords_t *words, CartesianPoint_t *target, bool clockwise )
+{
+    GcodeCommand_t *command = &gcode.command;
+
+    float start_x  = (float)gcode.position.x;
+    float start_y  = (float)gcode.position.y;
+    float end_x    = (float)target->x;
+    float end_y    = (float)target->y;
+    float centre_x = 0.0f;
+    float centre_y = 0.0f;
+
+    if( words->seen & ( GCODE_WORD_BIT( 'I' ) | GCODE_WORD_BIT( 'J' ) ) )
+    {
+        // Centre offsets are always from the start point
+        centre_x = start_x + words->value['I' - 'A'] * gcode.scale;
+        centre_y = start_y + words->value['J' - 'A'] * gcode.scale;
+    }
+    else if( words->seen & GCODE_WORD_BIT( 'R' ) )
+    {
+        float radius = words->value['R' - 'A'] * gcode.scale;
+        float dx     = end_x - start_x;
+        float dy     = end_y - start_y;
+        float chord  = sqrtf( dx * dx + dy * dy );
+
+        // A full circle needs the centre given explicitly
+        if( chord < 1.0f )
+        {
+            return false;
+        }
+
+        float height_sq = radius * radius - chord * chord / 4.0f;
+        float height    = sqrtf( MAX( height_sq, 0.0f ) ) / chord;
+
+        if( height_sq < -( GCODE_ARC_TOLERANCE * chord ) )
+        {
+            return false;
+        }
+
+        // Centre to the left of the chord for anti-clockwise, the long way round for a negative R
+        height = ( clockwise != ( radius < 0.0f ) ) ? -height : height;
+
+        centre_x = start_x + dx / 2.0f - height * dy;
+        centre_y = start_y + dy / 2.0f + height * dx;
+    }
+    else
+    {
+        return false;
+    }
+
+    float radius     = hypotf( start_x - centre_x, start_y - centre_y );
+    float end_radius = hypotf( end_x - centre_x, end_y - centre_y );
+
+    if( radius < 1.0f || fabsf( radius - end_radius ) > GCODE_ARC_TOLERANCE )
+    {
+        return false;
+    }
+
+    float angle = atan2f( start_y - centre_y, start_x - centre_x );
+    float sweep = atan2f( end_y - centre_y, end_x - centre_x ) - angle;
+
+    // Same start and end point is a full circle
+    if( clockwise && sweep >= 0.0f )
+    {
+        sweep -= 2.0f * (float)M_PI;
+    }
+    else if( !clockwise && sweep <= 0.0f )
+    {
+        sweep += 2.0f * (float)M_PI;
+    }
+
+    float    length   = hypotf( radius * fabsf( sweep ), (float)( target->z - gcode.position.z ) );
+    uint32_t duration = (uint32_t)( length / (float)gcode_feed_speed() ) + 1U;
+    uint32_t sections = (uint32_t)ceilf( fabsf( sweep ) / ( (float)M_PI / 2.0f ) );
+
+    memset( command, 0, sizeof( GcodeCommand_t ) );
+    command->type     = GCODE_COMMAND_ARC;
+    command->segments = (uint16_t)MAX( sections, duration / UINT16_MAX + 1U );
+    command->from     = gcode.position;
+    command->to       = *target;
+    command->duration = duration / command->segments + 1U;
+    command->centre_x = centre_x;
+    command->centre_y = centre_y;
+    command->radius   = radius;
+    command->angle    = angle;
+    command->sweep    = sweep;
+
+    gcode.position = *target;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+gcode_command_move( GcodeCommand_t *command, Movement_t *move )
+{
+    float start = (float)command->segment / command->segments;
+    float end   = (float)( command->segment + 1U ) / command->segments;
+    bool  last  = ( command->segment + 1U == command->segments );
+
+    memset( move, 0, sizeof( Movement_t ) );
+    move->ref = _POS_ABSOLUTE;
+
+    switch( command->type )
+    {
+        case GCODE_COMMAND_LINE: {
+            move->type    = _LINE;
+            move->num_pts = 2;
+
+            cartesian_find_point_on_line( &command->from, &command->to, &move->points[_LINE_START], start );
+
+            if( last )
+            {
+                move->points[_LINE_END] = command->to;
+            }
+            else
+            {
+                cartesian_find_point_on_line( &command->from, &command->to, &move->points[_LINE_END], end );
+            }
+
+            uint32_t duration = cartesian_duration_for_speed( &move->points[_LINE_START], &move->points[_LINE_END],
+                                                              command->speed )
+                                + 1U;
+
+            move->duration = (uint16_t)MIN( duration, UINT16_MAX );
+            break;
+        }
+
+        case GCODE_COMMAND_ARC: {
+            float theta   = command->sweep / command->segments;
+            float angle_a = command->angle + theta * command->segment;
+            float angle_b = angle_a + theta;
+            float handle  = 4.0f / 3.0f * tanf( theta / 4.0f ) * command->radius;
+            float z_a     = command->from.z + ( command->to.z - command->from.z ) * start;
+            float z_b     = command->from.z + ( command->to.z - command->from.z ) * end;
+
+            CartesianPoint_t *p = move->points;
+
+            move->type    = _BEZIER_CUBIC;
+            move->num_pts = 4;
+
+            p[_CUBIC_START].x = (int32_t)lroundf( command->centre_x + command->radius * cosf( angle_a ) );
+            p[_CUBIC_START].y = (int32_t)lroundf( command->centre_y + command->radius * sinf( angle_a ) );
+            p[_CUBIC_START].z = (int32_t)lroundf( z_a );
+
+            p[_CUBIC_END].x = (int32_t)lroundf( command->centre_x + command->radius * cosf( angle_b ) );
+            p[_CUBIC_END].y = (int32_t)lroundf( command->centre_y + command->radius * sinf( angle_b ) );
+            p[_CUBIC_END].z = (int32_t)lroundf( z_b );
+
+            // Join exactly onto the moves either side
+            if( command->segment == 0 )
+            {
+                p[_CUBIC_START] = command->from;
+            }
+
+            if( last )
+            {
+                p[_CUBIC_END] = command->to;
+            }
+
+            p[_CUBIC_CONTROL_A].x = p[_CUBIC_START].x - (int32_t)lroundf( handle * sinf( angle_a ) );
+            p[_CUBIC_CONTROL_A].y = p[_CUBIC_START].y + (int32_t)lroundf( handle * cosf( angle_a ) );
+            p[_CUBIC_CONTROL_A].z = (int32_t)lroundf( z_a + ( z_b - z_a ) / 3.0f );
+
+            p[_CUBIC_CONTROL_B].x = p[_CUBIC_END].x + (int32_t)lroundf( handle * sinf( angle_b ) );
+            p[_CUBIC_CONTROL_B].y = p[_CUBIC_END].y - (int32_t)lroundf( handle * cosf( angle_b ) );
+            p[_CUBIC_CONTROL_B].z = (int32_t)lroundf( z_a + ( z_b - z_a ) * 2.0f / 3.0f );
+
+            move->duration = (uint16_t)MIN( command->duration, UINT16_MAX );
+            break;
+        }
+
+        case GCODE_COMMAND_DWELL: {
+            // Stay put, relative to wherever the effector is
+            uint32_t share = command->duration / command->segments;
+
+            move->type     = _POINT_TRANSIT;
+            move->ref      = _POS_RELATIVE;
+            move->num_pts  = 1;
+            move->duration = (uint16_t)( share + ( command->segment < command->duration % command->segments ) );
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    // The motion task refuses moves the servos can't step fast enough for, so slow the feed to suit
+    if( move->ref == _POS_ABSOLUTE )
+    {
+        float step_rate = path_interpolator_step_rate( move );
+        float limit     = servo_step_rate_limit();
+
+        if( step_rate > limit )
+        {
+            uint32_t duration = (uint32_t)ceilf( move->duration * step_rate / limit ) + 1U;
+
+            move->duration = (uint16_t)MIN( duration, UINT16_MAX );
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// The motion task rejects anything at or over the effector speed limit
+
+PRIVATE mm_per_second_t
+gcode_feed_speed( void )
+{
+    float speed = MIN( gcode.feed, (float)( EFFECTOR_SPEED_LIMIT - 1U ) );
+
+    return (mm_per_second_t)MAX( speed, 1.0f );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+gcode_error( void )
+{
+    gcode.stats.errors++;
+    gcode.stats.error_line = gcode.stats.lines;
+
+    // The counters carry the rest, a bad file would flood the UI otherwise
+    if( !gcode.reported )
+    {
+        gcode.reported = true;
+        config_report_error( "G-code line skipped" );
+    }
+}
+
+/* ----- End ---------------------------------------------------------------- */
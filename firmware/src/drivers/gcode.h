@@ -0,0 +1,69 @@
+#ifndef GCODE_H
+#define GCODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+#include "motion_types.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t received;      // bytes of text taken since the last reset, the host counts its credit from this
+    uint32_t moves;         // moves handed to the motion queue
+    uint32_t lines;         // lines interpreted
+    uint32_t error_line;    // line number of the most recent error
+    uint16_t free;          // room left for text
+    uint16_t errors;        // lines skipped as malformed or unsupported
+    uint16_t dropped;       // bytes that arrived without credit and were thrown away
+    uint8_t  busy;          // text or moves still waiting on the motion queue
+    uint8_t  reserved;
+} GcodeStats_t;
+
+/* -------------------------------------------------------------------------- */
+
+// Streamed G-code text is interpreted into movement requests as the motion queue makes room.
+// Handles G0/G1 lines, G2/G3 arcs in the XY plane, G4 dwells, F, G17, G20/G21, G90/G91 and G92.
+// Line numbers, M, S, T and E words are ignored, anything else skips the line as an error.
+
+PUBLIC void
+gcode_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Discard buffered text and unfinished moves, and restore the modal defaults.
+// The program starts from origin, normally where the effector is now.
+PUBLIC void
+gcode_reset( CartesianPoint_t *origin );
+
+/* -------------------------------------------------------------------------- */
+
+// Append text to the stream, returns the bytes taken. Anything over the free space is dropped.
+PUBLIC uint32_t
+gcode_write( const uint8_t *text, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+// Interpret buffered lines and hand their moves on while the motion queue has room
+PUBLIC void
+gcode_process( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+gcode_stats( GcodeStats_t *report );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GCODE_H */
@@ -0,0 +1,134 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#ifdef STM32F429xx
+#include "stm32f4xx_ll_system.h"
+#endif
+
+#include "hot_path_benchmark.h"
+#include "kinematics.h"
+#include "motion_types.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define HOT_PATH_BENCHMARK_PASSES 32U
+
+typedef KinematicsSolution_t ( *HotPathEvaluator_t )( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output );
+
+/* ----- Private Variables -------------------------------------------------- */
+
+// A representative move inside the working volume
+PRIVATE CartesianPoint_t benchmark_points[] = {
+    { MM_TO_MICRONS( -40 ), MM_TO_MICRONS( -30 ), MM_TO_MICRONS( 20 ) },
+    { MM_TO_MICRONS( -10 ), MM_TO_MICRONS( 45 ), MM_TO_MICRONS( 60 ) },
+    { MM_TO_MICRONS( 25 ), MM_TO_MICRONS( -20 ), MM_TO_MICRONS( 40 ) },
+    { MM_TO_MICRONS( 50 ), MM_TO_MICRONS( 35 ), MM_TO_MICRONS( 10 ) },
+};
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE void
+hot_path_benchmark_reset_caches( void );
+
+PRIVATE void
+hot_path_benchmark_evaluator( HotPathEvaluator_t evaluator, size_t points, HotPathTiming_t *timing );
+
+PRIVATE void
+hot_path_benchmark_kinematics( HotPathTiming_t *timing );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+hot_path_benchmark_run( HotPathBenchmark_t *result )
+{
+    memset( result, 0, sizeof( HotPathBenchmark_t ) );
+
+    hot_path_benchmark_evaluator( cartesian_point_on_line, 2, &result->line );
+    hot_path_benchmark_evaluator( cartesian_point_on_catmull_spline, 4, &result->catmull_spline );
+    hot_path_benchmark_evaluator( cartesian_point_on_quadratic_bezier, 3, &result->quadratic_bezier );
+    hot_path_benchmark_evaluator( cartesian_point_on_cubic_bezier, 4, &result->cubic_bezier );
+    hot_path_benchmark_kinematics( &result->kinematics );
+
+#if defined( STM32F429xx ) && !defined( HOT_PATH_IN_FLASH )
+    result->in_sram = true;
+#endif
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+// Drop whatever the ART accelerator holds, as happens on the real hot path
+// when the rest of the main loop runs between motion ticks
+PRIVATE void
+hot_path_benchmark_reset_caches( void )
+{
+#ifdef STM32F429xx
+    LL_FLASH_DisableInstCache();
+    LL_FLASH_DisableDataCache();
+    LL_FLASH_EnableInstCacheReset();
+    LL_FLASH_EnableDataCacheReset();
+    LL_FLASH_DisableInstCacheReset();
+    LL_FLASH_DisableDataCacheReset();
+    LL_FLASH_EnableInstCache();
+    LL_FLASH_EnableDataCache();
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hot_path_benchmark_evaluator( HotPathEvaluator_t evaluator, size_t points, HotPathTiming_t *timing )
+{
+    CartesianPoint_t output = { 0, 0, 0 };
+    uint32_t         cold   = 0;
+
+    timing->cycles = UINT32_MAX;
+
+    for( uint32_t pass = 0; pass < HOT_PATH_BENCHMARK_PASSES; pass++ )
+    {
+        float weight = (float)pass / HOT_PATH_BENCHMARK_PASSES;
+
+        hot_path_benchmark_reset_caches();
+        uint32_t started = CYCLE_COUNT();
+        evaluator( benchmark_points, points, weight, &output );
+        cold += CYCLE_COUNT() - started;
+
+        started = CYCLE_COUNT();
+        evaluator( benchmark_points, points, weight, &output );
+        timing->cycles = MIN( timing->cycles, CYCLE_COUNT() - started );
+    }
+
+    timing->cold = cold / HOT_PATH_BENCHMARK_PASSES;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hot_path_benchmark_kinematics( HotPathTiming_t *timing )
+{
+    CartesianPoint_t target = { 0, 0, 0 };
+    JointAngles_t    angles = { 0, 0, 0 };
+    uint32_t         cold   = 0;
+
+    timing->cycles = UINT32_MAX;
+
+    for( uint32_t pass = 0; pass < HOT_PATH_BENCHMARK_PASSES; pass++ )
+    {
+        cartesian_point_on_line( benchmark_points, DIM( benchmark_points ), (float)pass / HOT_PATH_BENCHMARK_PASSES, &target );
+
+        hot_path_benchmark_reset_caches();
+        uint32_t started = CYCLE_COUNT();
+        kinematics_point_to_angle( target, &angles );
+        cold += CYCLE_COUNT() - started;
+
+        started = CYCLE_COUNT();
+        kinematics_point_to_angle( target, &angles );
+        timing->cycles = MIN( timing->cycles, CYCLE_COUNT() - started );
+    }
+
+    timing->cold = cold / HOT_PATH_BENCHMARK_PASSES;
+}
+
+/* ----- End ---------------------------------------------------------------- */
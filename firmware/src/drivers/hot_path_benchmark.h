@@ -0,0 +1,49 @@
+#ifndef HOT_PATH_BENCHMARK_H
+#define HOT_PATH_BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+// Cycles per call of each motion hot path stage
+typedef struct
+{
+    uint32_t cycles;    // fastest call with the flash caches warm
+    uint32_t cold;      // average call straight after the flash caches are reset
+} HotPathTiming_t;
+
+typedef struct
+{
+    HotPathTiming_t line;
+    HotPathTiming_t catmull_spline;
+    HotPathTiming_t quadratic_bezier;
+    HotPathTiming_t cubic_bezier;
+    HotPathTiming_t kinematics;
+    uint8_t         in_sram;    // the build runs the hot path from SRAM
+} HotPathBenchmark_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Time the path evaluators and inverse kinematics. Blocks for a few ms, so
+ *  only run it while the delta is idle. Compare against a HOT_PATH_IN_FLASH
+ *  build to see what the placement gains.
+ */
+
+PUBLIC void
+hot_path_benchmark_run( HotPathBenchmark_t *result );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOT_PATH_BENCHMARK_H */
@@ -91,7 +91,7 @@ kinematics_init( void )
  * - Calculate a scalar to clamp illegal positions to the circle radius
  */
 
-PRIVATE void
+PRIVATE RAMFUNC void
 kinematics_clamp_volume( CartesianPoint_t *point )
 {
     // Check 'height' is within the bounds
@@ -132,7 +132,7 @@ kinematics_clamp_volume( CartesianPoint_t *point )
  * Returns status
  */
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 kinematics_point_to_angle( CartesianPoint_t input, JointAngles_t *output )
 {
     // Apply an optional rotation around the Z axis
@@ -237,7 +237,7 @@ kinematics_angle_to_point( JointAngles_t input, CartesianPoint_t *output )
 /* -------------------------------------------------------------------------- */
 
 // helper functions, calculates angle theta1 (for YZ-pane)
-PRIVATE KinematicsSolution_t
+PRIVATE RAMFUNC KinematicsSolution_t
 delta_angle_plane_calc( float x0, float y0, float z0, float *theta )
 {
     float y1 = -0.5f * 0.57735f * f;    // f/2 * tg 30
@@ -52,7 +52,7 @@ led_enable( bool enable )
 
 // Input 3 float [0-1] values for RGB color channels in linear space
 // Applies luma and whitebalance correction
-PUBLIC void
+PUBLIC RAMFUNC void
 led_set( float r, float g, float b )
 {
     float setpoint_r = led_luminance_correct( r );
@@ -79,7 +79,7 @@ led_set( float r, float g, float b )
 
 /* -------------------------------------------------------------------------- */
 
-PRIVATE float
+PRIVATE RAMFUNC float
 led_luminance_correct( float input )
 {
     float lightness = input * 100;
@@ -106,7 +106,7 @@ led_luminance_correct( float input )
 
 /* -------------------------------------------------------------------------- */
 
-PRIVATE void
+PRIVATE RAMFUNC void
 led_whitebalance_correct( float *red, float *green, float *blue )
 {
     int16_t wb_r, wb_g, wb_b = 0;
@@ -120,7 +120,7 @@ led_whitebalance_correct( float *red, float *green, float *blue )
 
 /* -------------------------------------------------------------------------- */
 
-PRIVATE float
+PRIVATE RAMFUNC float
 led_power_limit()
 {
     int16_t limit = 0;
@@ -12,6 +12,7 @@
 #include "app_times.h"
 #include "event_subscribe.h"
 #include "hal_systick.h"
+#include "sequence_clock.h"
 #include "simple_state_machine.h"
 
 #include "configuration.h"
@@ -51,7 +52,7 @@ typedef struct
 
 /* ----- Private Variables -------------------------------------------------- */
 
-PRIVATE LEDPlanner_t planner;
+PRIVATE LEDPlanner_t CCMRAM planner;
 
 PRIVATE void
 led_interpolator_calculate_percentage( uint16_t fade_duration );
@@ -246,7 +247,7 @@ led_interpolator_process( void )
         case ANIMATION_EXECUTE_A:
             STATE_ENTRY_ACTION
             config_set_led_status( me->currentState );
-            me->animation_started      = hal_systick_get_ms();
+            me->animation_started      = sequence_clock_get_ms();
             me->animation_est_complete = me->animation_started + me->fade_a.duration;
             me->progress_percent       = 0;
             STATE_TRANSITION_TEST
@@ -282,7 +283,7 @@ led_interpolator_process( void )
         case ANIMATION_EXECUTE_B:
             STATE_ENTRY_ACTION
             config_set_led_status( me->currentState );
-            me->animation_started      = hal_systick_get_ms();
+            me->animation_started      = sequence_clock_get_ms();
             me->animation_est_complete = me->animation_started + me->fade_b.duration;
             me->progress_percent       = 0;
             STATE_TRANSITION_TEST
@@ -342,7 +343,7 @@ led_interpolator_calculate_percentage( uint16_t fade_duration )
 
     // calculate current target completion based on time elapsed
     // time remaining is the allotted duration - time used (start to now), divide by the duration to get 0.0->1.0 progress
-    uint32_t time_used = hal_systick_get_ms() - me->animation_started;
+    uint32_t time_used = sequence_clock_get_ms() - me->animation_started;
 
     if( fade_duration )
     {
@@ -436,7 +437,7 @@ hsi_lerp_linear( HSIColour_t p[], size_t points, float pos_weight, HSIColour_t *
  * Input HSI are [0, 1]
  * Output RGB are [0, 1]
  */
-void hsi_to_rgb( float h, float s, float i, float *r, float *g, float *b )
+RAMFUNC void hsi_to_rgb( float h, float s, float i, float *r, float *g, float *b )
 {
     float q;
     float p;
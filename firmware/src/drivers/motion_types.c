@@ -38,7 +38,7 @@ cartesian_duration_for_speed( CartesianPoint_t *a, CartesianPoint_t *b, mm_per_s
 
 // Input two points in 3D space (*a and *b), and 0.0f to 1.0f 'percentage' on the line to find
 // Writes the resultant point into *p
-PUBLIC void
+PUBLIC RAMFUNC void
 cartesian_find_point_on_line( CartesianPoint_t *a, CartesianPoint_t *b, CartesianPoint_t *p, float weight )
 {
     p->x = a->x + ( ( b->x - a->x ) * weight );
@@ -48,7 +48,7 @@ cartesian_find_point_on_line( CartesianPoint_t *a, CartesianPoint_t *b, Cartesia
 
 /* -------------------------------------------------------------------------- */
 
-PUBLIC void
+PUBLIC RAMFUNC void
 cartesian_point_rotate_around_z( CartesianPoint_t *a, float degrees )
 {
     float radians = degrees * M_PI / 180.0f;
@@ -184,7 +184,7 @@ cartesian_plan_smoothed_line( Movement_t *movement, float start_weight, float en
 // rel_weight is the 0.0-1.0 percentage position on the line
 // the output pointer is the interpolated position on the line
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 cartesian_point_on_line( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output )
 {
     if( points < 2 )
@@ -220,7 +220,7 @@ cartesian_point_on_line( CartesianPoint_t *p, size_t points, float pos_weight, C
 // rel_weight is the 0.0-1.0 percentage position on the curve between p1 and p2
 // the output pointer is the interpolated position on the curve between p1 and p2
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 cartesian_point_on_catmull_spline( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output )
 {
     if( points < 4 )
@@ -270,7 +270,7 @@ cartesian_point_on_catmull_spline( CartesianPoint_t *p, size_t points, float pos
 // rel_weight is the 0.0-1.0 percentage position on the curve between p0 and p2
 // the output pointer is the interpolated position on the curve between p0 and p2
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 cartesian_point_on_quadratic_bezier( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output )
 {
     if( points < 3 )
@@ -316,7 +316,7 @@ cartesian_point_on_quadratic_bezier( CartesianPoint_t *p, size_t points, float p
 // rel_weight is the 0.0-1.0 percentage position on the curve between p0 and p2
 // the output pointer is the interpolated position on the curve between p0 and p2
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 cartesian_point_on_cubic_bezier( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output )
 {
     if( points < 4 )
@@ -365,7 +365,7 @@ cartesian_point_on_cubic_bezier( CartesianPoint_t *p, size_t points, float pos_w
 // the output pointer is the interpolated position on the curve between p0 and p1
 // https://blender.stackexchange.com/questions/42131/modelling-a-spiral-around-a-sphere/42159
 
-PUBLIC KinematicsSolution_t
+PUBLIC RAMFUNC KinematicsSolution_t
 cartesian_point_on_spiral( CartesianPoint_t *p, size_t points, float pos_weight, CartesianPoint_t *output )
 {
     if( points < 1 )
@@ -1,19 +1,20 @@
 /* ----- System Includes ---------------------------------------------------- */
 
 #include <float.h>
+#include <math.h>
 #include <string.h>
 
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "path_interpolator.h"
 
-#include "app_events.h"
 #include "app_signals.h"
 #include "event_subscribe.h"
 #include "global.h"
 #include "simple_state_machine.h"
 
-#include "hal_systick.h"
+#include "app_times.h"
+#include "sequence_clock.h"
 
 #include "clearpath.h"
 #include "configuration.h"
@@ -48,16 +49,33 @@ typedef struct
 
 } MotionPlanner_t;
 
+typedef struct
+{
+    uint32_t started;                                // number of moves which have started execution
+    uint32_t completed;                              // number of moves which have finished execution
+    uint16_t started_id[PATHING_HISTORY_DEPTH];      // recent move ID's, indexed by sequence number
+    uint16_t completed_id[PATHING_HISTORY_DEPTH];    // recent move ID's, indexed by sequence number
+} PathingProgress_t;
+
 /* ----- Private Variables -------------------------------------------------- */
 
-PRIVATE MotionPlanner_t planner;
+PRIVATE MotionPlanner_t CCMRAM planner;
+
+// Kept apart from the planner so cursors held by tasks stay valid across a planner reset
+PRIVATE PathingProgress_t CCMRAM progress;
+
+// Statically allocated so start/complete notifications never draw from the event pools
+PRIVATE StateEvent pathing_progress_event = { (Signal)PATHING_PROGRESS, { 0, 0 } };
 
 PRIVATE void path_interpolator_premove_transforms( Movement_t *move );
+PRIVATE void path_interpolator_point_on_move( Movement_t *move, float percentage, CartesianPoint_t *target );
+PRIVATE void path_interpolator_limit_timescale( Movement_t *move );
 PRIVATE void path_interpolator_execute_move( Movement_t *move, float percentage );
 PRIVATE void path_interpolator_calculate_percentage( uint16_t move_duration );
 
 PRIVATE void path_interpolator_notify_pathing_started( uint16_t move_id );
 PRIVATE void path_interpolator_notify_pathing_complete( uint16_t move_id );
+PRIVATE bool path_interpolator_cursor_advance( uint32_t *cursor, uint32_t sequence, const uint16_t history[], uint16_t *move_id );
 
 /* ----- Public Functions --------------------------------------------------- */
 
@@ -99,6 +117,16 @@ path_interpolator_is_ready_for_next( void )
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC bool
+path_interpolator_is_empty( void )
+{
+    bool slot_a_empty = ( planner.move_a.duration == 0 );
+    bool slot_b_empty = ( planner.move_b.duration == 0 );
+    return ( slot_a_empty && slot_b_empty );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC float
 path_interpolator_get_progress( void )
 {
@@ -107,7 +135,7 @@ path_interpolator_get_progress( void )
 
 /* -------------------------------------------------------------------------- */
 
-PUBLIC bool
+PUBLIC RAMFUNC bool
 path_interpolator_get_move_done( void )
 {
     return ( planner.progress_percent >= 1.0f - FLT_EPSILON ) || planner.enable == false;
@@ -115,14 +143,15 @@ path_interpolator_get_move_done( void )
 
 /* -------------------------------------------------------------------------- */
 
-PRIVATE void
+PRIVATE RAMFUNC void
 path_interpolator_calculate_percentage( uint16_t move_duration )
 {
     MotionPlanner_t *me = &planner;
 
     // calculate current target completion based on time elapsed
     // time remaining is the allotted duration - time used (start to now), divide by the duration to get 0.0->1.0 progress
-    uint32_t time_used = hal_systick_get_ms() - me->movement_started;
+    // time runs on the sequence clock, so the playback rate scales progress
+    uint32_t time_used = sequence_clock_get_ms() - me->movement_started;
 
     if( move_duration )
     {
@@ -179,16 +208,81 @@ path_interpolator_set_home( void )
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC float
+path_interpolator_step_rate( Movement_t *move )
+{
+    // Sample the joint angles along the path to find the fastest step rate the move needs
+    JointAngles_t    previous_angles = { 0, 0, 0 };
+    JointAngles_t    angles          = { 0, 0, 0 };
+    CartesianPoint_t sample          = { 0, 0, 0 };
+    float            max_degrees     = 0.0f;
+
+    if( !move->duration )
+    {
+        return 0.0f;
+    }
+
+    path_interpolator_point_on_move( move, 0.0f, &sample );
+    kinematics_point_to_angle( sample, &previous_angles );
+
+    for( uint8_t i = 1; i <= SPEED_SAMPLE_RESOLUTION; i++ )
+    {
+        path_interpolator_point_on_move( move, (float)i / SPEED_SAMPLE_RESOLUTION, &sample );
+        kinematics_point_to_angle( sample, &angles );
+
+        max_degrees = MAX( max_degrees, fabsf( angles.a1 - previous_angles.a1 ) );
+        max_degrees = MAX( max_degrees, fabsf( angles.a2 - previous_angles.a2 ) );
+        max_degrees = MAX( max_degrees, fabsf( angles.a3 - previous_angles.a3 ) );
+
+        previous_angles = angles;
+    }
+
+    float sample_ms = (float)move->duration / SPEED_SAMPLE_RESOLUTION;
+
+    return max_degrees * SERVO_STEPS_PER_DEGREE / sample_ms;    // steps/ms at realtime
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void
+path_interpolator_cursor_sync( PathingCursor_t *cursor )
+{
+    cursor->started   = progress.started;
+    cursor->completed = progress.completed;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+path_interpolator_next_started( PathingCursor_t *cursor, uint16_t *move_id )
+{
+    return path_interpolator_cursor_advance( &cursor->started, progress.started, progress.started_id, move_id );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+path_interpolator_next_completed( PathingCursor_t *cursor, uint16_t *move_id )
+{
+    return path_interpolator_cursor_advance( &cursor->completed, progress.completed, progress.completed_id, move_id );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC RAMFUNC void
 path_interpolator_process( void )
 {
     MotionPlanner_t *me = &planner;
 
+    // Snapshot the sequence counters so this pass raises at most one progress notification
+    uint32_t sequence_before = progress.started + progress.completed;
+
     switch( me->currentState )
     {
         case PLANNER_OFF:
             STATE_ENTRY_ACTION
             config_set_pathing_status( me->currentState );
+            sequence_clock_clear_limit();
             STATE_TRANSITION_TEST
             if( planner.enable )
             {
@@ -211,7 +305,8 @@ path_interpolator_process( void )
             path_interpolator_notify_pathing_started( me->move_a.identifier );
 
             path_interpolator_premove_transforms( &me->move_a );
-            me->movement_started      = hal_systick_get_ms();
+            path_interpolator_limit_timescale( &me->move_a );
+            me->movement_started      = sequence_clock_get_ms();
             me->movement_est_complete = me->movement_started + me->move_a.duration;
             me->progress_percent      = 0;
             STATE_TRANSITION_TEST
@@ -250,7 +345,8 @@ path_interpolator_process( void )
             path_interpolator_notify_pathing_started( me->move_b.identifier );
 
             path_interpolator_premove_transforms( &me->move_b );
-            me->movement_started      = hal_systick_get_ms();
+            path_interpolator_limit_timescale( &me->move_b );
+            me->movement_started      = sequence_clock_get_ms();
             me->movement_est_complete = me->movement_started + me->move_b.duration;
             me->progress_percent      = 0;
             STATE_TRANSITION_TEST
@@ -283,6 +379,13 @@ path_interpolator_process( void )
             STATE_END
             break;
     }
+
+    // Coalesce any starts/completions from this pass into a single notification,
+    // subscribers read the ID's back with their cursors
+    if( progress.started + progress.completed != sequence_before )
+    {
+        eventPublish( &pathing_progress_event );
+    }
 }
 
 PRIVATE void
@@ -317,38 +420,73 @@ path_interpolator_premove_transforms( Movement_t *move )
     }
 }
 
-PRIVATE void
-path_interpolator_execute_move( Movement_t *move, float percentage )
+PRIVATE RAMFUNC void
+path_interpolator_point_on_move( Movement_t *move, float percentage, CartesianPoint_t *target )
 {
-    CartesianPoint_t target       = { 0, 0, 0 };    //target position in cartesian space
-    JointAngles_t    angle_target = { 0, 0, 0 };    //target motor shaft angle in degrees
-
     switch( move->type )
     {
         case _POINT_TRANSIT:
-            cartesian_point_on_line( move->points, move->num_pts, percentage, &target );
+            cartesian_point_on_line( move->points, move->num_pts, percentage, target );
             break;
 
         case _LINE:
-            cartesian_point_on_line( move->points, move->num_pts, percentage, &target );
+            cartesian_point_on_line( move->points, move->num_pts, percentage, target );
             break;
 
         case _CATMULL_SPLINE:
-            cartesian_point_on_catmull_spline( move->points, move->num_pts, percentage, &target );
+            cartesian_point_on_catmull_spline( move->points, move->num_pts, percentage, target );
             break;
 
         case _BEZIER_QUADRATIC:
-            cartesian_point_on_quadratic_bezier( move->points, move->num_pts, percentage, &target );
+            cartesian_point_on_quadratic_bezier( move->points, move->num_pts, percentage, target );
             break;
 
         case _BEZIER_CUBIC:
-            cartesian_point_on_cubic_bezier( move->points, move->num_pts, percentage, &target );
+            cartesian_point_on_cubic_bezier( move->points, move->num_pts, percentage, target );
             break;
         default:
             //TODO this should be considered a motion error
 
             break;
     }
+}
+
+PRIVATE void
+path_interpolator_limit_timescale( Movement_t *move )
+{
+    // Highest playback rate which keeps the effector under the speed limit
+    float   ceiling = FLT_MAX;
+    int32_t speed   = cartesian_move_speed( move );
+
+    if( speed > 0 )
+    {
+        ceiling = (float)EFFECTOR_SPEED_LIMIT / speed;
+    }
+
+    float step_rate = path_interpolator_step_rate( move );
+    float limit     = servo_step_rate_limit();
+
+    if( step_rate > 0.0f )
+    {
+        ceiling = MIN( ceiling, limit / step_rate );
+    }
+
+    // Moves with a known start are refused when queued, this catches relative moves and transits
+    if( step_rate > limit )
+    {
+        config_report_error( "Move exceeds step rate" );
+    }
+
+    sequence_clock_limit_scale( ceiling );
+}
+
+PRIVATE RAMFUNC void
+path_interpolator_execute_move( Movement_t *move, float percentage )
+{
+    CartesianPoint_t target       = { 0, 0, 0 };    //target position in cartesian space
+    JointAngles_t    angle_target = { 0, 0, 0 };    //target motor shaft angle in degrees
+
+    path_interpolator_point_on_move( move, percentage, &target );
 
     // Calculate a motor angle solution for the cartesian position
     kinematics_point_to_angle( target, &angle_target );
@@ -367,21 +505,38 @@ path_interpolator_execute_move( Movement_t *move, float percentage )
 PRIVATE void
 path_interpolator_notify_pathing_started( uint16_t move_id )
 {
-    BarrierSyncEvent *barrier_ev = EVENT_NEW( BarrierSyncEvent, PATHING_STARTED );
-    uint16_t          publish_id = move_id;
-
-    memcpy( &barrier_ev->id, &publish_id, sizeof( move_id ) );
-    eventPublish( (StateEvent *)barrier_ev );
+    progress.started_id[progress.started & ( PATHING_HISTORY_DEPTH - 1 )] = move_id;
+    progress.started++;
 }
 
 PRIVATE void
 path_interpolator_notify_pathing_complete( uint16_t move_id )
 {
-    BarrierSyncEvent *barrier_ev = EVENT_NEW( BarrierSyncEvent, PATHING_COMPLETE );
-    uint16_t          publish_id = move_id;
+    progress.completed_id[progress.completed & ( PATHING_HISTORY_DEPTH - 1 )] = move_id;
+    progress.completed++;
+}
+
+PRIVATE bool
+path_interpolator_cursor_advance( uint32_t *cursor, uint32_t sequence, const uint16_t history[], uint16_t *move_id )
+{
+    if( *cursor == sequence )
+    {
+        return false;
+    }
+
+    // A reader which fell further behind than the history depth skips to the oldest retained ID
+    if( sequence - *cursor > PATHING_HISTORY_DEPTH )
+    {
+        *cursor = sequence - PATHING_HISTORY_DEPTH;
+    }
+
+    if( move_id )
+    {
+        *move_id = history[*cursor & ( PATHING_HISTORY_DEPTH - 1 )];
+    }
 
-    memcpy( &barrier_ev->id, &publish_id, sizeof( move_id ) );
-    eventPublish( (StateEvent *)barrier_ev );
+    *cursor += 1;
+    return true;
 }
 
 /* ----- End ---------------------------------------------------------------- */
@@ -8,8 +8,17 @@
 
 /* ----- Defines ------------------------------------------------------------ */
 
+#define PATHING_HISTORY_DEPTH 8    // started/completed ID's retained for late readers, power of two
+
 /* ----- Types ------------------------------------------------------------- */
 
+// Each consumer of PATHING_PROGRESS keeps a cursor into the start/complete sequence counters
+typedef struct
+{
+    uint32_t started;      // sequence number of the next move start to read
+    uint32_t completed;    // sequence number of the next move completion to read
+} PathingCursor_t;
+
 /* ----- Public Functions --------------------------------------------------- */
 
 PUBLIC void
@@ -32,6 +41,11 @@ path_interpolator_is_ready_for_next( void );
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC bool
+path_interpolator_is_empty( void );
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC float
 path_interpolator_get_progress( void );
 
@@ -62,4 +76,29 @@ path_interpolator_set_home( void );
 
 /* -------------------------------------------------------------------------- */
 
+// Fastest step rate any servo needs to follow the move at realtime, steps/ms.
+// Absolute moves only, relative moves and transits depend on where the effector is when they start
+PUBLIC float
+path_interpolator_step_rate( Movement_t *move );
+
+/* -------------------------------------------------------------------------- */
+
+// Discard any unread progress, the cursor will only see moves started/completed after this call
+PUBLIC void
+path_interpolator_cursor_sync( PathingCursor_t *cursor );
+
+/* -------------------------------------------------------------------------- */
+
+// Returns true and the move ID for each move start the cursor hasn't seen yet, oldest first
+PUBLIC bool
+path_interpolator_next_started( PathingCursor_t *cursor, uint16_t *move_id );
+
+/* -------------------------------------------------------------------------- */
+
+// Returns true and the move ID for each move completion the cursor hasn't seen yet, oldest first
+PUBLIC bool
+path_interpolator_next_completed( PathingCursor_t *cursor, uint16_t *move_id );
+
+/* -------------------------------------------------------------------------- */
+
 #endif /* PATH_INTERPOLATOR_H */
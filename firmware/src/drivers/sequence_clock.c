@@ -0,0 +1,167 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "sequence_clock.h"
+
+#include "app_times.h"
+#include "hal_systick.h"
+
+#include "configuration.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define SCALE_MIN     ( SEQUENCE_SCALE_MIN_PERCENT / 100.0f )
+#define SCALE_MAX     ( SEQUENCE_SCALE_MAX_PERCENT / 100.0f )
+#define SCALE_SLEW_MS ( SEQUENCE_SCALE_SLEW_PERCENT_S / 100.0f / 1000.0f )
+
+typedef struct
+{
+    float requested;    // rate asked for by the user
+    float ceiling;      // highest rate the running move allows
+    float scale;        // rate being applied
+
+    float hold;           // 1.0 when running, 0.0 when held
+    float hold_target;    // where the hold ramp is heading
+    float hold_rate;      // change in hold per ms
+
+    uint32_t last_tick;    // systick time of the previous update
+    uint32_t now_ms;       // scaled time
+    float    now_part;     // fractional ms not yet added to now_ms
+} SequenceClock_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+PRIVATE SequenceClock_t sequence_clock;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_init( void )
+{
+    SequenceClock_t *me = &sequence_clock;
+
+    memset( me, 0, sizeof( SequenceClock_t ) );
+
+    me->requested   = 1.0f;
+    me->ceiling     = SCALE_MAX;
+    me->scale       = 1.0f;
+    me->hold        = 1.0f;
+    me->hold_target = 1.0f;
+    me->last_tick   = hal_systick_get_ms();
+
+    config_set_time_scale( me->scale );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_process( void )
+{
+    SequenceClock_t *me = &sequence_clock;
+
+    uint32_t tick    = hal_systick_get_ms();
+    uint32_t elapsed = tick - me->last_tick;
+
+    if( elapsed == 0 )
+    {
+        return;
+    }
+
+    me->last_tick = tick;
+
+    float target   = MIN( me->requested, me->ceiling );
+    float previous = me->scale * me->hold;
+
+    // The mechanism limits apply immediately, user changes are slewed
+    if( me->scale > me->ceiling )
+    {
+        me->scale = me->ceiling;
+    }
+    else
+    {
+        float max_change = SCALE_SLEW_MS * elapsed;
+        me->scale += CLAMP( target - me->scale, -max_change, max_change );
+    }
+
+    // Feed hold ramps the applied rate towards zero independently of the playback rate
+    float hold_change = me->hold_rate * elapsed;
+    me->hold += CLAMP( me->hold_target - me->hold, -hold_change, hold_change );
+
+    float applied = me->scale * me->hold;
+
+    // Advance scaled time with the average rate across the interval
+    me->now_part += elapsed * ( previous + applied ) * 0.5f;
+
+    uint32_t whole_ms = (uint32_t)me->now_part;
+    me->now_ms += whole_ms;
+    me->now_part -= whole_ms;
+
+    if( applied != previous )
+    {
+        config_set_time_scale( applied );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+sequence_clock_get_ms( void )
+{
+    return sequence_clock.now_ms;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_set_scale( float scale )
+{
+    sequence_clock.requested = CLAMP( scale, SCALE_MIN, SCALE_MAX );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC float
+sequence_clock_get_scale( void )
+{
+    return sequence_clock.scale * sequence_clock.hold;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_limit_scale( float ceiling )
+{
+    // Only speed-ups are capped, moves over the limits at realtime are refused when queued
+    sequence_clock.ceiling = CLAMP( ceiling, 1.0f, SCALE_MAX );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_clear_limit( void )
+{
+    sequence_clock.ceiling = SCALE_MAX;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_hold( uint16_t ramp_ms )
+{
+    sequence_clock.hold_target = 0.0f;
+    sequence_clock.hold_rate   = ( ramp_ms ) ? 1.0f / ramp_ms : 1.0f;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_resume( uint16_t ramp_ms )
+{
+    sequence_clock.hold_target = 1.0f;
+    sequence_clock.hold_rate   = ( ramp_ms ) ? 1.0f / ramp_ms : 1.0f;
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,77 @@
+#ifndef SEQUENCE_CLOCK_H
+#define SEQUENCE_CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* -------------------------------------------------------------------------- */
+
+// The sequence clock is the timebase for queued moves and fades.
+// It runs at a scaled rate of the systick, so the host supplied durations can be
+// played back faster or slower than they were generated.
+
+PUBLIC void
+sequence_clock_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Advance the clock, call each background pass before the interpolators
+PUBLIC void
+sequence_clock_process( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Scaled milliseconds since init
+PUBLIC uint32_t
+sequence_clock_get_ms( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Request a playback rate, 1.0 is realtime. The clock slews towards it at a bounded rate.
+PUBLIC void
+sequence_clock_set_scale( float scale );
+
+/* -------------------------------------------------------------------------- */
+
+// Rate currently being applied
+PUBLIC float
+sequence_clock_get_scale( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Cap the rate while the current move is running, to keep it inside the mechanism's limits.
+// Realtime playback is never slowed, the cap only applies to rates above 1.0x.
+PUBLIC void
+sequence_clock_limit_scale( float ceiling );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_clock_clear_limit( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Ramp the clock down to a standstill over ramp_ms, moves and fades freeze at their current progress
+PUBLIC void
+sequence_clock_hold( uint16_t ramp_ms );
+
+/* -------------------------------------------------------------------------- */
+
+// Ramp the clock back up to the playback rate over ramp_ms
+PUBLIC void
+sequence_clock_resume( uint16_t ramp_ms );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEQUENCE_CLOCK_H */
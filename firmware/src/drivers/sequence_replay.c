@@ -0,0 +1,309 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "sequence_replay.h"
+
+#include "app_times.h"
+
+#include "configuration.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+typedef struct
+{
+    bool     active;
+    uint16_t first;      // arena index of the first item in the range
+    uint16_t last;       // arena index of the last item in the range
+    uint16_t next;       // arena index of the next item to hand out
+    uint8_t  repeats;    // passes through the range left after the current one
+} ReplayCursor_t;
+
+typedef struct
+{
+    bool retain;        // copy executed moves/fades into the arena
+    bool moves_full;    // move arena filled up, the user has been told
+    bool fades_full;    // fade arena filled up, the user has been told
+
+    Movement_t moves[REPLAY_MOVES_MAX];
+    uint16_t   moves_used;
+
+    Fade_t   fades[REPLAY_FADES_MAX];
+    uint16_t fades_used;
+
+    ReplayCursor_t move_cursor;
+    ReplayCursor_t fade_cursor;
+} SequenceReplay_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+PRIVATE SequenceReplay_t replay;
+
+PRIVATE bool
+sequence_replay_cursor_next( ReplayCursor_t *cursor, uint16_t *index );
+
+PRIVATE void
+sequence_replay_report_full( bool *reported, char *message );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_init( void )
+{
+    memset( &replay, 0, sizeof( replay ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_retain( bool enable )
+{
+    replay.retain = enable;
+
+    // Turning retention back on without a clear still can't store anything, say so again
+    if( enable )
+    {
+        replay.moves_full = false;
+        replay.fades_full = false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_clear( void )
+{
+    // Running replays would read stale slots
+    sequence_replay_stop_moves();
+    sequence_replay_stop_fades();
+
+    replay.moves_used = 0;
+    replay.fades_used = 0;
+    replay.moves_full = false;
+    replay.fades_full = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_store_move( Movement_t *move )
+{
+    if( !replay.retain )
+    {
+        return;
+    }
+
+    if( replay.moves_used < REPLAY_MOVES_MAX )
+    {
+        memcpy( &replay.moves[replay.moves_used], move, sizeof( Movement_t ) );
+        replay.moves_used++;
+    }
+    else
+    {
+        sequence_replay_report_full( &replay.moves_full, "Replay arena full - moves not retained" );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_store_fade( Fade_t *fade )
+{
+    if( !replay.retain )
+    {
+        return;
+    }
+
+    if( replay.fades_used < REPLAY_FADES_MAX )
+    {
+        memcpy( &replay.fades[replay.fades_used], fade, sizeof( Fade_t ) );
+        replay.fades_used++;
+    }
+    else
+    {
+        sequence_replay_report_full( &replay.fades_full, "Replay arena full - fades not retained" );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_start_moves( uint16_t first_id, uint16_t last_id, uint8_t repeats )
+{
+    ReplayCursor_t *cursor = &replay.move_cursor;
+    uint16_t        i      = 0;
+
+    // Find the move starting the range
+    while( i < replay.moves_used && replay.moves[i].identifier != first_id )
+    {
+        i++;
+    }
+
+    if( i == replay.moves_used )
+    {
+        return false;
+    }
+
+    cursor->first = i;
+
+    // and the last move of the range after it
+    while( i < replay.moves_used && replay.moves[i].identifier != last_id )
+    {
+        i++;
+    }
+
+    if( i == replay.moves_used )
+    {
+        return false;
+    }
+
+    cursor->last    = i;
+    cursor->next    = cursor->first;
+    cursor->repeats = ( repeats ) ? repeats - 1 : 0;
+    cursor->active  = true;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_start_fades( uint16_t first_id, uint16_t last_id, uint8_t repeats )
+{
+    ReplayCursor_t *cursor = &replay.fade_cursor;
+    uint16_t        i      = 0;
+
+    // Fades don't exist for every move, so take all those inside the range
+    while( i < replay.fades_used && replay.fades[i].identifier < first_id )
+    {
+        i++;
+    }
+
+    if( i == replay.fades_used || replay.fades[i].identifier > last_id )
+    {
+        return false;
+    }
+
+    cursor->first = i;
+
+    while( i + 1 < replay.fades_used && replay.fades[i + 1].identifier <= last_id )
+    {
+        i++;
+    }
+
+    cursor->last    = i;
+    cursor->next    = cursor->first;
+    cursor->repeats = ( repeats ) ? repeats - 1 : 0;
+    cursor->active  = true;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC Movement_t *
+sequence_replay_next_move( void )
+{
+    uint16_t index = 0;
+
+    if( sequence_replay_cursor_next( &replay.move_cursor, &index ) )
+    {
+        return &replay.moves[index];
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC Fade_t *
+sequence_replay_next_fade( void )
+{
+    uint16_t index = 0;
+
+    if( sequence_replay_cursor_next( &replay.fade_cursor, &index ) )
+    {
+        return &replay.fades[index];
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_moves_pending( void )
+{
+    return replay.move_cursor.active;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_fades_pending( void )
+{
+    return replay.fade_cursor.active;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_stop_moves( void )
+{
+    replay.move_cursor.active = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_stop_fades( void )
+{
+    replay.fade_cursor.active = false;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE bool
+sequence_replay_cursor_next( ReplayCursor_t *cursor, uint16_t *index )
+{
+    if( !cursor->active )
+    {
+        return false;
+    }
+
+    *index = cursor->next;
+
+    if( cursor->next < cursor->last )
+    {
+        cursor->next++;
+    }
+    else if( cursor->repeats )
+    {
+        // Loop back around for another pass
+        cursor->repeats--;
+        cursor->next = cursor->first;
+    }
+    else
+    {
+        cursor->active = false;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Once per arena until it's cleared or retention is turned on again, rather than for every move
+PRIVATE void
+sequence_replay_report_full( bool *reported, char *message )
+{
+    if( !*reported )
+    {
+        config_report_error( message );
+        *reported = true;
+    }
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,95 @@
+#ifndef SEQUENCE_REPLAY_H
+#define SEQUENCE_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+#include "led_types.h"
+#include "motion_types.h"
+
+/* -------------------------------------------------------------------------- */
+
+// Moves and fades taken off the queues are copied into a retained arena while retention is on.
+// A range of ID's can then be replayed from the arena without the host re-sending them.
+
+PUBLIC void
+sequence_replay_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_retain( bool enable );
+
+/* -------------------------------------------------------------------------- */
+
+// Discard everything retained so far
+PUBLIC void
+sequence_replay_clear( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_store_move( Movement_t *move );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_store_fade( Fade_t *fade );
+
+/* -------------------------------------------------------------------------- */
+
+// Play back the retained moves from first_id to last_id, repeats times. False if the range isn't retained.
+PUBLIC bool
+sequence_replay_start_moves( uint16_t first_id, uint16_t last_id, uint8_t repeats );
+
+/* -------------------------------------------------------------------------- */
+
+// Play back the retained fades with ID's between first_id and last_id, repeats times. False if there are none.
+PUBLIC bool
+sequence_replay_start_fades( uint16_t first_id, uint16_t last_id, uint8_t repeats );
+
+/* -------------------------------------------------------------------------- */
+
+// Next move of the replay, NULL once the replay has finished
+PUBLIC Movement_t *
+sequence_replay_next_move( void );
+
+/* -------------------------------------------------------------------------- */
+
+// Next fade of the replay, NULL once the replay has finished
+PUBLIC Fade_t *
+sequence_replay_next_fade( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_moves_pending( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+sequence_replay_fades_pending( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_stop_moves( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+sequence_replay_stop_fades( void );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEQUENCE_REPLAY_H */
@@ -7,8 +7,10 @@
 #include "stm32f4xx_ll_adc.h"
 #include "stm32f4xx_ll_bus.h"
 #include "stm32f4xx_ll_dma.h"
+#include "stm32f4xx_ll_rcc.h"
 
 #include "hal_adc.h"
+#include "hal_system_speed.h"
 
 #include "app_config.h"
 #include "average_short.h"
@@ -67,6 +69,13 @@ PRIVATE uint8_t        adc_enabled[HAL_ADC_INPUT_NUM];     // Track if each chan
 PRIVATE uint32_t       adc_peaks[HAL_ADC_INPUT_NUM];       // Track highest value
 PRIVATE AverageShort_t adc_averages[HAL_ADC_INPUT_NUM];    // Track average value
 
+#ifdef ISR_LATENCY_PROFILE
+// Core cycles per conversion, 480 cycle sampling plus 12 for a 12-bit
+// conversion, with the ADC clocked at PCLK2/2
+#define HAL_ADC_CONVERSION_CLOCKS ( 480U + 12U )
+PRIVATE uint32_t adc_conversion_cycles;
+#endif
+
 PRIVATE HalAdcState_t hal_adc1;    // Track behaviour for our peripheral (running, set rate etc)
 
 /* ------------------------- Functions -------------------------------------- */
@@ -172,6 +181,21 @@ hal_adc_init( void )
 
     LL_ADC_EnableIT_EOCS( ADC1 );
     LL_ADC_EnableIT_OVR( ADC1 );
+
+    hal_adc_clock_update();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_adc_clock_update( void )
+{
+    // The ADC clock is unchanged by the core speed, only the cycle figure moves
+#ifdef ISR_LATENCY_PROFILE
+    LL_RCC_ClocksTypeDef clocks;
+    LL_RCC_GetSystemClocksFreq( &clocks );
+    adc_conversion_cycles = HAL_ADC_CONVERSION_CLOCKS * 2U * ( clocks.HCLK_Frequency / clocks.PCLK2_Frequency );
+#endif
 }
 
 /* -------------------------------------------------------------------------- */
@@ -328,6 +352,8 @@ hal_adc_tick( void )
 
 void ADC_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // ADC group regular overrun caused the ADC interruption
     if( LL_ADC_IsActiveFlag_OVR( ADC1 ) != 0 )
     {
@@ -337,13 +363,23 @@ void ADC_IRQHandler( void )
         // TODO Gracefully recover when ADC overrun error occurs
         asm( "nop" );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_ADC, started );
 }
 
 void DMA2_Stream0_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // DMA half transfer caused the DMA interruption
     if( LL_DMA_IsActiveFlag_HT0( DMA2 ) == 1 )
     {
+        // Conversions stored since the half way point, one conversion resolution.
+        // The sequence stops at the end so this can't be done for TC.
+        HAL_ISR_LATENCY( HAL_ISR_ADC,
+                         ( ( HAL_ADC_INPUT_NUM - LL_DMA_GetDataLength( DMA2, LL_DMA_STREAM_0 ) + HAL_ADC_INPUT_NUM / 2 ) % HAL_ADC_INPUT_NUM )
+                             * adc_conversion_cycles );
+
         LL_DMA_ClearFlag_HT0( DMA2 );    // Clear flag DMA half transfer
 
         // Freeze the first half of the DMA samples
@@ -392,6 +428,8 @@ void DMA2_Stream0_IRQHandler( void )
         // TODO Handle adc DMA errors?
         asm( "nop" );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_ADC, started );
 }
 
 /* ----- End ---------------------------------------------------------------- */
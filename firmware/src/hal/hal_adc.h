@@ -35,6 +35,13 @@ hal_adc_init( void );
 
 /* -------------------------------------------------------------------------- */
 
+/** Refresh the core cycle figures after the core clock changes */
+
+PUBLIC void
+hal_adc_clock_update( void );
+
+/* -------------------------------------------------------------------------- */
+
 /** Return true when there are active samples in the averaging buffer */
 
 PUBLIC bool
@@ -11,6 +11,7 @@
 
 #include "hal_gpio.h"
 #include "hal_hard_ic.h"
+#include "hal_system_speed.h"
 #include "qassert.h"
 
 /* ----- Defines ------------------------------------------------------------ */
@@ -35,6 +36,7 @@ typedef struct
 
 PRIVATE HalHardICIntermediate_t fan_state;                     // holding values used to calculate edge durations
 PRIVATE uint32_t                ic_values[HAL_HARD_IC_NUM];    // Calculated duty cycle or frequency values, x100 for precision
+PRIVATE volatile uint8_t        fan_tick_shift;                // TIM9 follows HCLK, counts are this much slower at low speed
 
 /* ----- Private Functions -------------------------------------------------- */
 
@@ -44,6 +46,11 @@ hal_hard_ic_configure_pwm_input( TIM_TypeDef *TIMx );
 PRIVATE void
 hal_hard_ic_pwmic_irq_handler( InputCaptureSignal_t input, TIM_TypeDef *TIMx );
 
+#ifdef ISR_LATENCY_PROFILE
+PRIVATE uint32_t
+hal_hard_ic_ticks_to_cycles( TIM_TypeDef *TIMx, uint32_t ticks );
+#endif
+
 /* ----- Public Functions --------------------------------------------------- */
 
 PUBLIC void
@@ -254,6 +261,9 @@ hal_hard_ic_pwmic_irq_handler( InputCaptureSignal_t input, TIM_TypeDef *TIMx )
 {
     if( LL_TIM_IsActiveFlag_CC1( TIMx ) )
     {
+        // The rising edge reset the counter, so it holds the ticks since then
+        HAL_ISR_LATENCY( HAL_ISR_SERVO_FEEDBACK, hal_hard_ic_ticks_to_cycles( TIMx, LL_TIM_GetCounter( TIMx ) ) );
+
         LL_TIM_ClearFlag_CC1( TIMx );
 
         static uint32_t cnt_a = 0;
@@ -282,37 +292,63 @@ hal_hard_ic_pwmic_irq_handler( InputCaptureSignal_t input, TIM_TypeDef *TIMx )
 // Servo 1 HLFB
 void TIM8_CC_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     hal_hard_ic_pwmic_irq_handler( HAL_HARD_IC_HLFB_SERVO_1, TIM8 );
+
+    hal_system_speed_isr_cycles( HAL_ISR_SERVO_FEEDBACK, started );
 }
 
 void TIM3_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     hal_hard_ic_pwmic_irq_handler( HAL_HARD_IC_HLFB_SERVO_1, TIM3 );
+
+    hal_system_speed_isr_cycles( HAL_ISR_SERVO_FEEDBACK, started );
 }
 
 // Servo 2 HLFB
 void TIM4_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     hal_hard_ic_pwmic_irq_handler( HAL_HARD_IC_HLFB_SERVO_2, TIM4 );
+
+    hal_system_speed_isr_cycles( HAL_ISR_SERVO_FEEDBACK, started );
 }
 
 // Servo 3 HLFB
 void TIM1_CC_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     hal_hard_ic_pwmic_irq_handler( HAL_HARD_IC_HLFB_SERVO_3, TIM1 );
+
+    hal_system_speed_isr_cycles( HAL_ISR_SERVO_FEEDBACK, started );
 }
 
 // Servo 4 HLFB
 void TIM5_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     hal_hard_ic_pwmic_irq_handler( HAL_HARD_IC_HLFB_SERVO_4, TIM5 );
+
+    hal_system_speed_isr_cycles( HAL_ISR_SERVO_FEEDBACK, started );
 }
 
 // Fan Hall sensor
 void TIM1_BRK_TIM9_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     if( LL_TIM_IsActiveFlag_CC1( TIM9 ) )
     {
+        // Free running 16-bit counter, ticks since the edge was captured
+        HAL_ISR_LATENCY( HAL_ISR_FAN_TACHO,
+                         hal_hard_ic_ticks_to_cycles( TIM9, ( LL_TIM_GetCounter( TIM9 ) - LL_TIM_IC_GetCaptureCH1( TIM9 ) ) & 0xFFFFU ) );
+
         LL_TIM_ClearFlag_CC1( TIM9 );
 
         static uint32_t cnt_delta = 0;
@@ -342,12 +378,62 @@ void TIM1_BRK_TIM9_IRQHandler( void )
             }
 
             // Calculate the signal frequency
+            cnt_delta <<= fan_tick_shift;
             ic_values[HAL_HARD_IC_FAN_HALL] = ( FAN_TIM_CLOCK * FAN_IC_PRESCALE * 100 )
                                               / ( cnt_delta * ( FAN_TIM_PRESCALE + 1 ) * FAN_IC_EDGES_PER_PERIOD );
 
             fan_state.first_edge_done = false;
         }
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_FAN_TACHO, started );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_hard_ic_clock_update( void )
+{
+    // Servo feedback is a duty ratio so the timer rate doesn't matter. The fan
+    // period needs scaling, and an edge captured before the change is dropped.
+    // The tacho interrupt sits above the kernel priority.
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    fan_tick_shift            = hal_system_speed_is_low() ? 1U : 0U;
+    fan_state.first_edge_done = false;
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef ISR_LATENCY_PROFILE
+PRIVATE uint32_t
+hal_hard_ic_ticks_to_cycles( TIM_TypeDef *TIMx, uint32_t ticks )
+{
+    bool apb2 = ( TIMx == TIM1 || TIMx == TIM8 || TIMx == TIM9 );
+
+    // PPRE2 sits three bits above PPRE1, compare both as APB1 values
+    uint32_t prescale = apb2 ? ( LL_RCC_GetAPB2Prescaler() >> 3U ) : LL_RCC_GetAPB1Prescaler();
+    uint32_t ratio    = 1U;
+
+    // Timers run at twice their bus clock whenever the bus is divided down
+    switch( prescale )
+    {
+        case LL_RCC_APB1_DIV_4:
+            ratio = 2U;
+            break;
+        case LL_RCC_APB1_DIV_8:
+            ratio = 4U;
+            break;
+        case LL_RCC_APB1_DIV_16:
+            ratio = 8U;
+            break;
+        default:
+            break;
+    }
+
+    return ticks * ( LL_TIM_GetPrescaler( TIMx ) + 1U ) * ratio;
 }
+#endif
 
 /* ----- End ---------------------------------------------------------------- */
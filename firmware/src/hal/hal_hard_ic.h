@@ -45,6 +45,13 @@ hal_hard_ic_read_f( InputCaptureSignal_t input );
 
 /* -------------------------------------------------------------------------- */
 
+/** Account for the timer clocks moving with the core clock */
+
+PUBLIC void
+hal_hard_ic_clock_update( void );
+
+/* -------------------------------------------------------------------------- */
+
 void TIM8_CC_IRQHandler( void );
 void TIM3_IRQHandler( void );
 void TIM4_IRQHandler( void );
@@ -35,10 +35,18 @@ DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
 PRIVATE void
 hal_pwm_configure_peripheral( TIM_TypeDef *TIMx, uint32_t channel, uint32_t frequency );
 
+PRIVATE uint32_t
+hal_pwm_prescaler( uint32_t frequency );
+
+// Requested output frequencies, 0 until the output is set up
+PRIVATE uint16_t pwm_frequency[_PWM_NUMBER_TIMERS];
+
 /* ----- Public Functions --------------------------------------------------- */
 
 void hal_pwm_generation( PWMOutputTimerDef_t pwm_output, uint16_t frequency )
 {
+    pwm_frequency[pwm_output] = frequency;
+
     switch( pwm_output )
     {
         case _PWM_TIM_FAN:
@@ -101,7 +109,7 @@ void hal_pwm_generation( PWMOutputTimerDef_t pwm_output, uint16_t frequency )
 PRIVATE void
 hal_pwm_configure_peripheral( TIM_TypeDef *TIMx, uint32_t channel, uint32_t frequency )
 {
-    LL_TIM_SetPrescaler( TIMx, ( uint32_t )( SystemCoreClock / ( frequency * PWM_PERIOD_DEFAULT ) ) );
+    LL_TIM_SetPrescaler( TIMx, hal_pwm_prescaler( frequency ) );
     LL_TIM_SetCounterMode( TIMx, LL_TIM_COUNTERMODE_UP );
     LL_TIM_SetAutoReload( TIMx, PWM_PERIOD_DEFAULT );
     LL_TIM_SetClockDivision( TIMx, LL_TIM_CLOCKDIVISION_DIV1 );
@@ -138,6 +146,33 @@ hal_pwm_configure_peripheral( TIM_TypeDef *TIMx, uint32_t channel, uint32_t freq
 
 /* -------------------------------------------------------------------------- */
 
+PRIVATE uint32_t
+hal_pwm_prescaler( uint32_t frequency )
+{
+    return ( uint32_t )( SystemCoreClock / ( frequency * PWM_PERIOD_DEFAULT ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_pwm_clock_update( void )
+{
+    // TIM10 and TIM11 are clocked at HCLK whatever the core speed. The new
+    // prescaler is buffered until the next update, so the period in progress
+    // completes cleanly. TIM2 and TIM12 keep their clock and are left alone.
+    if( pwm_frequency[_PWM_TIM_FAN] )
+    {
+        LL_TIM_SetPrescaler( TIM10, hal_pwm_prescaler( pwm_frequency[_PWM_TIM_FAN] ) );
+    }
+
+    if( pwm_frequency[_PWM_TIM_BUZZER] )
+    {
+        LL_TIM_SetPrescaler( TIM11, hal_pwm_prescaler( pwm_frequency[_PWM_TIM_BUZZER] ) );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
 // O-100% as a float
 PUBLIC void hal_pwm_set_percentage_f( PWMOutputTimerDef_t pwm_output, float percentage )
 {
@@ -30,6 +30,13 @@ hal_pwm_generation( PWMOutputTimerDef_t pwm_output, uint16_t frequency );
 
 /* -------------------------------------------------------------------------- */
 
+/** Keep output frequencies steady after the core clock changes */
+
+PUBLIC void
+hal_pwm_clock_update( void );
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC
 void hal_pwm_set_percentage_f( PWMOutputTimerDef_t pwm_output, float percentage );
 
@@ -9,22 +9,47 @@
 #include "stm32f4xx_ll_cortex.h"
 #include "stm32f4xx_ll_pwr.h"
 #include "stm32f4xx_ll_rcc.h"
+#include "stm32f4xx_ll_system.h"
 
+#include "hal_adc.h"
+#include "hal_hard_ic.h"
+#include "hal_pwm.h"
 #include "hal_system_speed.h"
+#include "hal_systick.h"
+#include "hal_uart.h"
 
 /* ----- Private Types ------------------------------------------------------ */
 
+// Core and bus dividers for each speed. The APB dividers step down with the
+// AHB divider so PCLK1 and PCLK2, and with them the UART baud rates and ADC
+// clock, are the same at either speed.
+#define SPEED_HIGH_DIVIDERS ( RCC_CFGR_HPRE_DIV1 | RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV2 )
+#define SPEED_LOW_DIVIDERS  ( RCC_CFGR_HPRE_DIV2 | RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PPRE2_DIV1 )
+#define SPEED_DIVIDERS_MASK ( RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2 )
+
+// Flash wait states for 168MHz and 84MHz at 3.3V
+#define SPEED_HIGH_LATENCY LL_FLASH_LATENCY_5
+#define SPEED_LOW_LATENCY  LL_FLASH_LATENCY_2
+
 /* ----- Private Prototypes ------------------------------------------------- */
 
+PRIVATE void
+hal_system_speed_set_divider( uint8_t shift );
+
 /* ----- Private Data ------------------------------------------------------- */
 
 PRIVATE volatile uint32_t cc_when_sleeping;      //timestamp when we go to sleep
 PRIVATE volatile uint32_t cc_when_woken  = 0;    //timestamp when we wake up
 PRIVATE volatile uint32_t cc_awake_time  = 0;    //duration of 'active'
 PRIVATE volatile uint32_t cc_asleep_time = 0;    //duration of 'sleep'
+PRIVATE volatile uint8_t  speed_shift    = 0;    //log2 of the core clock divider, cycles << shift are full speed cycles
 
 PRIVATE SystemSpeed_RCC_PLL_t pll_working;
 
+PRIVATE CycleStats_t isr_cycles[HAL_ISR_NUM];
+
+PRIVATE LatencyHistogram_t isr_latency[HAL_ISR_NUM];
+
 /* ----- Public Functions --------------------------------------------------- */
 
 PUBLIC void
@@ -34,6 +59,13 @@ hal_system_speed_init( void )
     CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
     DWT->CYCCNT = 0;
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for( HalIsr_t isr = HAL_ISR_SYSTICK; isr < HAL_ISR_NUM; isr++ )
+    {
+        cycle_stats_clear( &isr_cycles[isr] );
+    }
+
+    hal_system_speed_isr_latency_clear();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -139,20 +171,22 @@ hal_system_speed_hsi_ready( void )
 PUBLIC void
 hal_system_speed_sleep( void )
 {
-    CRITICAL_SECTION_VAR();
-    CRITICAL_SECTION_START();
+    // WFI doesn't wake for interrupts masked by BASEPRI, so this masks them
+    // all. Not a CRITICAL_SECTION as the audit would count the time asleep.
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-    cc_awake_time += DWT->CYCCNT - cc_when_woken;
+    cc_awake_time += ( DWT->CYCCNT - cc_when_woken ) << speed_shift;
     cc_when_sleeping = DWT->CYCCNT;
 
     //Go to sleep. Wake on interrupt.
     LL_LPM_EnableSleep();
     __WFI();
 
-    cc_asleep_time += DWT->CYCCNT - cc_when_sleeping;
+    cc_asleep_time += ( DWT->CYCCNT - cc_when_sleeping ) << speed_shift;
     cc_when_woken = DWT->CYCCNT;
 
-    CRITICAL_SECTION_END();
+    __set_PRIMASK( primask );
 }
 
 /* -------------------------------------------------------------------------- */
@@ -186,27 +220,121 @@ hal_system_speed_get_speed( void )
 PUBLIC void
 hal_system_speed_high( void )
 {
-    hal_system_speed_get_pll( &pll_working );
+    hal_system_speed_set_divider( 0 );
+}
 
-    pll_working.PLLN = 336; /* 168MHz System clock */
-    pll_working.PLLP = 2;
-    pll_working.PLLQ = 7; /* 48MHz Clock for USB */
+/* -------------------------------------------------------------------------- */
 
-    hal_system_speed_set_pll( &pll_working );
+PUBLIC void
+hal_system_speed_low( void )
+{
+    hal_system_speed_set_divider( 1 );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+hal_system_speed_is_low( void )
+{
+    return speed_shift != 0;
 }
 
 /* -------------------------------------------------------------------------- */
 
 PUBLIC void
-hal_system_speed_low( void )
+hal_system_speed_isr_cycles( HalIsr_t isr, uint32_t started )
+{
+    cycle_stats_add( &isr_cycles[isr], started );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_system_speed_isr_report( HalIsr_t isr, CycleReport_t *report )
+{
+    cycle_stats_take( &isr_cycles[isr], report );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_system_speed_isr_latency( HalIsr_t isr, uint32_t cycles )
+{
+    latency_histogram_add( &isr_latency[isr], cycles );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_system_speed_isr_latency_report( HalIsr_t isr, LatencyReport_t *report )
+{
+    latency_histogram_report( &isr_latency[isr], report );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_system_speed_isr_latency_clear( void )
 {
-    hal_system_speed_get_pll( &pll_working );
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    for( HalIsr_t isr = HAL_ISR_SYSTICK; isr < HAL_ISR_NUM; isr++ )
+    {
+        latency_histogram_clear( &isr_latency[isr] );
+    }
+
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* ----- Private Functions -------------------------------------------------- */
 
-    pll_working.PLLN = 144; /* 72MHz System Clock */
-    pll_working.PLLP = 2;
-    pll_working.PLLQ = 3; /* 48MHz Clock for USB */
+// The PLL stays locked and only the prescalers move, so the switch takes a
+// few cycles rather than the ~200us relock on the HSI, and the peripheral
+// clocks don't glitch part way through a UART frame or PWM period.
+
+PRIVATE void
+hal_system_speed_set_divider( uint8_t shift )
+{
+    if( shift == speed_shift )
+    {
+        return;
+    }
+
+    // Wait states go up before the clock does, and down after it
+    if( !shift )
+    {
+        LL_FLASH_SetLatency( SPEED_HIGH_LATENCY );
+        while( LL_FLASH_GetLatency() != SPEED_HIGH_LATENCY ) {};
+    }
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    // Close off the awake time counted at the old speed
+    uint32_t now = DWT->CYCCNT;
+    cc_awake_time += ( now - cc_when_woken ) << speed_shift;
+    cc_when_woken = now;
+
+    // One write so the core and bus dividers change together
+    RCC->CFGR   = ( RCC->CFGR & ~SPEED_DIVIDERS_MASK ) | ( shift ? SPEED_LOW_DIVIDERS : SPEED_HIGH_DIVIDERS );
+    speed_shift = shift;
+
+    SystemCoreClockUpdate();
+    hal_systick_clock_update();
+
+    CRITICAL_SECTION_ALL_END();
+
+    if( shift )
+    {
+        LL_FLASH_SetLatency( SPEED_LOW_LATENCY );
+    }
 
-    hal_system_speed_set_pll( &pll_working );
+    // APB2 timers run at HCLK at either speed, APB1 timers don't move
+    hal_pwm_clock_update();
+    hal_hard_ic_clock_update();
+    hal_uart_clock_update();
+    hal_adc_clock_update();
 }
 
 /* ----- End ---------------------------------------------------------------- */
@@ -10,6 +10,8 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "global.h"
+#include "cycle_stats.h"
+#include "latency_histogram.h"
 
 /* ----- Public Functions --------------------------------------------------- */
 
@@ -25,6 +27,27 @@ extern "C" {
 #define RCC_PLLR_MASK ( (uint32_t)0x70000000 )
 #define RCC_PLLR_POS  ( 28U )
 
+// Interrupt handlers grouped by what they service, for cycle accounting
+typedef enum
+{
+    HAL_ISR_SYSTICK = 0,
+    HAL_ISR_SERVO_FEEDBACK,
+    HAL_ISR_FAN_TACHO,
+    HAL_ISR_UART_RX,
+    HAL_ISR_UART_TX,
+    HAL_ISR_ADC,
+    HAL_ISR_USB,
+    HAL_ISR_NUM,
+} HalIsr_t;
+
+// Record the latency from a hardware trigger to its handler running. Only
+// built in when profiling, so the counter reads cost nothing otherwise.
+#ifdef ISR_LATENCY_PROFILE
+#define HAL_ISR_LATENCY( isr_, cycles_ ) hal_system_speed_isr_latency( ( isr_ ), ( cycles_ ) )
+#else
+#define HAL_ISR_LATENCY( isr_, cycles_ )
+#endif
+
 typedef struct
 {
     uint32_t PLLM;    // PLL M parameter. Between 2 and 63.
@@ -76,14 +99,62 @@ hal_system_speed_get_speed( void );
 
 /* -------------------------------------------------------------------------- */
 
+/** Run the core at the full 168MHz */
+
 PUBLIC void
 hal_system_speed_high( void );
 
 /* -------------------------------------------------------------------------- */
 
+/** Halve the core clock to 84MHz. The PLL stays locked, peripheral bus clocks
+ *  are unchanged, and the SysTick, timers and cycle based figures are
+ *  rescaled to suit. Load figures are kept in full speed cycles.
+ */
+
 PUBLIC void
 hal_system_speed_low( void );
 
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+hal_system_speed_is_low( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Account the cycles since 'started' to an interrupt handler group. Called
+ *  at the end of the handler, time spent in handlers that preempted it is
+ *  included.
+ */
+
+PUBLIC void
+hal_system_speed_isr_cycles( HalIsr_t isr, uint32_t started );
+
+/* -------------------------------------------------------------------------- */
+
+/** Summarise the handler group's cycles since the last call */
+
+PUBLIC void
+hal_system_speed_isr_report( HalIsr_t isr, CycleReport_t *report );
+
+/* -------------------------------------------------------------------------- */
+
+/** Add a trigger to handler latency in CPU cycles, through HAL_ISR_LATENCY */
+
+PUBLIC void
+hal_system_speed_isr_latency( HalIsr_t isr, uint32_t cycles );
+
+/* -------------------------------------------------------------------------- */
+
+/** Copy out the latency histogram accumulated for a handler group */
+
+PUBLIC void
+hal_system_speed_isr_latency_report( HalIsr_t isr, LatencyReport_t *report );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_system_speed_isr_latency_clear( void );
+
 /* ----- End ---------------------------------------------------------------- */
 
 #ifdef __cplusplus
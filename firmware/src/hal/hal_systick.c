@@ -4,6 +4,7 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "hal_system_speed.h"
 #include "hal_systick.h"
 #include "qassert.h"
 #include "stm32f4xx_ll_cortex.h"
@@ -27,6 +28,7 @@ typedef struct
 PRIVATE TickHook_t tick_hooks[HAL_SYSTICK_MAX_HOOKS] = { { 0 } };
 
 uint32_t tick_timer = 0;
+PRIVATE uint32_t tick_hooked = 0;    // last tick the hooks have run for
 
 /* -------------------------------------------------------------------------- */
 
@@ -40,13 +42,25 @@ hal_systick_init( void )
 
     // Called earlier by LL_Init1msTick() in the main system clock setup stage
     //    LL_InitTick( rcc_clks.HCLK_Frequency, 1000U );
-    tick_timer = 0;
+    tick_timer  = 0;
+    tick_hooked = 0;
 
     LL_SYSTICK_EnableIT();
 }
 
 /* -------------------------------------------------------------------------- */
 
+/** Keep the tick at 1ms after the core clock changes */
+
+PUBLIC void
+hal_systick_clock_update( void )
+{
+    // Loaded at the next wrap, the tick in progress finishes at the new rate
+    SysTick->LOAD = ( SystemCoreClock / 1000U ) - 1U;
+}
+
+/* -------------------------------------------------------------------------- */
+
 /** Provides a tick value in millisecond.*/
 
 PUBLIC uint32_t
@@ -125,8 +139,32 @@ hal_systick_callback( void )
 
 void SysTick_Handler( void )
 {
+    // The counter reloaded when it fired and counts down on the core clock.
+    // CTRL isn't read as that would clear COUNTFLAG under LL_mDelay().
+    HAL_ISR_LATENCY( HAL_ISR_SYSTICK, SysTick->LOAD - SysTick->VAL );
+
     tick_timer++;
-    hal_systick_callback();
+
+    // The hooks run the kernel timers, so they go at the kernel priority
+    // while the timestamp stays on time
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void PendSV_Handler( void )
+{
+    uint32_t started = CYCLE_COUNT();
+
+    // Catch up if kernel critical sections held this off past a tick
+    while( tick_hooked != tick_timer )
+    {
+        tick_hooked++;
+        hal_systick_callback();
+    }
+
+    // Counted as the tick's time, the timestamp itself is a few instructions
+    hal_system_speed_isr_cycles( HAL_ISR_SYSTICK, started );
 }
 
 /* ----- End ---------------------------------------------------------------- */
@@ -36,6 +36,15 @@ hal_systick_get_ms( void );
 
 /* -------------------------------------------------------------------------- */
 
+/** Reload the tick period for the current core clock, which must already be
+ *  in SystemCoreClock.
+ */
+
+PUBLIC void
+hal_systick_clock_update( void );
+
+/* -------------------------------------------------------------------------- */
+
 // Add a callback function to the 1ms tick timer. Returns true when
 // hook was successfully added. The count indicates the tick rate at which the
 // hooked function runs.
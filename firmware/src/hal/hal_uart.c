@@ -16,6 +16,7 @@
 #include "fifo.h"
 #include "global.h"
 #include "hal_gpio.h"
+#include "hal_system_speed.h"
 #include "hal_uart.h"
 #include "qassert.h"
 
@@ -25,13 +26,25 @@ DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
 
 /* ----- Defines ------------------------------------------------------------ */
 
-#define HAL_UART_RX_FIFO_SIZE 250
-#define HAL_UART_TX_FIFO_SIZE 250
+// Power of two. Rides out a 20ms stall in the superloop with the module link at 500kbaud
+#define HAL_UART_RX_FIFO_SIZE 1024
+
+// Each port has two of these, one filling while the other is on the DMA
+#define HAL_UART_TX_BLOCK_SIZE 256
 
 #define HAL_UART_RX_DMA_BUFFER_SIZE 64
 
+// Start, 8 data and stop bit
+#define HAL_UART_BYTE_CYCLES( baud_ ) ( ( 10UL * SystemCoreClock ) / ( baud_ ) )
+
 /* ----- Types -------------------------------------------------------------- */
 
+typedef struct
+{
+    uint8_t           data[HAL_UART_TX_BLOCK_SIZE];
+    volatile uint16_t used;
+} HalUartTxBlock_t;
+
 typedef struct
 {
     HalUartPort_t  port;    // Human friendly enum name
@@ -44,10 +57,13 @@ typedef struct
     uint32_t     dma_stream_rx;
     uint32_t     dma_channel_rx;
 
-    // User-space buffers are serviced outside IRQ
-    fifo_t   tx_fifo;
-    uint8_t  tx_buffer[HAL_UART_TX_FIFO_SIZE];
-    uint16_t tx_sneak_bytes;
+    // Callers write into tx_block[tx_fill], the other block may be on the DMA
+    HalUartTxBlock_t tx_block[2];
+    volatile uint8_t tx_fill;
+    volatile bool    tx_busy;        // DMA is sending the other block
+    uint16_t         tx_reserved;    // bytes handed out by hal_uart_tx_reserve() and not yet committed
+    uint16_t         tx_peak;        // most bytes waiting in a fill block
+    uint32_t         tx_dropped;     // bytes refused by the drop policy or a blocking timeout
 
     fifo_t  rx_fifo;
     uint8_t rx_buffer[HAL_UART_RX_FIFO_SIZE];
@@ -55,6 +71,13 @@ typedef struct
     // Raw DMA buffer,
     volatile uint8_t dma_rx_buffer[HAL_UART_RX_DMA_BUFFER_SIZE];
     uint32_t         dma_rx_pos;
+    uint32_t         rx_dropped;    // bytes lost to a full rx FIFO
+    uint32_t         rx_started;    // cycle count and DMA position when the rx handler ran
+    uint32_t         rx_pos;
+    uint8_t          stop_match;    // bytes of the stop frame matched so far
+
+    uint32_t baud;
+    uint32_t byte_cycles;    // core cycles to receive one byte
 
 } HalUart_t;
 
@@ -62,29 +85,54 @@ typedef struct
 
 PRIVATE HalUart_t hal_uart[HAL_UART_NUM_PORTS];
 
+PRIVATE const uint8_t hal_uart_stop_frame[] = HAL_UART_STOP_FRAME;
+
+PRIVATE volatile HalUartStopHook_t stop_hook;
+PRIVATE HalUartStopLatency_t       stop_latency;
+
 /* ----- Private Functions -------------------------------------------------- */
 
 PRIVATE void
 hal_uart_dma_init( HalUartPort_t port );
 
+PRIVATE void
+hal_uart_rx_store( HalUart_t *h, uint32_t start, uint32_t length );
+
+PRIVATE bool
+hal_uart_stop_match( HalUart_t *h, uint8_t byte );
+
+PRIVATE void
+hal_uart_stop( HalUart_t *h, uint32_t end );
+
 PRIVATE void
 hal_uart_dma_irq_setup( DMA_TypeDef *DMAx, uint32_t stream, uint8_t preempt_priority, uint8_t sub_priority );
 
 PRIVATE void
 hal_uart_peripheral_init( USART_TypeDef *USARTx, uint32_t baudrate );
 
+PRIVATE uint32_t
+hal_uart_peripheral_clock( USART_TypeDef *USARTx );
+
 PRIVATE void
 hal_uart_clear_dma_tx_flags( DMA_TypeDef *DMAx, uint32_t stream_tx );
 
 PRIVATE void
 hal_uart_start_tx( HalUart_t *h );
 
+PRIVATE uint32_t
+hal_uart_tx_copy( HalUart_t *h, const uint8_t *data, uint32_t length );
+
 PRIVATE void
 hal_uart_completed_tx( HalUart_t *h );
 
 PRIVATE void
 hal_usart_irq_rx_handler( HalUart_t *h );
 
+#ifdef ISR_LATENCY_PROFILE
+PRIVATE uint32_t
+hal_uart_rx_dma_latency( HalUart_t *h, uint32_t boundary );
+#endif
+
 /* ----- USART Interface ---------------------------------------------------- */
 
 PUBLIC void
@@ -105,7 +153,6 @@ hal_uart_init( HalUartPort_t port )
             h->dma_stream_rx  = LL_DMA_STREAM_0;
             h->dma_channel_rx = LL_DMA_CHANNEL_4;
 
-            fifo_init( &h->tx_fifo, h->tx_buffer, HAL_UART_TX_FIFO_SIZE );
             fifo_init( &h->rx_fifo, h->rx_buffer, HAL_UART_RX_FIFO_SIZE );
 
             LL_APB1_GRP1_EnableClock( LL_APB1_GRP1_PERIPH_UART5 );
@@ -115,7 +162,9 @@ hal_uart_init( HalUartPort_t port )
             hal_gpio_init_alternate( _EXT_INPUT_0, LL_GPIO_AF_8, LL_GPIO_SPEED_FREQ_VERY_HIGH, LL_GPIO_PULL_NO );
 
             hal_uart_dma_init( HAL_UART_PORT_EXTERNAL );
-            hal_uart_peripheral_init( h->usart, EXTERNAL_BAUD );
+            h->baud = EXTERNAL_BAUD;
+            hal_uart_peripheral_init( h->usart, h->baud );
+            h->byte_cycles = HAL_UART_BYTE_CYCLES( h->baud );
 
             // Start it up
             LL_DMA_EnableStream( h->dma_peripheral, h->dma_stream_rx );    // rx stream
@@ -131,7 +180,6 @@ hal_uart_init( HalUartPort_t port )
             h->dma_stream_rx  = LL_DMA_STREAM_2;
             h->dma_channel_rx = LL_DMA_CHANNEL_4;
 
-            fifo_init( &h->tx_fifo, h->tx_buffer, HAL_UART_TX_FIFO_SIZE );
             fifo_init( &h->rx_fifo, h->rx_buffer, HAL_UART_RX_FIFO_SIZE );
 
             LL_APB2_GRP1_EnableClock( LL_APB2_GRP1_PERIPH_USART1 );
@@ -141,7 +189,9 @@ hal_uart_init( HalUartPort_t port )
             hal_gpio_init_alternate( _AUX_UART_TX, LL_GPIO_AF_7, LL_GPIO_SPEED_FREQ_VERY_HIGH, LL_GPIO_PULL_NO );
 
             hal_uart_dma_init( HAL_UART_PORT_INTERNAL );
-            hal_uart_peripheral_init( h->usart, INTERNAL_BAUD );
+            h->baud = INTERNAL_BAUD;
+            hal_uart_peripheral_init( h->usart, h->baud );
+            h->byte_cycles = HAL_UART_BYTE_CYCLES( h->baud );
 
             LL_DMA_EnableStream( h->dma_peripheral, h->dma_stream_rx );    // rx stream
             LL_USART_Enable( h->usart );
@@ -156,7 +206,6 @@ hal_uart_init( HalUartPort_t port )
             h->dma_stream_rx  = LL_DMA_STREAM_5;
             h->dma_channel_rx = LL_DMA_CHANNEL_4;
 
-            fifo_init( &h->tx_fifo, h->tx_buffer, HAL_UART_TX_FIFO_SIZE );
             fifo_init( &h->rx_fifo, h->rx_buffer, HAL_UART_RX_FIFO_SIZE );
 
             LL_APB1_GRP1_EnableClock( LL_APB1_GRP1_PERIPH_USART2 );
@@ -168,7 +217,9 @@ hal_uart_init( HalUartPort_t port )
             //            hal_gpio_init_alternate( _CARD_UART_RTS, LL_GPIO_OUTPUT_PUSHPULL, LL_GPIO_AF_7, LL_GPIO_SPEED_FREQ_VERY_HIGH, LL_GPIO_PULL_NO );
 
             hal_uart_dma_init( HAL_UART_PORT_MODULE );
-            hal_uart_peripheral_init( h->usart, MODULE_BAUD );
+            h->baud = MODULE_BAUD;
+            hal_uart_peripheral_init( h->usart, h->baud );
+            h->byte_cycles = HAL_UART_BYTE_CYCLES( h->baud );
 
             LL_DMA_EnableStream( h->dma_peripheral, h->dma_stream_rx );    // rx stream
             LL_USART_Enable( h->usart );
@@ -196,79 +247,203 @@ hal_uart_global_deinit( void )
 
 /* -------------------------------------------------------------------------- */
 
-/* Non-blocking send for a single character to the UART tx FIFO queue.
- * Returns true when successful. false when queue was full.
+PUBLIC void
+hal_uart_clock_update( void )
+{
+    for( HalUartPort_t port = HAL_UART_PORT_EXTERNAL; port < HAL_UART_NUM_PORTS; port++ )
+    {
+        HalUart_t *h = &hal_uart[port];
+
+        if( h->usart == NULL )
+        {
+            continue;
+        }
+
+        // Rewriting the divider garbles a frame in flight, so only touch it
+        // when the bus clock has actually moved
+        uint32_t brr = __LL_USART_DIV_SAMPLING16( hal_uart_peripheral_clock( h->usart ), h->baud );
+
+        if( LL_USART_ReadReg( h->usart, BRR ) != brr )
+        {
+            LL_USART_SetBaudRate( h->usart, hal_uart_peripheral_clock( h->usart ), LL_USART_OVERSAMPLING_16, h->baud );
+        }
+
+        h->byte_cycles = HAL_UART_BYTE_CYCLES( h->baud );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Non-blocking send for a single character.
+ * Returns true when successful. false when the buffer was full.
  */
 
 PUBLIC bool
 hal_uart_put( HalUartPort_t port, uint8_t ch )
 {
-    HalUart_t *h = &hal_uart[port];
-
-    uint32_t sent = fifo_write( &h->tx_fifo, &ch, 1 );
-
-    hal_uart_start_tx( h );
-    return ( sent == 1 );
+    return ( hal_uart_send( port, &ch, 1, HAL_UART_TX_DROP ) == 1 );
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Wait until FIFO cleared. */
+/** Wait until everything queued has gone out. */
 
 PUBLIC void
 hal_uart_flush( HalUartPort_t port )
 {
     HalUart_t *h = &hal_uart[port];
-    uint32_t   used;
 
-    do
-    {
-        used = fifo_used( &h->tx_fifo );
-    } while( used > 0 );
+    while( h->tx_busy || h->tx_block[h->tx_fill].used ) {};
 }
 
 /* -------------------------------------------------------------------------- */
 
-/* Non-blocking send for a single character to the UART tx FIFO queue.
- * Returns true when successful. false when queue was full.
+/* Blocking send for a single character.
+ * Can still return unsuccessfully when timing out.
  */
 
 PUBLIC bool
 hal_uart_put_blocking( HalUartPort_t port, uint8_t ch )
 {
-    HalUart_t *h = &hal_uart[port];
-
-    uint32_t timeout = 100000;
-    while( ( --timeout > 0 ) && ( fifo_free( &h->tx_fifo ) == 0 ) ) {}
-    uint32_t sent = fifo_write( &h->tx_fifo, &ch, 1 );
-    hal_uart_start_tx( h );
-    return ( sent == 1 );
+    return ( hal_uart_send( port, &ch, 1, HAL_UART_TX_BLOCK ) == 1 );
 }
 
 /* -------------------------------------------------------------------------- */
 
-/* Non-blocking send for a number of characters to the UART tx FIFO queue.
- * Returns the number of characters written to the queue. When less than
- * length, characters were dropped.
+/* Non-blocking send for a number of characters, all or nothing.
+ * Returns the number of characters queued, 0 when they were dropped.
  */
 
 PUBLIC uint32_t
 hal_uart_write( HalUartPort_t port, const uint8_t *data, uint32_t length )
+{
+    return hal_uart_send( port, data, length, HAL_UART_TX_DROP );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_uart_send( HalUartPort_t port, const uint8_t *data, uint32_t length, HalUartTxPolicy_t policy )
 {
     HalUart_t *h    = &hal_uart[port];
     uint32_t   sent = 0;
 
-    if( fifo_free( &h->tx_fifo ) >= length )
+    switch( policy )
     {
-        sent = fifo_write( &h->tx_fifo, data, length );
-        hal_uart_start_tx( h );
+        case HAL_UART_TX_DROP:
+            if( hal_uart_tx_free( port ) >= length )
+            {
+                sent = hal_uart_tx_copy( h, data, length );
+            }
+            break;
+
+        case HAL_UART_TX_PARTIAL:
+            return hal_uart_tx_copy( h, data, length );
+
+        case HAL_UART_TX_BLOCK: {
+            // Give up if nothing drains for two blocks at the line rate
+            uint32_t timeout = 2U * HAL_UART_TX_BLOCK_SIZE * h->byte_cycles;
+            uint32_t waited  = CYCLE_COUNT();
+
+            while( sent < length && CYCLE_COUNT() - waited < timeout )
+            {
+                uint32_t copied = hal_uart_tx_copy( h, data + sent, length - sent );
+
+                if( copied )
+                {
+                    sent += copied;
+                    waited = CYCLE_COUNT();
+                }
+            }
+            break;
+        }
     }
 
+    h->tx_dropped += length - sent;
+
     return sent;
 }
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC uint32_t
+hal_uart_tx_free( HalUartPort_t port )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    return HAL_UART_TX_BLOCK_SIZE - h->tx_block[h->tx_fill].used - h->tx_reserved;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_uart_tx_pending( HalUartPort_t port )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    return h->tx_block[h->tx_fill].used;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint8_t *
+hal_uart_tx_reserve( HalUartPort_t port, uint32_t length )
+{
+    HalUart_t *h   = &hal_uart[port];
+    uint8_t *  ptr = NULL;
+
+    REQUIRE( h->tx_reserved == 0 );
+
+    // The DMA completion handler sits above the kernel priority
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    HalUartTxBlock_t *block = &h->tx_block[h->tx_fill];
+
+    if( length && HAL_UART_TX_BLOCK_SIZE - block->used >= length )
+    {
+        ptr            = &block->data[block->used];
+        h->tx_reserved = (uint16_t)length;
+    }
+
+    CRITICAL_SECTION_ALL_END();
+
+    return ptr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_uart_tx_commit( HalUartPort_t port, uint32_t length )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    REQUIRE( length <= h->tx_reserved );
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    HalUartTxBlock_t *block = &h->tx_block[h->tx_fill];
+
+    block->used += length;
+    h->tx_reserved = 0;
+    h->tx_peak     = MAX( h->tx_peak, block->used );
+
+    hal_uart_start_tx( h );
+
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_uart_tx_dropped( HalUartPort_t port )
+{
+    return hal_uart[port].tx_dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+
 /* Returns number of available characters in the RX FIFO queue. */
 
 PUBLIC uint32_t
@@ -315,6 +490,85 @@ hal_uart_read( HalUartPort_t port, uint8_t *data, uint32_t maxlength )
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC uint32_t
+hal_uart_rx_span( HalUartPort_t port, const uint8_t **data )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    return fifo_read_span( &h->rx_fifo, data );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_uart_rx_consume( HalUartPort_t port, uint32_t length )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    fifo_read_commit( &h->rx_fifo, length );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_uart_rx_dropped( HalUartPort_t port )
+{
+    return hal_uart[port].rx_dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_uart_stop_hook( HalUartStopHook_t hook )
+{
+    stop_hook = hook;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_uart_stop_latency( HalUartStopLatency_t *report )
+{
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    *report = stop_latency;
+    CRITICAL_SECTION_ALL_END();
+}
+
+PUBLIC void
+hal_uart_stop_latency_clear( void )
+{
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    memset( &stop_latency, 0, sizeof( stop_latency ) );
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_uart_high_water( HalUartPort_t port,
+                     uint16_t *    tx_peak,
+                     uint16_t *    tx_size,
+                     uint16_t *    rx_peak,
+                     uint16_t *    rx_size )
+{
+    HalUart_t *h = &hal_uart[port];
+
+    if( h->usart == NULL )
+    {
+        *tx_peak = *tx_size = *rx_peak = *rx_size = 0;
+        return;
+    }
+
+    *tx_peak = h->tx_peak;
+    *tx_size = HAL_UART_TX_BLOCK_SIZE;
+    *rx_peak = (uint16_t)fifo_high_water( &h->rx_fifo );
+    *rx_size = (uint16_t)fifo_size( &h->rx_fifo );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PRIVATE void
 hal_uart_dma_init( HalUartPort_t port )
 {
@@ -442,21 +696,7 @@ hal_uart_dma_irq_setup( DMA_TypeDef *DMAx, uint32_t stream, uint8_t preempt_prio
 PRIVATE void
 hal_uart_peripheral_init( USART_TypeDef *USARTx, uint32_t baudrate )
 {
-    LL_RCC_ClocksTypeDef rcc_clocks = { 0 };
-    uint32_t             periphclk  = 0;
-
-    LL_RCC_GetSystemClocksFreq( &rcc_clocks );
-
-    if( USARTx == USART1 )
-    {
-        periphclk = rcc_clocks.PCLK2_Frequency;
-    }
-    else    // USART2 and UART5 are on PCLK1
-    {
-        periphclk = rcc_clocks.PCLK1_Frequency;
-    }
-
-    LL_USART_SetBaudRate( USARTx, periphclk, LL_USART_OVERSAMPLING_16, baudrate );
+    LL_USART_SetBaudRate( USARTx, hal_uart_peripheral_clock( USARTx ), LL_USART_OVERSAMPLING_16, baudrate );
     LL_USART_SetDataWidth( USARTx, LL_USART_DATAWIDTH_8B );
     LL_USART_SetStopBitsLength( USARTx, LL_USART_STOPBITS_1 );
     LL_USART_SetParity( USARTx, LL_USART_PARITY_NONE );
@@ -489,6 +729,24 @@ hal_uart_peripheral_init( USART_TypeDef *USARTx, uint32_t baudrate )
 
 /* -------------------------------------------------------------------------- */
 
+PRIVATE uint32_t
+hal_uart_peripheral_clock( USART_TypeDef *USARTx )
+{
+    LL_RCC_ClocksTypeDef rcc_clocks = { 0 };
+
+    LL_RCC_GetSystemClocksFreq( &rcc_clocks );
+
+    if( USARTx == USART1 )
+    {
+        return rcc_clocks.PCLK2_Frequency;
+    }
+
+    // USART2 and UART5 are on PCLK1
+    return rcc_clocks.PCLK1_Frequency;
+}
+
+/* -------------------------------------------------------------------------- */
+
 PRIVATE void hal_uart_clear_dma_tx_flags( DMA_TypeDef *DMAx, uint32_t stream_tx )
 {
     // Clear all tx DMA interrupt flags
@@ -557,50 +815,61 @@ PRIVATE void hal_uart_clear_dma_tx_flags( DMA_TypeDef *DMAx, uint32_t stream_tx
 
 /* ------------------------------------------------------------------*/
 
+// Hand the filled block to the DMA and switch callers over to the empty one.
+// Called with interrupts masked, or from the DMA completion handler.
+
 PRIVATE void
 hal_uart_start_tx( HalUart_t *h )
 {
-    uint32_t primask;
-
-    primask = __get_PRIMASK();
-    __disable_irq();
+    HalUartTxBlock_t *block = &h->tx_block[h->tx_fill];
 
-    /* If transfer is not on-going */
-    if( !LL_DMA_IsEnabledStream( h->dma_peripheral, h->dma_stream_tx ) )
+    // Wait for the DMA, and for a caller still writing into the block
+    if( h->tx_busy || h->tx_reserved || block->used == 0 )
     {
-        h->tx_sneak_bytes = fifo_used_linear( &h->tx_fifo );
-
-        // Limit maximum size to transmit at a time
-        if( h->tx_sneak_bytes > 32 )
-        {
-            h->tx_sneak_bytes = 32;
-        }
-
-        // Transmit remaining data
-        if( h->tx_sneak_bytes > 0 )
-        {
-            void *ptr = fifo_get_tail_ptr( &h->tx_fifo, h->tx_sneak_bytes );
+        return;
+    }
 
-            LL_DMA_SetDataLength( h->dma_peripheral, h->dma_stream_tx, h->tx_sneak_bytes );
-            LL_DMA_SetMemoryAddress( h->dma_peripheral, h->dma_stream_tx, (uint32_t)ptr );
+    LL_DMA_SetMemoryAddress( h->dma_peripheral, h->dma_stream_tx, (uint32_t)block->data );
+    LL_DMA_SetDataLength( h->dma_peripheral, h->dma_stream_tx, block->used );
 
-            hal_uart_clear_dma_tx_flags( h->dma_peripheral, h->dma_stream_tx );
+    hal_uart_clear_dma_tx_flags( h->dma_peripheral, h->dma_stream_tx );
 
-            /* Start transfer */
-            LL_DMA_EnableStream( h->dma_peripheral, h->dma_stream_tx );
-        }
-    }
+    h->tx_busy = true;
+    h->tx_fill ^= 1U;
 
-    __set_PRIMASK( primask );
+    /* Start transfer */
+    LL_DMA_EnableStream( h->dma_peripheral, h->dma_stream_tx );
 }
 
 PRIVATE void
 hal_uart_completed_tx( HalUart_t *h )
 {
-    fifo_skip( &h->tx_fifo, h->tx_sneak_bytes );
+    h->tx_block[h->tx_fill ^ 1U].used = 0;
+    h->tx_busy                        = false;
+
     hal_uart_start_tx( h );
 }
 
+/* -------------------------------------------------------------------------- */
+
+PRIVATE uint32_t
+hal_uart_tx_copy( HalUart_t *h, const uint8_t *data, uint32_t length )
+{
+    uint8_t *ptr;
+
+    length = MIN( length, hal_uart_tx_free( h->port ) );
+
+    if( length == 0 || ( ptr = hal_uart_tx_reserve( h->port, length ) ) == NULL )
+    {
+        return 0;
+    }
+
+    memcpy( ptr, data, length );
+    hal_uart_tx_commit( h->port, length );
+
+    return length;
+}
+
 /* ------------------------------------------------------------------*/
 
 // Tracks data handled by RX DMA and passes data off for higher-level storage/parsing etc.
@@ -612,23 +881,26 @@ hal_usart_irq_rx_handler( HalUart_t *h )
     // Calculate current head index
     uint32_t current_pos = HAL_UART_RX_DMA_BUFFER_SIZE - LL_DMA_GetDataLength( h->dma_peripheral, h->dma_stream_rx );
 
+    h->rx_started = CYCLE_COUNT();
+    h->rx_pos     = current_pos;
+
     // Has DMA given us new data?
     if( current_pos != h->dma_rx_pos )
     {
         // Data hasn't hit the end yet
         if( current_pos > h->dma_rx_pos )
         {
-            fifo_write( &h->rx_fifo, (const uint8_t *)&h->dma_rx_buffer[h->dma_rx_pos], current_pos - h->dma_rx_pos );
+            hal_uart_rx_store( h, h->dma_rx_pos, current_pos - h->dma_rx_pos );
         }
         else    // circular buffer overflowed
         {
             // Read to the end of the buffer
-            fifo_write( &h->rx_fifo, (const uint8_t *)&h->dma_rx_buffer[h->dma_rx_pos], DIM( h->dma_rx_buffer ) - h->dma_rx_pos );
+            hal_uart_rx_store( h, h->dma_rx_pos, DIM( h->dma_rx_buffer ) - h->dma_rx_pos );
 
             // Read from the start of the buffer to the current head
             if( current_pos > 0 )
             {
-                fifo_write( &h->rx_fifo, (const uint8_t *)&h->dma_rx_buffer[0], current_pos );
+                hal_uart_rx_store( h, 0, current_pos );
             }
         }
     }
@@ -642,11 +914,94 @@ hal_usart_irq_rx_handler( HalUart_t *h )
     }
 }
 
+// Move a run of the DMA buffer into the rx FIFO, counting what doesn't fit
+
+PRIVATE void
+hal_uart_rx_store( HalUart_t *h, uint32_t start, uint32_t length )
+{
+    // Look for the stop frame before anything else sees the data
+    for( uint32_t i = start; i < start + length; i++ )
+    {
+        if( hal_uart_stop_match( h, h->dma_rx_buffer[i] ) )
+        {
+            hal_uart_stop( h, i + 1U );
+        }
+    }
+
+    uint32_t stored = fifo_write( &h->rx_fifo, (const uint8_t *)&h->dma_rx_buffer[start], length );
+
+    h->rx_dropped += length - stored;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Returns true on the stop frame's closing delimiter. That delimiter can also
+// open the next frame, so matching carries on from it.
+
+PRIVATE bool
+hal_uart_stop_match( HalUart_t *h, uint8_t byte )
+{
+    if( byte != hal_uart_stop_frame[h->stop_match] )
+    {
+        h->stop_match = ( byte == hal_uart_stop_frame[0] ) ? 1U : 0U;
+        return false;
+    }
+
+    if( ++h->stop_match < DIM( hal_uart_stop_frame ) )
+    {
+        return false;
+    }
+
+    h->stop_match = 1U;
+    return true;
+}
+
+// The frame ended just before 'end' in the DMA buffer. Its arrival is dated
+// back from the handler starting by the bytes the DMA had stored after it.
+
+PRIVATE void
+hal_uart_stop( HalUart_t *h, uint32_t end )
+{
+    HalUartStopHook_t hook = stop_hook;
+
+    if( hook == NULL )
+    {
+        return;
+    }
+
+    hook();
+
+    uint32_t after  = ( h->rx_pos + HAL_UART_RX_DMA_BUFFER_SIZE - end ) % HAL_UART_RX_DMA_BUFFER_SIZE;
+    uint32_t cycles = ( CYCLE_COUNT() - h->rx_started ) + after * h->byte_cycles;
+    uint32_t us     = cycles / MAX( SystemCoreClock / 1000000UL, 1UL );
+
+    stop_latency.stops++;
+    stop_latency.last_us = us;
+    stop_latency.max_us  = MAX( stop_latency.max_us, us );
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef ISR_LATENCY_PROFILE
+// Bytes the DMA has stored past the half or full transfer point that raised
+// the interrupt, timed at the line rate. Resolution is one byte.
+PRIVATE uint32_t
+hal_uart_rx_dma_latency( HalUart_t *h, uint32_t boundary )
+{
+    uint32_t pos  = HAL_UART_RX_DMA_BUFFER_SIZE - LL_DMA_GetDataLength( h->dma_peripheral, h->dma_stream_rx );
+    uint32_t late = ( pos + HAL_UART_RX_DMA_BUFFER_SIZE - boundary ) % HAL_UART_RX_DMA_BUFFER_SIZE;
+
+    return late * h->byte_cycles;
+}
+#endif
+
 /* -------------------------------------------------------------------------- */
 
 PUBLIC void
 UART5_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Idle line interrupt occurs when the UART RX line has been high for more than one frame
     if( LL_USART_IsEnabledIT_IDLE( UART5 ) && LL_USART_IsActiveFlag_IDLE( UART5 ) )
     {
@@ -656,14 +1011,19 @@ UART5_IRQHandler( void )
         // Check for data to process
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_EXTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // RX
 void DMA1_Stream0_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Half transfer complete
     if( LL_DMA_IsEnabledIT_HT( DMA1, LL_DMA_STREAM_0 ) && LL_DMA_IsActiveFlag_HT0( DMA1 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_EXTERNAL], HAL_UART_RX_DMA_BUFFER_SIZE / 2 ) );
         LL_DMA_ClearFlag_HT0( DMA1 );
 
         // Check for data to process
@@ -673,14 +1033,19 @@ void DMA1_Stream0_IRQHandler( void )
     // Full transfer complete
     if( LL_DMA_IsEnabledIT_TC( DMA1, LL_DMA_STREAM_0 ) && LL_DMA_IsActiveFlag_TC0( DMA1 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_EXTERNAL], 0 ) );
         LL_DMA_ClearFlag_TC0( DMA1 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_EXTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // TX
 void DMA1_Stream7_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Transfer complete
     if( LL_DMA_IsEnabledIT_TC( DMA1, LL_DMA_STREAM_7 ) && LL_DMA_IsActiveFlag_TC7( DMA1 ) )
     {
@@ -689,25 +1054,34 @@ void DMA1_Stream7_IRQHandler( void )
         // Flush the data we just finished transferring, and send more as needed
         hal_uart_completed_tx( &hal_uart[HAL_UART_PORT_EXTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_TX, started );
 }
 
 /* -------------------------------------------------------------------------- */
 
 void USART1_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     if( LL_USART_IsEnabledIT_IDLE( USART1 ) && LL_USART_IsActiveFlag_IDLE( USART1 ) )
     {
         LL_USART_ClearFlag_IDLE( USART1 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_INTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // RX
 void DMA2_Stream2_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Half transfer complete
     if( LL_DMA_IsEnabledIT_HT( DMA2, LL_DMA_STREAM_2 ) && LL_DMA_IsActiveFlag_HT2( DMA2 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_INTERNAL], HAL_UART_RX_DMA_BUFFER_SIZE / 2 ) );
         LL_DMA_ClearFlag_HT2( DMA2 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_INTERNAL] );
     }
@@ -715,39 +1089,53 @@ void DMA2_Stream2_IRQHandler( void )
     // Full transfer complete
     if( LL_DMA_IsEnabledIT_TC( DMA2, LL_DMA_STREAM_2 ) && LL_DMA_IsActiveFlag_TC2( DMA2 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_INTERNAL], 0 ) );
         LL_DMA_ClearFlag_TC2( DMA2 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_INTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // TX
 void DMA2_Stream7_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     if( LL_DMA_IsEnabledIT_TC( DMA2, LL_DMA_STREAM_7 ) && LL_DMA_IsActiveFlag_TC7( DMA2 ) )
     {
         LL_DMA_ClearFlag_TC7( DMA2 );
         hal_uart_completed_tx( &hal_uart[HAL_UART_PORT_INTERNAL] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_TX, started );
 }
 
 /* -------------------------------------------------------------------------- */
 
 void USART2_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     /* Check for IDLE line interrupt */
     if( LL_USART_IsEnabledIT_IDLE( USART2 ) && LL_USART_IsActiveFlag_IDLE( USART2 ) )
     {
         LL_USART_ClearFlag_IDLE( USART2 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_MODULE] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // RX
 void DMA1_Stream5_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Half-transfer complete interrupt
     if( LL_DMA_IsEnabledIT_HT( DMA1, LL_DMA_STREAM_5 ) && LL_DMA_IsActiveFlag_HT5( DMA1 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_MODULE], HAL_UART_RX_DMA_BUFFER_SIZE / 2 ) );
         LL_DMA_ClearFlag_HT5( DMA1 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_MODULE] );
     }
@@ -755,20 +1143,27 @@ void DMA1_Stream5_IRQHandler( void )
     // Transfer-complete interrupt
     if( LL_DMA_IsEnabledIT_TC( DMA1, LL_DMA_STREAM_5 ) && LL_DMA_IsActiveFlag_TC5( DMA1 ) )
     {
+        HAL_ISR_LATENCY( HAL_ISR_UART_RX, hal_uart_rx_dma_latency( &hal_uart[HAL_UART_PORT_MODULE], 0 ) );
         LL_DMA_ClearFlag_TC5( DMA1 );
         hal_usart_irq_rx_handler( &hal_uart[HAL_UART_PORT_MODULE] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_RX, started );
 }
 
 // TX
 void DMA1_Stream6_IRQHandler( void )
 {
+    uint32_t started = CYCLE_COUNT();
+
     // Check transfer-complete interrupt
     if( LL_DMA_IsEnabledIT_TC( DMA1, LL_DMA_STREAM_6 ) && LL_DMA_IsActiveFlag_TC6( DMA1 ) )
     {
         LL_DMA_ClearFlag_TC6( DMA1 );
         hal_uart_completed_tx( &hal_uart[HAL_UART_PORT_MODULE] );
     }
+
+    hal_system_speed_isr_cycles( HAL_ISR_UART_TX, started );
 }
 
 /* ----- End ---------------------------------------------------------------- */
@@ -22,6 +22,30 @@ typedef enum
     HAL_UART_NUM_PORTS
 } HalUartPort_t;
 
+// What a send does when the transmit buffer hasn't got room
+typedef enum
+{
+    HAL_UART_TX_DROP,       // queue all of it or none of it, the default for packets
+    HAL_UART_TX_PARTIAL,    // queue what fits and return the count, the caller holds the rest
+    HAL_UART_TX_BLOCK,      // wait for the DMA to make room, gives up if the line stalls
+} HalUartTxPolicy_t;
+
+// Called from the receive interrupt when the stop frame arrives on any port
+typedef void ( *HalUartStopHook_t )( void );
+
+typedef struct
+{
+    uint32_t stops;      // stop frames seen since the last clear
+    uint32_t last_us;    // from the frame's last byte arriving to the hook returning
+    uint32_t max_us;
+} HalUartStopLatency_t;
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Reserved frame recognised in the receive interrupt. The bytes between the
+// delimiters aren't valid COBS, so the packet parser throws them away.
+#define HAL_UART_STOP_FRAME { 0x00U, 0xFEU, 'E', 'S', 'T', 0x00U }
+
 /* -------------------------------------------------------------------------- */
 /* --- UART INTERFACE                                                     --- */
 /* -------------------------------------------------------------------------- */
@@ -40,8 +64,15 @@ hal_uart_global_deinit( void );
 
 /* -------------------------------------------------------------------------- */
 
-/* Non-blocking send for a single character to the UART tx FIFO queue.
- * Returns true when successful. false when queue was full.
+/** Keep baud rates and byte timings right after the clocks change */
+
+PUBLIC void
+hal_uart_clock_update( void );
+
+/* -------------------------------------------------------------------------- */
+
+/* Non-blocking send for a single character.
+ * Returns true when successful. false when the buffer was full.
  */
 
 PUBLIC bool
@@ -49,16 +80,15 @@ hal_uart_put( HalUartPort_t port, uint8_t c );
 
 /* -------------------------------------------------------------------------- */
 
-/** Wait until FIFO cleared. */
+/** Wait until everything queued has gone out. */
 
 PUBLIC void
 hal_uart_flush( HalUartPort_t port );
 
 /* -------------------------------------------------------------------------- */
 
-/* Blocking send for a single character to the UART tx FIFO queue.
+/* Blocking send for a single character.
  * Can still return unsuccessfully when timing out.
- * Returns true when successful. false when queue was full.
  */
 
 PUBLIC bool
@@ -66,8 +96,8 @@ hal_uart_put_blocking( HalUartPort_t port, uint8_t c );
 
 /* -------------------------------------------------------------------------- */
 
-/* Non-blocking send for a number of characters to the UART tx FIFO queue.
- * Returns true when successful. false when queue was full.
+/* Non-blocking send for a number of characters, all or nothing.
+ * Returns the number of characters queued, 0 when they were dropped.
  */
 
 PUBLIC uint32_t
@@ -75,6 +105,54 @@ hal_uart_write( HalUartPort_t port, const uint8_t *data, uint32_t length );
 
 /* -------------------------------------------------------------------------- */
 
+/* Copy bytes into the transmit block being filled, while the other block is
+ * sent by DMA. Returns the number of bytes queued, what happens when there
+ * isn't room depends on the policy.
+ */
+
+PUBLIC uint32_t
+hal_uart_send( HalUartPort_t port, const uint8_t *data, uint32_t length, HalUartTxPolicy_t policy );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes that can be queued without waiting */
+
+PUBLIC uint32_t
+hal_uart_tx_free( HalUartPort_t port );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes queued behind the block the DMA is sending */
+
+PUBLIC uint32_t
+hal_uart_tx_pending( HalUartPort_t port );
+
+/* -------------------------------------------------------------------------- */
+
+/* Borrow space in the transmit block to serialise into directly. Returns NULL
+ * when there isn't room for length bytes. Nothing is sent until the matching
+ * hal_uart_tx_commit(), and only one reservation per port can be open.
+ */
+
+PUBLIC uint8_t *
+hal_uart_tx_reserve( HalUartPort_t port, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Queue the first length bytes of the open reservation, the rest is released */
+
+PUBLIC void
+hal_uart_tx_commit( HalUartPort_t port, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes refused by the drop policy or a blocking send timing out since boot */
+
+PUBLIC uint32_t
+hal_uart_tx_dropped( HalUartPort_t port );
+
+/* -------------------------------------------------------------------------- */
+
 /* Returns number of available characters in the RX FIFO queue. */
 
 PUBLIC uint32_t
@@ -100,6 +178,62 @@ hal_uart_read( HalUartPort_t port, uint8_t *buffer, uint32_t bufferlen );
 
 /* -------------------------------------------------------------------------- */
 
+/* Borrow the longest contiguous run of received bytes without copying them.
+ * Returns its length, 0 when nothing is waiting. The FIFO wraps, so call again
+ * after hal_uart_rx_consume() for anything stored at the start of the buffer.
+ */
+
+PUBLIC uint32_t
+hal_uart_rx_span( HalUartPort_t port, const uint8_t **data );
+
+/* -------------------------------------------------------------------------- */
+
+/* Release bytes handed out by hal_uart_rx_span() */
+
+PUBLIC void
+hal_uart_rx_consume( HalUartPort_t port, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes received while the rx FIFO was full since boot */
+
+PUBLIC uint32_t
+hal_uart_rx_dropped( HalUartPort_t port );
+
+/* -------------------------------------------------------------------------- */
+
+/* Run the hook straight from the receive interrupt when HAL_UART_STOP_FRAME
+ * arrives, ahead of the FIFO and the parser. It mustn't block or publish.
+ */
+
+PUBLIC void
+hal_uart_stop_hook( HalUartStopHook_t hook );
+
+/* -------------------------------------------------------------------------- */
+
+/* Stop frame latency, the time the line takes to go idle isn't included */
+
+PUBLIC void
+hal_uart_stop_latency( HalUartStopLatency_t *report );
+
+PUBLIC void
+hal_uart_stop_latency_clear( void );
+
+/* -------------------------------------------------------------------------- */
+
+/* Report the most bytes held in a tx block and the rx FIFO at once, along
+ * with their sizes. All zero for a port that hasn't been initialised.
+ */
+
+PUBLIC void
+hal_uart_high_water( HalUartPort_t port,
+                     uint16_t *    tx_peak,
+                     uint16_t *    tx_size,
+                     uint16_t *    rx_peak,
+                     uint16_t *    rx_size );
+
+/* -------------------------------------------------------------------------- */
+
 void UART5_IRQHandler( void );
 
 void USART1_IRQHandler( void );
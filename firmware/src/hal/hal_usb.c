@@ -0,0 +1,1192 @@
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "stm32f4xx_ll_bus.h"
+#include "stm32f4xx_ll_gpio.h"
+
+#include "fifo.h"
+#include "global.h"
+#include "hal_gpio.h"
+#include "hal_system_speed.h"
+#include "hal_usb.h"
+#include "hal_uuid.h"
+#include "qassert.h"
+
+/* ----- Private Data ------------------------------------------------------- */
+
+DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Power of two. The OUT endpoint NAKs rather than overrun it, so the host
+// just retries while the superloop catches up.
+#define HAL_USB_RX_FIFO_SIZE 1024
+
+// Two of these, one filling while the other is on the IN endpoint. One block
+// is four full speed packets, and fits the endpoint's TX FIFO whole.
+#define HAL_USB_TX_BLOCK_SIZE 256
+
+// Full speed bulk and control endpoints
+#define HAL_USB_PACKET_SIZE        64U
+#define HAL_USB_NOTIFY_PACKET_SIZE 8U
+
+// Shared FIFO RAM in words, 320 in total on the FS core
+#define HAL_USB_RX_FIFO_WORDS  128U
+#define HAL_USB_EP0_TX_WORDS   ( HAL_USB_PACKET_SIZE / 4U )
+#define HAL_USB_DATA_TX_WORDS  ( HAL_USB_TX_BLOCK_SIZE / 4U )
+#define HAL_USB_NOTIFY_TX_WORDS 16U
+
+#define HAL_USB_EP_CONTROL 0U
+#define HAL_USB_EP_DATA    1U
+#define HAL_USB_EP_NOTIFY  2U
+
+// Turnaround time for an AHB clock of 32MHz or more, the governor never goes below 84MHz
+#define HAL_USB_TURNAROUND 6U
+
+// Core resets and FIFO flushes finish in a few PHY clocks
+#define HAL_USB_WAIT_CYCLES 200000UL
+
+#define HAL_USB_DEVICE        ( (USB_OTG_DeviceTypeDef *)( USB_OTG_FS_PERIPH_BASE + USB_OTG_DEVICE_BASE ) )
+#define HAL_USB_IN_EP( ep_ )  ( (USB_OTG_INEndpointTypeDef *)( USB_OTG_FS_PERIPH_BASE + USB_OTG_IN_ENDPOINT_BASE + ( ep_ ) * USB_OTG_EP_REG_SIZE ) )
+#define HAL_USB_OUT_EP( ep_ ) ( (USB_OTG_OUTEndpointTypeDef *)( USB_OTG_FS_PERIPH_BASE + USB_OTG_OUT_ENDPOINT_BASE + ( ep_ ) * USB_OTG_EP_REG_SIZE ) )
+#define HAL_USB_FIFO( ep_ )   ( *(__IO uint32_t *)( USB_OTG_FS_PERIPH_BASE + USB_OTG_FIFO_BASE + ( ep_ ) * USB_OTG_FIFO_SIZE ) )
+#define HAL_USB_PCGCCTL       ( *(__IO uint32_t *)( USB_OTG_FS_PERIPH_BASE + USB_OTG_PCGCCTL_BASE ) )
+
+// Receive status entries popped from GRXSTSP
+#define HAL_USB_RX_OUT_DATA   2U
+#define HAL_USB_RX_SETUP_DATA 6U
+
+// Endpoint types in DxEPCTL
+#define HAL_USB_EPTYP_BULK      2U
+#define HAL_USB_EPTYP_INTERRUPT 3U
+
+// Standard requests
+#define USB_REQ_GET_STATUS        0x00U
+#define USB_REQ_CLEAR_FEATURE     0x01U
+#define USB_REQ_SET_FEATURE       0x03U
+#define USB_REQ_SET_ADDRESS       0x05U
+#define USB_REQ_GET_DESCRIPTOR    0x06U
+#define USB_REQ_GET_CONFIGURATION 0x08U
+#define USB_REQ_SET_CONFIGURATION 0x09U
+#define USB_REQ_GET_INTERFACE     0x0AU
+#define USB_REQ_SET_INTERFACE     0x0BU
+
+// CDC ACM class requests
+#define CDC_REQ_SET_LINE_CODING        0x20U
+#define CDC_REQ_GET_LINE_CODING        0x21U
+#define CDC_REQ_SET_CONTROL_LINE_STATE 0x22U
+#define CDC_REQ_SEND_BREAK             0x23U
+
+#define USB_REQ_TYPE_MASK     0x60U
+#define USB_REQ_TYPE_STANDARD 0x00U
+#define USB_REQ_TYPE_CLASS    0x20U
+
+#define USB_REQ_RECIPIENT_MASK   0x1FU
+#define USB_REQ_RECIPIENT_DEVICE 0x00U
+
+#define USB_STATUS_SELF_POWERED 0x01U    // matches bmAttributes in the configuration descriptor
+
+#define USB_DESC_DEVICE        0x01U
+#define USB_DESC_CONFIGURATION 0x02U
+#define USB_DESC_STRING        0x03U
+
+#define CDC_LINE_CODING_SIZE 7U
+#define CDC_CONTROL_DTR      0x01U
+
+#define USB_STRING_SERIAL 3U
+
+// Hex digits of the 96-bit UUID
+#define USB_SERIAL_LENGTH 24U
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef enum
+{
+    HAL_USB_EP0_IDLE,
+    HAL_USB_EP0_DATA_IN,
+    HAL_USB_EP0_DATA_OUT,
+    HAL_USB_EP0_STATUS_IN,
+    HAL_USB_EP0_STATUS_OUT,
+} HalUsbEp0State_t;
+
+typedef union
+{
+    uint32_t words[2];
+
+    struct __attribute__( ( packed ) )
+    {
+        uint8_t  request_type;
+        uint8_t  request;
+        uint16_t value;
+        uint16_t index;
+        uint16_t length;
+    };
+} HalUsbSetup_t;
+
+// Words so the FIFO can be filled a word at a time straight from the block
+typedef struct
+{
+    uint32_t          data[HAL_USB_TX_BLOCK_SIZE / 4U];
+    volatile uint16_t used;
+} HalUsbTxBlock_t;
+
+typedef struct
+{
+    // Control endpoint
+    HalUsbSetup_t    setup;
+    HalUsbEp0State_t ep0_state;
+    const uint8_t *  ep0_data;         // rest of the reply being sent
+    uint16_t         ep0_remaining;
+    bool             ep0_zlp;          // the reply ends on a packet boundary short of what was asked for
+    uint32_t         ep0_packet[HAL_USB_PACKET_SIZE / 4U];
+    uint16_t         ep0_received;
+
+    uint8_t configuration;
+    uint8_t line_coding[CDC_LINE_CODING_SIZE];
+    uint8_t string[2U + 2U * USB_SERIAL_LENGTH];
+
+    // Callers write into tx_block[tx_fill], the other block may be on the IN endpoint
+    HalUsbTxBlock_t  tx_block[2];
+    volatile uint8_t tx_fill;
+    volatile bool    tx_busy;        // the IN endpoint has a transfer
+    uint16_t         tx_length;      // of that transfer, 0 for a zero length packet
+    bool             tx_zlp;         // the last transfer ended on a packet boundary and nothing followed it
+    uint16_t         tx_reserved;    // bytes handed out by hal_usb_tx_reserve() and not yet committed
+
+    fifo_t        rx_fifo;
+    uint8_t       rx_buffer[HAL_USB_RX_FIFO_SIZE];
+    uint32_t      rx_packet[HAL_USB_PACKET_SIZE / 4U];
+    volatile bool rx_held;    // OUT endpoint left NAKing until the FIFO has room for a packet
+
+    HalUsbStats_t stats;
+} HalUsb_t;
+
+/* ----- Variables ---------------------------------------------------------- */
+
+PRIVATE HalUsb_t hal_usb;
+
+// ST's virtual COM port IDs, so hosts load their stock CDC ACM driver
+PRIVATE const uint8_t hal_usb_device_descriptor[] = {
+    18, USB_DESC_DEVICE,
+    0x00, 0x02,                   // USB 2.0
+    0x02, 0x00, 0x00,             // CDC, the class is given per interface
+    HAL_USB_PACKET_SIZE,
+    0x83, 0x04,                   // vendor 0x0483
+    0x40, 0x57,                   // product 0x5740
+    0x00, 0x01,                   // release 1.00
+    1, 2, USB_STRING_SERIAL,      // manufacturer, product and serial strings
+    1,                            // configurations
+};
+
+PRIVATE const uint8_t hal_usb_configuration_descriptor[] = {
+    9, USB_DESC_CONFIGURATION, 67, 0, 2, 1, 0, 0xC0, 50,    // two interfaces, self powered, 100mA
+
+    // Communications interface, with the functional descriptors ACM needs
+    9, 0x04, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+    5, 0x24, 0x00, 0x10, 0x01,    // header, CDC 1.10
+    5, 0x24, 0x01, 0x00, 1,       // call management, on the data interface
+    4, 0x24, 0x02, 0x02,          // ACM, line coding and serial state
+    5, 0x24, 0x06, 0, 1,          // union of the two interfaces
+    7, 0x05, 0x80 | HAL_USB_EP_NOTIFY, HAL_USB_EPTYP_INTERRUPT, HAL_USB_NOTIFY_PACKET_SIZE, 0, 16,
+
+    // Data interface
+    9, 0x04, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+    7, 0x05, HAL_USB_EP_DATA, HAL_USB_EPTYP_BULK, HAL_USB_PACKET_SIZE, 0, 0,
+    7, 0x05, 0x80 | HAL_USB_EP_DATA, HAL_USB_EPTYP_BULK, HAL_USB_PACKET_SIZE, 0, 0,
+};
+
+PRIVATE const uint8_t hal_usb_language_descriptor[] = { 4, USB_DESC_STRING, 0x09, 0x04 };
+
+PRIVATE const char *const hal_usb_strings[] = {
+    [1] = "Electric UI",
+    [2] = "ZaphodBot",
+};
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE bool
+hal_usb_wait( __IO uint32_t *reg, uint32_t mask, uint32_t value );
+
+PRIVATE void
+hal_usb_flush_fifos( void );
+
+PRIVATE void
+hal_usb_bus_reset( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_enumerated( void );
+
+PRIVATE void
+hal_usb_rx_level( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_fifo_read( uint32_t *words, uint32_t length );
+
+PRIVATE void
+hal_usb_fifo_write( uint8_t ep, const uint32_t *words, uint32_t length );
+
+PRIVATE void
+hal_usb_out_endpoints( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_in_endpoints( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_ep0_arm( void );
+
+PRIVATE void
+hal_usb_ep0_reply( HalUsb_t *h, const uint8_t *data, uint16_t length );
+
+PRIVATE bool
+hal_usb_ep0_continue( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_ep0_status( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_ep0_stall( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_setup( HalUsb_t *h );
+
+PRIVATE bool
+hal_usb_setup_standard( HalUsb_t *h );
+
+PRIVATE bool
+hal_usb_setup_class( HalUsb_t *h );
+
+PRIVATE bool
+hal_usb_get_descriptor( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_configure( HalUsb_t *h, uint8_t configuration );
+
+PRIVATE void
+hal_usb_rx_arm( void );
+
+PRIVATE void
+hal_usb_start_tx( HalUsb_t *h );
+
+PRIVATE void
+hal_usb_completed_tx( HalUsb_t *h );
+
+/* ----- USB Interface ------------------------------------------------------ */
+
+PUBLIC bool
+hal_usb_init( void )
+{
+    HalUsb_t *h = &hal_usb;
+    memset( h, 0, sizeof( HalUsb_t ) );
+
+    fifo_init( &h->rx_fifo, h->rx_buffer, HAL_USB_RX_FIFO_SIZE );
+
+    // 115200 8N1 until the host says otherwise, nothing here depends on it
+    const uint32_t baud = 115200UL;
+    memcpy( h->line_coding, &baud, sizeof( baud ) );
+
+    hal_gpio_init_alternate( _USB_DM, LL_GPIO_AF_10, LL_GPIO_SPEED_FREQ_VERY_HIGH, LL_GPIO_PULL_NO );
+    hal_gpio_init_alternate( _USB_DP, LL_GPIO_AF_10, LL_GPIO_SPEED_FREQ_VERY_HIGH, LL_GPIO_PULL_NO );
+
+    LL_AHB2_GRP1_EnableClock( LL_AHB2_GRP1_PERIPH_OTGFS );
+
+    USB_OTG_FS->GAHBCFG &= ~USB_OTG_GAHBCFG_GINT;
+    USB_OTG_FS->GUSBCFG |= USB_OTG_GUSBCFG_PHYSEL;
+
+    // The reset needs the 48MHz clock, without it the core is left off
+    if( !hal_usb_wait( &USB_OTG_FS->GRSTCTL, USB_OTG_GRSTCTL_AHBIDL, USB_OTG_GRSTCTL_AHBIDL ) )
+    {
+        return false;
+    }
+
+    USB_OTG_FS->GRSTCTL |= USB_OTG_GRSTCTL_CSRST;
+
+    if( !hal_usb_wait( &USB_OTG_FS->GRSTCTL, USB_OTG_GRSTCTL_CSRST, 0 ) )
+    {
+        return false;
+    }
+
+    // PA9 isn't wired for VBUS sensing, so act as if the cable is always in
+    USB_OTG_FS->GCCFG = USB_OTG_GCCFG_PWRDWN | USB_OTG_GCCFG_NOVBUSSENS;
+
+    USB_OTG_FS->GUSBCFG = ( USB_OTG_FS->GUSBCFG & ~( USB_OTG_GUSBCFG_TRDT | USB_OTG_GUSBCFG_FHMOD ) )
+                          | USB_OTG_GUSBCFG_FDMOD
+                          | ( HAL_USB_TURNAROUND << USB_OTG_GUSBCFG_TRDT_Pos );
+
+    // Settles into device mode in the background, see hal_usb_start()
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_usb_start( void )
+{
+    HAL_USB_PCGCCTL = 0;
+    HAL_USB_DEVICE->DCFG |= USB_OTG_DCFG_DSPD;    // full speed on the internal PHY
+    HAL_USB_DEVICE->DCTL |= USB_OTG_DCTL_SDIS;    // stay off the bus until set up
+
+    USB_OTG_FS->GRXFSIZ            = HAL_USB_RX_FIFO_WORDS;
+    USB_OTG_FS->DIEPTXF0_HNPTXFSIZ = ( HAL_USB_EP0_TX_WORDS << 16 ) | HAL_USB_RX_FIFO_WORDS;
+    USB_OTG_FS->DIEPTXF[HAL_USB_EP_DATA - 1U]
+        = ( HAL_USB_DATA_TX_WORDS << 16 ) | ( HAL_USB_RX_FIFO_WORDS + HAL_USB_EP0_TX_WORDS );
+    USB_OTG_FS->DIEPTXF[HAL_USB_EP_NOTIFY - 1U]
+        = ( HAL_USB_NOTIFY_TX_WORDS << 16 ) | ( HAL_USB_RX_FIFO_WORDS + HAL_USB_EP0_TX_WORDS + HAL_USB_DATA_TX_WORDS );
+
+    hal_usb_flush_fifos();
+
+    HAL_USB_DEVICE->DIEPMSK  = 0;
+    HAL_USB_DEVICE->DOEPMSK  = 0;
+    HAL_USB_DEVICE->DAINTMSK = 0;
+
+    USB_OTG_FS->GINTSTS = 0xFFFFFFFFUL;
+    USB_OTG_FS->GINTMSK = USB_OTG_GINTMSK_USBRST
+                          | USB_OTG_GINTMSK_ENUMDNEM
+                          | USB_OTG_GINTMSK_RXFLVLM
+                          | USB_OTG_GINTMSK_IEPINT
+                          | USB_OTG_GINTMSK_OEPINT;
+
+    // Below the UARTs, the host retries anything the device isn't ready for
+    NVIC_SetPriority( OTG_FS_IRQn, NVIC_EncodePriority( NVIC_GetPriorityGrouping(), 6, 0 ) );
+    NVIC_EnableIRQ( OTG_FS_IRQn );
+
+    USB_OTG_FS->GAHBCFG |= USB_OTG_GAHBCFG_GINT;
+    HAL_USB_DEVICE->DCTL &= ~USB_OTG_DCTL_SDIS;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+hal_usb_is_open( void )
+{
+    return hal_usb.stats.open;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_usb_write( const uint8_t *data, uint32_t length )
+{
+    uint8_t *ptr = NULL;
+
+    if( length && hal_usb_tx_free() >= length )
+    {
+        ptr = hal_usb_tx_reserve( length );
+    }
+
+    if( ptr == NULL )
+    {
+        hal_usb.stats.tx_dropped += length;
+        return 0;
+    }
+
+    memcpy( ptr, data, length );
+    hal_usb_tx_commit( length );
+
+    return length;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_usb_tx_free( void )
+{
+    HalUsb_t *h = &hal_usb;
+
+    return HAL_USB_TX_BLOCK_SIZE - h->tx_block[h->tx_fill].used - h->tx_reserved;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_usb_tx_pending( void )
+{
+    HalUsb_t *h = &hal_usb;
+
+    return h->tx_block[h->tx_fill].used;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint8_t *
+hal_usb_tx_reserve( uint32_t length )
+{
+    HalUsb_t *h   = &hal_usb;
+    uint8_t * ptr = NULL;
+
+    REQUIRE( h->tx_reserved == 0 );
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    HalUsbTxBlock_t *block = &h->tx_block[h->tx_fill];
+
+    if( h->stats.open && length && HAL_USB_TX_BLOCK_SIZE - block->used >= length )
+    {
+        ptr            = (uint8_t *)block->data + block->used;
+        h->tx_reserved = (uint16_t)length;
+    }
+
+    CRITICAL_SECTION_ALL_END();
+
+    return ptr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_usb_tx_commit( uint32_t length )
+{
+    HalUsb_t *h = &hal_usb;
+
+    REQUIRE( length <= h->tx_reserved );
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    // The host may have closed the port since the reservation
+    if( h->stats.open )
+    {
+        h->tx_block[h->tx_fill].used += length;
+    }
+    else
+    {
+        h->stats.tx_dropped += length;
+    }
+
+    h->tx_reserved = 0;
+
+    hal_usb_start_tx( h );
+
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+hal_usb_rx_span( const uint8_t **data )
+{
+    return fifo_read_span( &hal_usb.rx_fifo, data );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_usb_rx_consume( uint32_t length )
+{
+    HalUsb_t *h = &hal_usb;
+
+    fifo_read_commit( &h->rx_fifo, length );
+
+    if( h->rx_held && fifo_free( &h->rx_fifo ) >= HAL_USB_PACKET_SIZE )
+    {
+        CRITICAL_SECTION_VAR();
+        CRITICAL_SECTION_ALL_START();
+
+        // A bus reset in the meantime leaves the endpoint to the next configuration
+        if( h->rx_held && h->configuration )
+        {
+            h->rx_held = false;
+            hal_usb_rx_arm();
+        }
+
+        CRITICAL_SECTION_ALL_END();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_usb_stats( HalUsbStats_t *report )
+{
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    *report = hal_usb.stats;
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void
+OTG_FS_IRQHandler( void )
+{
+    uint32_t  started = CYCLE_COUNT();
+    HalUsb_t *h       = &hal_usb;
+    uint32_t  status  = USB_OTG_FS->GINTSTS & USB_OTG_FS->GINTMSK;
+
+    if( status & USB_OTG_GINTSTS_USBRST )
+    {
+        USB_OTG_FS->GINTSTS = USB_OTG_GINTSTS_USBRST;
+        hal_usb_bus_reset( h );
+    }
+
+    if( status & USB_OTG_GINTSTS_ENUMDNE )
+    {
+        USB_OTG_FS->GINTSTS = USB_OTG_GINTSTS_ENUMDNE;
+        hal_usb_enumerated();
+    }
+
+    // Cleared by popping the receive status
+    while( USB_OTG_FS->GINTSTS & USB_OTG_GINTSTS_RXFLVL )
+    {
+        hal_usb_rx_level( h );
+    }
+
+    if( status & USB_OTG_GINTSTS_OEPINT )
+    {
+        hal_usb_out_endpoints( h );
+    }
+
+    if( status & USB_OTG_GINTSTS_IEPINT )
+    {
+        hal_usb_in_endpoints( h );
+    }
+
+    hal_system_speed_isr_cycles( HAL_ISR_USB, started );
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE bool
+hal_usb_wait( __IO uint32_t *reg, uint32_t mask, uint32_t value )
+{
+    uint32_t started = CYCLE_COUNT();
+
+    while( ( *reg & mask ) != value )
+    {
+        if( CYCLE_COUNT() - started > HAL_USB_WAIT_CYCLES )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_flush_fifos( void )
+{
+    // All the TX FIFOs at once, then the shared RX FIFO
+    USB_OTG_FS->GRSTCTL = USB_OTG_GRSTCTL_TXFFLSH | ( 0x10U << USB_OTG_GRSTCTL_TXFNUM_Pos );
+    hal_usb_wait( &USB_OTG_FS->GRSTCTL, USB_OTG_GRSTCTL_TXFFLSH, 0 );
+
+    USB_OTG_FS->GRSTCTL = USB_OTG_GRSTCTL_RXFFLSH;
+    hal_usb_wait( &USB_OTG_FS->GRSTCTL, USB_OTG_GRSTCTL_RXFFLSH, 0 );
+}
+
+/* -------------------------------------------------------------------------- */
+
+// The host starts over, anything in flight to it is gone. The core deactivates
+// the endpoints other than 0 itself.
+
+PRIVATE void
+hal_usb_bus_reset( HalUsb_t *h )
+{
+    hal_usb_flush_fifos();
+
+    for( uint8_t ep = 0; ep <= HAL_USB_EP_NOTIFY; ep++ )
+    {
+        HAL_USB_IN_EP( ep )->DIEPINT = 0xFFFFU;
+        HAL_USB_OUT_EP( ep )->DOEPINT = 0xFFFFU;
+        HAL_USB_OUT_EP( ep )->DOEPCTL |= USB_OTG_DOEPCTL_SNAK;
+    }
+
+    HAL_USB_DEVICE->DAINTMSK = ( 1U << HAL_USB_EP_CONTROL ) | ( 1U << ( 16U + HAL_USB_EP_CONTROL ) );
+    HAL_USB_DEVICE->DOEPMSK  = USB_OTG_DOEPMSK_STUPM | USB_OTG_DOEPMSK_XFRCM;
+    HAL_USB_DEVICE->DIEPMSK  = USB_OTG_DIEPMSK_XFRCM;
+    HAL_USB_DEVICE->DCFG &= ~USB_OTG_DCFG_DAD;
+
+    h->ep0_state     = HAL_USB_EP0_IDLE;
+    h->configuration = 0;
+    h->stats.configured = false;
+    h->stats.open       = false;
+    h->stats.resets++;
+
+    h->tx_block[0].used = 0;
+    h->tx_block[1].used = 0;
+    h->tx_busy          = false;
+    h->tx_zlp           = false;
+    h->rx_held          = false;
+
+    hal_usb_ep0_arm();
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_enumerated( void )
+{
+    // Full speed, so a 64 byte control endpoint
+    HAL_USB_IN_EP( HAL_USB_EP_CONTROL )->DIEPCTL &= ~USB_OTG_DIEPCTL_MPSIZ;
+    HAL_USB_DEVICE->DCTL |= USB_OTG_DCTL_CGINAK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_rx_level( HalUsb_t *h )
+{
+    uint32_t entry  = USB_OTG_FS->GRXSTSP;
+    uint8_t  ep     = entry & USB_OTG_GRXSTSP_EPNUM;
+    uint16_t length = ( entry & USB_OTG_GRXSTSP_BCNT ) >> USB_OTG_GRXSTSP_BCNT_Pos;
+
+    switch( ( entry & USB_OTG_GRXSTSP_PKTSTS ) >> USB_OTG_GRXSTSP_PKTSTS_Pos )
+    {
+        case HAL_USB_RX_SETUP_DATA:
+            hal_usb_fifo_read( h->setup.words, sizeof( h->setup.words ) );
+            break;
+
+        case HAL_USB_RX_OUT_DATA:
+            if( ep == HAL_USB_EP_CONTROL )
+            {
+                length = MIN( length, HAL_USB_PACKET_SIZE );
+                hal_usb_fifo_read( h->ep0_packet, length );
+                h->ep0_received = length;
+            }
+            else if( ep == HAL_USB_EP_DATA && length )
+            {
+                length = MIN( length, HAL_USB_PACKET_SIZE );
+                hal_usb_fifo_read( h->rx_packet, length );
+
+                // Only armed with room for a whole packet, so this always fits
+                fifo_write( &h->rx_fifo, (const uint8_t *)h->rx_packet, length );
+                h->stats.rx_bytes += length;
+                h->stats.rx_packets++;
+            }
+            break;
+
+        default:
+            // Transfer and setup completion markers carry no data
+            break;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// The FIFO is read and written a word at a time, the packet buffers are word
+// aligned so nothing is copied a byte at a time on the way
+
+PRIVATE void
+hal_usb_fifo_read( uint32_t *words, uint32_t length )
+{
+    for( uint32_t i = 0; i < ( length + 3U ) / 4U; i++ )
+    {
+        words[i] = HAL_USB_FIFO( 0 );
+    }
+}
+
+PRIVATE void
+hal_usb_fifo_write( uint8_t ep, const uint32_t *words, uint32_t length )
+{
+    for( uint32_t i = 0; i < ( length + 3U ) / 4U; i++ )
+    {
+        HAL_USB_FIFO( ep ) = words[i];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_out_endpoints( HalUsb_t *h )
+{
+    uint32_t pending = ( HAL_USB_DEVICE->DAINT & HAL_USB_DEVICE->DAINTMSK ) >> 16;
+
+    if( pending & ( 1U << HAL_USB_EP_CONTROL ) )
+    {
+        USB_OTG_OUTEndpointTypeDef *ep0   = HAL_USB_OUT_EP( HAL_USB_EP_CONTROL );
+        uint32_t                    flags = ep0->DOEPINT & HAL_USB_DEVICE->DOEPMSK;
+
+        ep0->DOEPINT = flags;
+
+        // A status stage can complete in the same interrupt as the next setup
+        if( flags & USB_OTG_DOEPINT_XFRC )
+        {
+            if( h->ep0_state == HAL_USB_EP0_DATA_OUT )
+            {
+                if( h->setup.request == CDC_REQ_SET_LINE_CODING && h->ep0_received >= CDC_LINE_CODING_SIZE )
+                {
+                    memcpy( h->line_coding, h->ep0_packet, CDC_LINE_CODING_SIZE );
+                }
+
+                hal_usb_ep0_status( h );
+            }
+            else if( h->ep0_state == HAL_USB_EP0_STATUS_OUT )
+            {
+                h->ep0_state = HAL_USB_EP0_IDLE;
+            }
+
+            hal_usb_ep0_arm();
+        }
+
+        if( flags & USB_OTG_DOEPINT_STUP )
+        {
+            hal_usb_setup( h );
+            hal_usb_ep0_arm();
+        }
+    }
+
+    if( pending & ( 1U << HAL_USB_EP_DATA ) )
+    {
+        USB_OTG_OUTEndpointTypeDef *ep    = HAL_USB_OUT_EP( HAL_USB_EP_DATA );
+        uint32_t                    flags = ep->DOEPINT & HAL_USB_DEVICE->DOEPMSK;
+
+        ep->DOEPINT = flags;
+
+        if( flags & USB_OTG_DOEPINT_XFRC )
+        {
+            // Leave the host NAKed until the superloop makes room
+            if( fifo_free( &h->rx_fifo ) >= HAL_USB_PACKET_SIZE )
+            {
+                hal_usb_rx_arm();
+            }
+            else
+            {
+                h->rx_held = true;
+                h->stats.rx_held++;
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_in_endpoints( HalUsb_t *h )
+{
+    uint32_t pending = HAL_USB_DEVICE->DAINT & HAL_USB_DEVICE->DAINTMSK & 0xFFFFU;
+
+    if( pending & ( 1U << HAL_USB_EP_CONTROL ) )
+    {
+        USB_OTG_INEndpointTypeDef *ep0   = HAL_USB_IN_EP( HAL_USB_EP_CONTROL );
+        uint32_t                   flags = ep0->DIEPINT & HAL_USB_DEVICE->DIEPMSK;
+
+        ep0->DIEPINT = flags;
+
+        if( flags & USB_OTG_DIEPINT_XFRC )
+        {
+            if( h->ep0_state == HAL_USB_EP0_DATA_IN && !hal_usb_ep0_continue( h ) )
+            {
+                h->ep0_state = HAL_USB_EP0_STATUS_OUT;
+            }
+            else if( h->ep0_state == HAL_USB_EP0_STATUS_IN )
+            {
+                h->ep0_state = HAL_USB_EP0_IDLE;
+            }
+        }
+    }
+
+    if( pending & ( 1U << HAL_USB_EP_DATA ) )
+    {
+        USB_OTG_INEndpointTypeDef *ep    = HAL_USB_IN_EP( HAL_USB_EP_DATA );
+        uint32_t                   flags = ep->DIEPINT & HAL_USB_DEVICE->DIEPMSK;
+
+        ep->DIEPINT = flags;
+
+        if( flags & USB_OTG_DIEPINT_XFRC )
+        {
+            hal_usb_completed_tx( h );
+        }
+    }
+
+    // Nothing is ever sent on the notification endpoint
+    if( pending & ( 1U << HAL_USB_EP_NOTIFY ) )
+    {
+        HAL_USB_IN_EP( HAL_USB_EP_NOTIFY )->DIEPINT = 0xFFFFU;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Ready for the next setup packet, or a data or status stage from the host
+
+PRIVATE void
+hal_usb_ep0_arm( void )
+{
+    USB_OTG_OUTEndpointTypeDef *ep0 = HAL_USB_OUT_EP( HAL_USB_EP_CONTROL );
+
+    ep0->DOEPTSIZ = ( 3U << USB_OTG_DOEPTSIZ_STUPCNT_Pos )
+                    | ( 1U << USB_OTG_DOEPTSIZ_PKTCNT_Pos )
+                    | HAL_USB_PACKET_SIZE;
+    ep0->DOEPCTL |= USB_OTG_DOEPCTL_EPENA | USB_OTG_DOEPCTL_CNAK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_ep0_reply( HalUsb_t *h, const uint8_t *data, uint16_t length )
+{
+    uint16_t requested = h->setup.length;
+
+    h->ep0_data      = data;
+    h->ep0_remaining = MIN( length, requested );
+    h->ep0_zlp       = ( h->ep0_remaining < requested ) && ( h->ep0_remaining % HAL_USB_PACKET_SIZE ) == 0;
+    h->ep0_state     = HAL_USB_EP0_DATA_IN;
+
+    hal_usb_ep0_continue( h );
+}
+
+// Send the next packet of the reply, one at a time to suit the 64 byte FIFO.
+// Returns false once all of it has gone.
+
+PRIVATE bool
+hal_usb_ep0_continue( HalUsb_t *h )
+{
+    if( h->ep0_remaining == 0 && !h->ep0_zlp )
+    {
+        return false;
+    }
+
+    uint16_t                   length = MIN( h->ep0_remaining, HAL_USB_PACKET_SIZE );
+    USB_OTG_INEndpointTypeDef *ep0    = HAL_USB_IN_EP( HAL_USB_EP_CONTROL );
+
+    if( length == 0 )
+    {
+        h->ep0_zlp = false;
+    }
+
+    memcpy( h->ep0_packet, h->ep0_data, length );
+    h->ep0_data += length;
+    h->ep0_remaining -= length;
+
+    ep0->DIEPTSIZ = ( 1U << USB_OTG_DIEPTSIZ_PKTCNT_Pos ) | length;
+    ep0->DIEPCTL |= USB_OTG_DIEPCTL_EPENA | USB_OTG_DIEPCTL_CNAK;
+    hal_usb_fifo_write( HAL_USB_EP_CONTROL, h->ep0_packet, length );
+
+    return true;
+}
+
+PRIVATE void
+hal_usb_ep0_status( HalUsb_t *h )
+{
+    USB_OTG_INEndpointTypeDef *ep0 = HAL_USB_IN_EP( HAL_USB_EP_CONTROL );
+
+    ep0->DIEPTSIZ = ( 1U << USB_OTG_DIEPTSIZ_PKTCNT_Pos );
+    ep0->DIEPCTL |= USB_OTG_DIEPCTL_EPENA | USB_OTG_DIEPCTL_CNAK;
+
+    h->ep0_state = HAL_USB_EP0_STATUS_IN;
+}
+
+// The core clears the stall itself when the next setup packet arrives
+
+PRIVATE void
+hal_usb_ep0_stall( HalUsb_t *h )
+{
+    HAL_USB_IN_EP( HAL_USB_EP_CONTROL )->DIEPCTL |= USB_OTG_DIEPCTL_STALL;
+    HAL_USB_OUT_EP( HAL_USB_EP_CONTROL )->DOEPCTL |= USB_OTG_DOEPCTL_STALL;
+
+    h->ep0_state = HAL_USB_EP0_IDLE;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_setup( HalUsb_t *h )
+{
+    bool handled = false;
+
+    h->ep0_state = HAL_USB_EP0_IDLE;
+
+    switch( h->setup.request_type & USB_REQ_TYPE_MASK )
+    {
+        case USB_REQ_TYPE_STANDARD:
+            handled = hal_usb_setup_standard( h );
+            break;
+
+        case USB_REQ_TYPE_CLASS:
+            handled = hal_usb_setup_class( h );
+            break;
+
+        default:
+            break;
+    }
+
+    if( !handled )
+    {
+        hal_usb_ep0_stall( h );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+hal_usb_setup_standard( HalUsb_t *h )
+{
+    static const uint8_t zero[2]         = { 0 };
+    static const uint8_t self_powered[2] = { USB_STATUS_SELF_POWERED, 0 };
+
+    switch( h->setup.request )
+    {
+        case USB_REQ_GET_DESCRIPTOR:
+            return hal_usb_get_descriptor( h );
+
+        case USB_REQ_SET_ADDRESS:
+            // The core wants the address before the status stage, it applies it after
+            HAL_USB_DEVICE->DCFG = ( HAL_USB_DEVICE->DCFG & ~USB_OTG_DCFG_DAD )
+                                   | ( ( h->setup.value & 0x7FU ) << USB_OTG_DCFG_DAD_Pos );
+            hal_usb_ep0_status( h );
+            return true;
+
+        case USB_REQ_SET_CONFIGURATION:
+            if( h->setup.value > 1U )
+            {
+                return false;
+            }
+
+            hal_usb_configure( h, (uint8_t)h->setup.value );
+            hal_usb_ep0_status( h );
+            return true;
+
+        case USB_REQ_GET_CONFIGURATION:
+            hal_usb_ep0_reply( h, &h->configuration, 1 );
+            return true;
+
+        case USB_REQ_GET_STATUS:
+            // Self powered like the descriptor says, no remote wakeup or halted endpoints
+            if( ( h->setup.request_type & USB_REQ_RECIPIENT_MASK ) == USB_REQ_RECIPIENT_DEVICE )
+            {
+                hal_usb_ep0_reply( h, self_powered, sizeof( self_powered ) );
+            }
+            else
+            {
+                hal_usb_ep0_reply( h, zero, sizeof( zero ) );
+            }
+            return true;
+
+        case USB_REQ_GET_INTERFACE:
+            hal_usb_ep0_reply( h, zero, 1 );
+            return true;
+
+        case USB_REQ_CLEAR_FEATURE:
+        case USB_REQ_SET_FEATURE:
+        case USB_REQ_SET_INTERFACE:
+            hal_usb_ep0_status( h );
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+hal_usb_setup_class( HalUsb_t *h )
+{
+    switch( h->setup.request )
+    {
+        case CDC_REQ_SET_LINE_CODING:
+            // The coding follows in the data stage
+            h->ep0_received = 0;
+            h->ep0_state    = HAL_USB_EP0_DATA_OUT;
+            return true;
+
+        case CDC_REQ_GET_LINE_CODING:
+            hal_usb_ep0_reply( h, h->line_coding, CDC_LINE_CODING_SIZE );
+            return true;
+
+        case CDC_REQ_SET_CONTROL_LINE_STATE:
+            // Terminal programs raise DTR when they open the port
+            h->stats.open = h->configuration && ( h->setup.value & CDC_CONTROL_DTR );
+            hal_usb_ep0_status( h );
+            return true;
+
+        case CDC_REQ_SEND_BREAK:
+            hal_usb_ep0_status( h );
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE bool
+hal_usb_get_descriptor( HalUsb_t *h )
+{
+    uint8_t index = h->setup.value & 0xFFU;
+
+    switch( h->setup.value >> 8 )
+    {
+        case USB_DESC_DEVICE:
+            hal_usb_ep0_reply( h, hal_usb_device_descriptor, sizeof( hal_usb_device_descriptor ) );
+            return true;
+
+        case USB_DESC_CONFIGURATION:
+            hal_usb_ep0_reply( h, hal_usb_configuration_descriptor, sizeof( hal_usb_configuration_descriptor ) );
+            return true;
+
+        case USB_DESC_STRING:
+            break;
+
+        default:
+            return false;    // including the device qualifier, a full speed device doesn't have one
+    }
+
+    if( index == 0 )
+    {
+        hal_usb_ep0_reply( h, hal_usb_language_descriptor, sizeof( hal_usb_language_descriptor ) );
+        return true;
+    }
+
+    // UTF-16 from ASCII, the serial number is the UUID in hex
+    uint8_t length = 0;
+
+    if( index == USB_STRING_SERIAL )
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        const uint8_t *   uuid  = (const uint8_t *)HAL_UUID;
+
+        for( ; length < USB_SERIAL_LENGTH; length++ )
+        {
+            uint8_t nibble = uuid[length / 2U] >> ( ( length & 1U ) ? 0U : 4U );
+
+            h->string[2U + 2U * length]      = hex[nibble & 0x0FU];
+            h->string[2U + 2U * length + 1U] = 0;
+        }
+    }
+    else if( index < DIM( hal_usb_strings ) && hal_usb_strings[index] )
+    {
+        const char *text = hal_usb_strings[index];
+
+        for( ; text[length] && length < USB_SERIAL_LENGTH; length++ )
+        {
+            h->string[2U + 2U * length]      = (uint8_t)text[length];
+            h->string[2U + 2U * length + 1U] = 0;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    h->string[0] = 2U + 2U * length;
+    h->string[1] = USB_DESC_STRING;
+
+    hal_usb_ep0_reply( h, h->string, h->string[0] );
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PRIVATE void
+hal_usb_configure( HalUsb_t *h, uint8_t configuration )
+{
+    h->configuration    = configuration;
+    h->stats.configured = ( configuration != 0 );
+    h->stats.open       = false;
+
+    if( !configuration )
+    {
+        return;
+    }
+
+    HAL_USB_IN_EP( HAL_USB_EP_DATA )->DIEPCTL = USB_OTG_DIEPCTL_USBAEP
+                                                | ( HAL_USB_EPTYP_BULK << USB_OTG_DIEPCTL_EPTYP_Pos )
+                                                | ( HAL_USB_EP_DATA << USB_OTG_DIEPCTL_TXFNUM_Pos )
+                                                | USB_OTG_DIEPCTL_SD0PID_SEVNFRM
+                                                | USB_OTG_DIEPCTL_SNAK
+                                                | HAL_USB_PACKET_SIZE;
+
+    HAL_USB_OUT_EP( HAL_USB_EP_DATA )->DOEPCTL = USB_OTG_DOEPCTL_USBAEP
+                                                 | ( HAL_USB_EPTYP_BULK << USB_OTG_DOEPCTL_EPTYP_Pos )
+                                                 | USB_OTG_DOEPCTL_SD0PID_SEVNFRM
+                                                 | HAL_USB_PACKET_SIZE;
+
+    HAL_USB_IN_EP( HAL_USB_EP_NOTIFY )->DIEPCTL = USB_OTG_DIEPCTL_USBAEP
+                                                  | ( HAL_USB_EPTYP_INTERRUPT << USB_OTG_DIEPCTL_EPTYP_Pos )
+                                                  | ( HAL_USB_EP_NOTIFY << USB_OTG_DIEPCTL_TXFNUM_Pos )
+                                                  | USB_OTG_DIEPCTL_SD0PID_SEVNFRM
+                                                  | USB_OTG_DIEPCTL_SNAK
+                                                  | HAL_USB_NOTIFY_PACKET_SIZE;
+
+    HAL_USB_DEVICE->DAINTMSK |= ( 1U << HAL_USB_EP_DATA )
+                                | ( 1U << HAL_USB_EP_NOTIFY )
+                                | ( 1U << ( 16U + HAL_USB_EP_DATA ) );
+
+    h->rx_held = false;
+    hal_usb_rx_arm();
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Take one packet from the host
+
+PRIVATE void
+hal_usb_rx_arm( void )
+{
+    USB_OTG_OUTEndpointTypeDef *ep = HAL_USB_OUT_EP( HAL_USB_EP_DATA );
+
+    ep->DOEPTSIZ = ( 1U << USB_OTG_DOEPTSIZ_PKTCNT_Pos ) | HAL_USB_PACKET_SIZE;
+    ep->DOEPCTL |= USB_OTG_DOEPCTL_EPENA | USB_OTG_DOEPCTL_CNAK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Hand the filled block to the IN endpoint and switch callers over to the empty
+// one. Called with interrupts masked, or from the USB interrupt.
+
+PRIVATE void
+hal_usb_start_tx( HalUsb_t *h )
+{
+    HalUsbTxBlock_t *          block = &h->tx_block[h->tx_fill];
+    USB_OTG_INEndpointTypeDef *ep    = HAL_USB_IN_EP( HAL_USB_EP_DATA );
+
+    if( h->tx_busy || h->tx_reserved || !h->configuration )
+    {
+        return;
+    }
+
+    if( block->used )
+    {
+        uint32_t packets = ( block->used + HAL_USB_PACKET_SIZE - 1U ) / HAL_USB_PACKET_SIZE;
+
+        h->tx_length = block->used;
+        h->tx_fill ^= 1U;
+
+        ep->DIEPTSIZ = ( packets << USB_OTG_DIEPTSIZ_PKTCNT_Pos ) | block->used;
+        ep->DIEPCTL |= USB_OTG_DIEPCTL_EPENA | USB_OTG_DIEPCTL_CNAK;
+
+        // Empty after the last transfer completed, and the block fits it whole
+        hal_usb_fifo_write( HAL_USB_EP_DATA, block->data, block->used );
+
+        h->stats.tx_packets += packets;
+    }
+    else if( h->tx_zlp )
+    {
+        // A transfer ending on a packet boundary isn't finished for the host
+        // until a short packet arrives
+        h->tx_length = 0;
+
+        ep->DIEPTSIZ = ( 1U << USB_OTG_DIEPTSIZ_PKTCNT_Pos );
+        ep->DIEPCTL |= USB_OTG_DIEPCTL_EPENA | USB_OTG_DIEPCTL_CNAK;
+    }
+    else
+    {
+        return;
+    }
+
+    h->tx_zlp  = false;
+    h->tx_busy = true;
+}
+
+PRIVATE void
+hal_usb_completed_tx( HalUsb_t *h )
+{
+    if( h->tx_length )
+    {
+        h->tx_block[h->tx_fill ^ 1U].used = 0;
+        h->tx_zlp                         = ( h->tx_length % HAL_USB_PACKET_SIZE ) == 0;
+        h->stats.tx_bytes += h->tx_length;
+    }
+
+    h->tx_busy = false;
+
+    hal_usb_start_tx( h );
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,134 @@
+#ifndef HAL_USB_H
+#define HAL_USB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Forced device mode takes this long to settle, between init and start
+#define HAL_USB_MODE_SETTLE_MS 25U
+
+/* ----- Types ------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t rx_bytes;      // received from the host since boot
+    uint32_t tx_bytes;      // sent to the host since boot
+    uint32_t rx_packets;
+    uint32_t tx_packets;
+    uint32_t tx_dropped;    // bytes refused because the block was full or no host had the port open
+    uint32_t rx_held;       // times the OUT endpoint was left NAKing until the FIFO drained
+    uint16_t resets;        // bus resets, once per enumeration
+    bool     configured;    // the host has picked our configuration
+    bool     open;          // and a terminal program has the port open, DTR is set
+} HalUsbStats_t;
+
+/* -------------------------------------------------------------------------- */
+/* --- USB CDC INTERFACE                                                  --- */
+/* -------------------------------------------------------------------------- */
+
+/** Reset the OTG FS core into device mode. Returns false when the core
+ *  didn't come out of reset, otherwise call hal_usb_start() once
+ *  HAL_USB_MODE_SETTLE_MS have passed.
+ */
+
+PUBLIC bool
+hal_usb_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Set the core up as a CDC ACM device and connect to the bus */
+
+PUBLIC void
+hal_usb_start( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** True while a host has the virtual COM port open */
+
+PUBLIC bool
+hal_usb_is_open( void );
+
+/* -------------------------------------------------------------------------- */
+
+/* Non-blocking send for a number of characters, all or nothing.
+ * Returns the number of characters queued, 0 when they were dropped.
+ */
+
+PUBLIC uint32_t
+hal_usb_write( const uint8_t *data, uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes that can be queued without waiting */
+
+PUBLIC uint32_t
+hal_usb_tx_free( void );
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes queued behind the block the IN endpoint is sending */
+
+PUBLIC uint32_t
+hal_usb_tx_pending( void );
+
+/* -------------------------------------------------------------------------- */
+
+/* Borrow space in the transmit block to serialise into directly. Returns NULL
+ * when there isn't room for length bytes or no host has the port open.
+ * Nothing is sent until the matching hal_usb_tx_commit().
+ */
+
+PUBLIC uint8_t *
+hal_usb_tx_reserve( uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Queue the first length bytes of the open reservation, the rest is released */
+
+PUBLIC void
+hal_usb_tx_commit( uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+/* Borrow the longest contiguous run of received bytes without copying them.
+ * Returns its length, 0 when nothing is waiting. Call again after
+ * hal_usb_rx_consume() for anything stored at the start of the buffer.
+ */
+
+PUBLIC uint32_t
+hal_usb_rx_span( const uint8_t **data );
+
+/* -------------------------------------------------------------------------- */
+
+/* Release bytes handed out by hal_usb_rx_span(). Reopens the OUT endpoint
+ * if it was held off for want of room.
+ */
+
+PUBLIC void
+hal_usb_rx_consume( uint32_t length );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+hal_usb_stats( HalUsbStats_t *report );
+
+/* -------------------------------------------------------------------------- */
+
+void OTG_FS_IRQHandler( void );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USB_H */
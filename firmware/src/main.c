@@ -9,10 +9,12 @@
 
 #include "app_hardware.h"
 #include "app_tasks.h"
+#include "flight_recorder.h"
 #include "global.h"
 #include "hal_delay.h"
 #include "hal_system_speed.h"
 #include "hal_watchdog.h"
+#include "memory_watermark.h"
 #include "qassert.h"
 #include "status.h"
 
@@ -37,6 +39,8 @@ void system_clock_config( void );
 //application entry point from startup_stm32f429xx.s
 int main( void )
 {
+    memory_watermark_paint_stack();    // before the call depth grows
+
     init_core();              //Reset peripherals, init flash etc
     system_clock_config();    // Clocks
 
@@ -87,9 +91,11 @@ void init_core( void )
     NVIC_SetPriority( DebugMonitor_IRQn, NVIC_EncodePriority( NVIC_GetPriorityGrouping(), 0, 0 ) );
 
     // PendSV_IRQn interrupt configuration
-    NVIC_SetPriority( PendSV_IRQn, NVIC_EncodePriority( NVIC_GetPriorityGrouping(), 0, 0 ) );
+    // Runs the tick hooks and event timers, so it has to be masked by kernel critical sections
+    NVIC_SetPriority( PendSV_IRQn, NVIC_EncodePriority( NVIC_GetPriorityGrouping(), KERNEL_IRQ_PRIORITY, 0 ) );
 
     // SysTick_IRQn interrupt configuration
+    // Only keeps time, the hooks are deferred to PendSV
     NVIC_SetPriority( SysTick_IRQn, NVIC_EncodePriority( NVIC_GetPriorityGrouping(), 0, 0 ) );
 }
 
@@ -117,6 +123,9 @@ void system_clock_config( void )
     }
 
     LL_RCC_PLL_ConfigDomain_SYS( LL_RCC_PLLSOURCE_HSE, LL_RCC_PLLM_DIV_4, 168, LL_RCC_PLLP_DIV_2 );
+
+    // 336MHz VCO / 7 gives the 48MHz the USB core needs
+    LL_RCC_PLL_ConfigDomain_48M( LL_RCC_PLLSOURCE_HSE, LL_RCC_PLLM_DIV_4, 168, LL_RCC_PLLQ_DIV_7 );
     LL_RCC_PLL_Enable();
 
     while( LL_RCC_PLL_IsReady() != 1 )
@@ -147,6 +156,9 @@ void onAssert__( const char *file,
     int     len;
     memset( message, 0, sizeof( message ) );
 
+    // Preserve the event history leading up to this for after the reset
+    flight_recorder_fault( (uint16_t)line );
+
     // Format the printf part
     if( fmt && ( strlen( fmt ) > 0 ) )
     {
@@ -0,0 +1,90 @@
+/**
+ * @file      critical_section_audit.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Tracks the longest window interrupts were masked by a critical
+ *            section.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "critical_section_audit.h"
+
+/* ----- Private Variables -------------------------------------------------- */
+
+PRIVATE volatile uint32_t    longest_cycles = 0;
+PRIVATE volatile uint32_t    sections       = 0;
+PRIVATE volatile uint16_t    longest_line   = 0;
+PRIVATE const char *volatile longest_file   = NULL;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Called by CRITICAL_SECTION_END while interrupts are still masked */
+
+PUBLIC void
+critical_section_audit( uint8_t saved, uint32_t started, const char *file, uint16_t line )
+{
+    // Only the outermost section of a nested set ends the masked window
+    if( saved != 0 )
+    {
+        return;
+    }
+
+    uint32_t elapsed = CYCLE_COUNT() - started;
+
+    sections++;
+
+    if( elapsed > longest_cycles )
+    {
+        longest_cycles = elapsed;
+        longest_line   = line;
+        longest_file   = file;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+critical_section_audit_report( CriticalSectionAudit_t *report )
+{
+    const char *file;
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    report->cycles = longest_cycles;
+    report->count  = sections;
+    report->line   = longest_line;
+    file           = longest_file;
+    CRITICAL_SECTION_ALL_END();
+
+    memset( report->file, 0, sizeof( report->file ) );
+
+    if( file )
+    {
+        // Keep the end of the path, the file name is what matters
+        size_t length = strlen( file );
+        size_t keep   = MIN( length, sizeof( report->file ) - 1 );
+        memcpy( report->file, file + length - keep, keep );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+critical_section_audit_clear( void )
+{
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+    longest_cycles = 0;
+    sections       = 0;
+    longest_line   = 0;
+    longest_file   = NULL;
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,54 @@
+/**
+ * @file      critical_section_audit.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Tracks the longest window interrupts were masked by a critical
+ *            section, and where it ended. Only collects data when the build
+ *            defines CRITICAL_SECTION_AUDIT.
+ */
+
+#ifndef CRITICAL_SECTION_AUDIT_H
+#define CRITICAL_SECTION_AUDIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t cycles;      // longest masked window
+    uint32_t count;       // outermost critical sections seen
+    uint16_t line;        // where the longest window was ended
+    char     file[22];
+} CriticalSectionAudit_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Copy out the longest window since the last clear */
+
+PUBLIC void
+critical_section_audit_report( CriticalSectionAudit_t *report );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+critical_section_audit_clear( void );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* CRITICAL_SECTION_AUDIT_H */
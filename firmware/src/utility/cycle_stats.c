@@ -0,0 +1,84 @@
+/**
+ * @file      cycle_stats.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Min/avg/max of DWT cycle counts over a reporting window.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "cycle_stats.h"
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+cycle_stats_clear( CycleStats_t *stats )
+{
+    stats->min   = UINT32_MAX;
+    stats->max   = 0;
+    stats->count = 0;
+    stats->total = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+cycle_stats_add( CycleStats_t *stats, uint32_t started )
+{
+    uint32_t now     = CYCLE_COUNT();
+    uint32_t elapsed = now - started;
+
+    // Handlers at different priorities share stats, so a nested update
+    // mustn't land part way through this one
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    if( elapsed < stats->min )
+    {
+        stats->min = elapsed;
+    }
+
+    if( elapsed > stats->max )
+    {
+        stats->max = elapsed;
+    }
+
+    stats->count++;
+    stats->total += elapsed;
+
+    CRITICAL_SECTION_ALL_END();
+
+    return now;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+cycle_stats_take( CycleStats_t *stats, CycleReport_t *report )
+{
+    // Interrupt handler stats are updated above the kernel priority
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    if( stats->count )
+    {
+        report->min = stats->min;
+        report->avg = (uint32_t)( stats->total / stats->count );
+    }
+    else
+    {
+        report->min = 0;
+        report->avg = 0;
+    }
+    report->max   = stats->max;
+    report->count = stats->count;
+
+    cycle_stats_clear( stats );
+
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,74 @@
+/**
+ * @file      cycle_stats.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Min/avg/max of DWT cycle counts spent in a piece of code, over a
+ *            reporting window.
+ */
+
+#ifndef CYCLE_STATS_H
+#define CYCLE_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t total;
+} CycleStats_t;
+
+// Window summary as sent to the UI
+typedef struct
+{
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t count;
+} CycleReport_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+cycle_stats_clear( CycleStats_t *stats );
+
+/* -------------------------------------------------------------------------- */
+
+/** Add the cycles elapsed since 'started' (a CYCLE_COUNT() value).
+ *  Returns the current cycle count so consecutive sections can be chained.
+ *  Safe to call from interrupts of any priority.
+ */
+
+PUBLIC uint32_t
+cycle_stats_add( CycleStats_t *stats, uint32_t started );
+
+/* -------------------------------------------------------------------------- */
+
+/** Summarise the window so far and start a new one. Safe against the stats
+ *  being updated from an interrupt.
+ */
+
+PUBLIC void
+cycle_stats_take( CycleStats_t *stats, CycleReport_t *report );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* CYCLE_STATS_H */
@@ -218,6 +218,24 @@ eventPoolGarbageCollect( StateEvent *e )
     }
 }
 
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+eventPoolHighWater( uint8_t poolId, uint16_t *peak, uint16_t *total )
+{
+    if( ( poolId == 0 ) || ( poolId > eventPoolMax ) || ( eventPool[poolId-1].eventSize == 0 ) )
+    {
+        return false;
+    }
+
+    EventPool *p = &eventPool[poolId-1];
+
+    *peak  = p->totalEvents - p->minimumEvents;
+    *total = p->totalEvents;
+
+    return true;
+}
+
 /* ----------------------- Private Functions ------------------------------- */
 
 //! Initialise a pool structure and set it up with a linked list
@@ -119,6 +119,16 @@ eventPoolDeleteEvent( StateEvent *e );
 
 /* -------------------------------------------------------------------------- */
 
+/** Report the most events that were allocated at once from a pool, and the
+ *  number of events it holds. Pool ids start at 1 as returned by
+ *  eventPoolAddStorage. Returns false when there is no such pool.
+ */
+
+PUBLIC bool
+eventPoolHighWater( uint8_t poolId, uint16_t *peak, uint16_t *total );
+
+/* -------------------------------------------------------------------------- */
+
 /** After a state machine has executed an event, this function decrements
  *  the usage counter on the event and deletes it when usage becomes 0.
  */
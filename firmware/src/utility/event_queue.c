@@ -50,6 +50,8 @@ PUBLIC EventQueue *eventQueueInit( EventQueue * restrict me,
         // Counters to keep track of usage
         me->used       = 0;
         me->max        = 0;
+        me->seqIn      = 0;
+        me->seqOut     = 0;
     }
     else
     {
@@ -61,6 +63,8 @@ PUBLIC EventQueue *eventQueueInit( EventQueue * restrict me,
         me->tail       = 0;
         me->used       = 0;
         me->max        = 0;
+        me->seqIn      = 0;
+        me->seqOut     = 0;
     }
     return me;
 }
@@ -85,6 +89,16 @@ eventQueueUsed( EventQueue * restrict queue )
 
 /* -------------------------------------------------------------------------- */
 
+//! Return the most events held in the ring-buffer at once, the event kept
+/// in front is not counted so this compares directly against the storage size.
+PUBLIC uint8_t
+eventQueueHighWater( EventQueue * restrict queue )
+{
+    return queue ? queue->max : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
 //! Retrieve an event from the queue or NULL when it is empty
 PUBLIC StateEvent *
 eventQueueGet( EventQueue * restrict queue )
@@ -100,6 +114,11 @@ eventQueueGet( EventQueue * restrict queue )
     // Get the front event
     e = queue->front;
 
+    if( e )
+    {
+        queue->seqOut++;
+    }
+
     // Update the house keeping
     if( queue->used > 0 ) // something in the queue?
     {
@@ -195,6 +214,11 @@ eventQueuePutFIFO( EventQueue * restrict queue, StateEvent * restrict e )
             eventQueued = false;
         }
     }
+
+    if( eventQueued )
+    {
+        queue->seqIn++;
+    }
     CRITICAL_SECTION_END();
     return eventQueued;
 }
@@ -266,6 +290,12 @@ eventQueuePutLIFO( EventQueue * restrict queue, StateEvent * restrict e )
             eventQueued = false;
         }
     }
+
+    // Goes ahead of everything queued so far, as if taken one less time
+    if( eventQueued )
+    {
+        queue->seqOut--;
+    }
     CRITICAL_SECTION_END();
     return eventQueued;
 }
@@ -285,12 +315,34 @@ eventQueueFlush( EventQueue * restrict queue )
     CRITICAL_SECTION_VAR();
     CRITICAL_SECTION_START();
 
-    queue->head  = 0;
-    queue->tail  = 0;
-    queue->front = NULL;
-    queue->used  = 0;
+    queue->head   = 0;
+    queue->tail   = 0;
+    queue->front  = NULL;
+    queue->used   = 0;
+    queue->seqOut = queue->seqIn;
 
     CRITICAL_SECTION_END();
 }
 
+/* -------------------------------------------------------------------------- */
+
+//! Events posted to a task through another queue are stamped with this on
+/// arrival, so they can be held back until the events that were queued here
+/// before them have been handled.
+PUBLIC uint16_t
+eventQueueStamp( EventQueue * restrict queue )
+{
+    return queue->seqIn;
+}
+
+/* -------------------------------------------------------------------------- */
+
+//! The front check covers an emptied queue, whatever the counters say.
+PUBLIC bool
+eventQueueReached( EventQueue * restrict queue, uint16_t stamp )
+{
+    return ( queue->front == NULL )
+           || ( (int16_t)( queue->seqOut - stamp ) >= 0 );
+}
+
 /* ----- End ---------------------------------------------------------------- */
@@ -42,6 +42,8 @@ struct EventQueue
     uint8_t     nTotal;       ///< total # of entries in the buffer
     uint8_t     used;         ///< # of elements used in the buffer
     uint8_t     max;          ///< maximum # of events ever in the buffer
+    uint16_t    seqIn;        ///< # of FIFO events ever queued, free running
+    uint16_t    seqOut;       ///< # of events ever taken, less LIFO events
     StateEvent  * restrict front;       ///< pointer to event at the front of the queue
     StateEvent  * restrict *entries;    ///< pointer to event pointer array
 };
@@ -58,6 +60,10 @@ eventQueueInit( EventQueue * restrict queue,
 PUBLIC uint8_t
 eventQueueUsed( EventQueue * restrict queue );
 
+//! Return the most events that were in the queue at once
+PUBLIC uint8_t
+eventQueueHighWater( EventQueue * restrict queue );
+
 //! Retrieve an event from the queue
 PUBLIC StateEvent *
 eventQueueGet( EventQueue * restrict queue );
@@ -78,6 +84,14 @@ eventQueuePutLIFO( EventQueue * restrict queue, StateEvent *ve );
 PUBLIC void
 eventQueueFlush( EventQueue * restrict queue );
 
+//! Stamp for an event held outside the queue, taken when it arrives
+PUBLIC uint16_t
+eventQueueStamp( EventQueue * restrict queue );
+
+//! Return true once every FIFO event queued ahead of the stamp has been taken
+PUBLIC bool
+eventQueueReached( EventQueue * restrict queue, uint16_t stamp );
+
 /* ----------------------- End --------------------------------------------- */
 
 #ifdef __cplusplus
@@ -0,0 +1,129 @@
+/**
+ * @file      event_spsc.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Lock-free single producer, single consumer event queue.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "event_spsc.h"
+#include "qassert.h"
+
+/* -------------------------------------------------------------------------- */
+
+DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+eventSpscInit( EventSpsc  *queue,
+               StateEvent *storage[],
+               uint16_t   stamps[],
+               uint16_t   num_entries )
+{
+    REQUIRE( queue );
+    REQUIRE( storage );
+    REQUIRE( stamps );
+
+    // The free running indexes rely on the size dividing 2^16
+    REQUIRE( num_entries > 0 && num_entries <= 0x8000U );
+    REQUIRE( ( num_entries & ( num_entries - 1U ) ) == 0 );
+
+    queue->entries = storage;
+    queue->stamps  = stamps;
+    queue->mask    = num_entries - 1U;
+    queue->head    = 0;
+    queue->tail    = 0;
+    queue->max     = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+eventSpscPut( EventSpsc *queue, StateEvent *e, uint16_t stamp )
+{
+    uint16_t head = queue->head;
+    uint16_t used = (uint16_t)( head - queue->tail );
+
+    REQUIRE( e );
+
+    if( used > queue->mask )
+    {
+        return false;
+    }
+
+    if( e->dynamic.poolId != 0 )
+    {
+        e->dynamic.useCount++;
+    }
+
+    queue->entries[head & queue->mask] = e;
+    queue->stamps[head & queue->mask]  = stamp;
+
+    // The entry has to be in place before the consumer can see it
+    MEMORY_BARRIER();
+    queue->head = head + 1U;
+
+    if( used + 1U > queue->max )
+    {
+        queue->max = used + 1U;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC StateEvent *
+eventSpscGet( EventSpsc *queue )
+{
+    uint16_t   tail = queue->tail;
+    StateEvent *e;
+
+    if( tail == queue->head )
+    {
+        return NULL;
+    }
+
+    // Don't read the entry before seeing the head that published it
+    MEMORY_BARRIER();
+    e = queue->entries[tail & queue->mask];
+
+    // and finish with it before handing the slot back
+    MEMORY_BARRIER();
+    queue->tail = tail + 1U;
+
+    return e;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+eventSpscPeekStamp( EventSpsc *queue, uint16_t *stamp )
+{
+    uint16_t tail = queue->tail;
+
+    if( tail == queue->head )
+    {
+        return false;
+    }
+
+    MEMORY_BARRIER();
+    *stamp = queue->stamps[tail & queue->mask];
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint16_t
+eventSpscUsed( EventSpsc *queue )
+{
+    return (uint16_t)( queue->head - queue->tail );
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,87 @@
+/**
+ * @file      event_spsc.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Lock-free event queue for exactly one producer and one consumer,
+ *            e.g. an interrupt handler posting to a task. Neither side locks
+ *            out interrupts.
+ *
+ * @note      Sizes are a power of two up to 32768 entries. The producer adds
+ *            the event reference, so a dynamic event must only be posted from
+ *            one interrupt level at a time.
+ */
+
+#ifndef EVENT_SPSC_H
+#define EVENT_SPSC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+#include "state_event.h"
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    StateEvent        **entries;
+    uint16_t          *stamps;  // ordering stamp per entry, given by the producer
+    uint16_t          mask;     // size - 1
+    volatile uint16_t head;     // free running, only written by the producer
+    volatile uint16_t tail;     // free running, only written by the consumer
+    uint16_t          max;      // most events ever waiting, kept by the producer
+} EventSpsc;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+eventSpscInit( EventSpsc  *queue,
+               StateEvent *storage[],
+               uint16_t   stamps[],
+               uint16_t   num_entries );
+
+/* -------------------------------------------------------------------------- */
+
+/** Producer side. Returns false when the queue is full. The stamp travels
+ *  with the event, see eventSpscPeekStamp.
+ */
+
+PUBLIC bool
+eventSpscPut( EventSpsc *queue, StateEvent *e, uint16_t stamp );
+
+/* -------------------------------------------------------------------------- */
+
+/** Consumer side. Returns NULL when the queue is empty. */
+
+PUBLIC StateEvent *
+eventSpscGet( EventSpsc *queue );
+
+/* -------------------------------------------------------------------------- */
+
+/** Consumer side. Stamp of the next event, returns false when the queue is empty. */
+
+PUBLIC bool
+eventSpscPeekStamp( EventSpsc *queue, uint16_t *stamp );
+
+/* -------------------------------------------------------------------------- */
+
+/** Events waiting, a snapshot when called from the other side */
+
+PUBLIC uint16_t
+eventSpscUsed( EventSpsc *queue );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* EVENT_SPSC_H */
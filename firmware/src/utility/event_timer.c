@@ -10,6 +10,7 @@
 
 /* ----- System Includes ---------------------------------------------------- */
 
+#include <string.h>
 
 /* ----- Local Includes ----------------------------------------------------- */
 
@@ -32,9 +33,24 @@ eventTimerAdd( EventTimer              *me,
 PRIVATE void
 eventTimerRemove( EventTimer *me );
 
+PRIVATE void
+eventTimerLink( EventTimer *timer );
+
+PRIVATE void
+eventTimerUnlink( EventTimer *timer );
+
+PRIVATE uint32_t
+eventTimerCascade( uint32_t level );
+
 /* ----------------------- Private Data & Variables ------------------------ */
 
-PRIVATE EventTimer *EventTimerListHead;    // head of linked list of timers
+// Slot lists of the timing wheel. Level 0 holds timers due within the next
+// EVENT_TIMER_WHEEL_SLOTS ticks, each higher level covers a range that is
+// EVENT_TIMER_WHEEL_SLOTS times longer and gets cascaded down as time passes.
+PRIVATE EventTimer *EventTimerWheel[EVENT_TIMER_WHEEL_LEVELS][EVENT_TIMER_WHEEL_SLOTS];
+
+PRIVATE EventTimerCounter EventTimerNow;      // tick count last processed
+PRIVATE uint32_t          EventTimersArmed;   // number of linked timers
 
 /* ----- Public Functions --------------------------------------------------- */
 
@@ -42,7 +58,9 @@ PRIVATE EventTimer *EventTimerListHead;    // head of linked list of timers
 PUBLIC void
 eventTimerInit( void )
 {
-  EventTimerListHead = NULL;
+  memset( EventTimerWheel, 0, sizeof(EventTimerWheel) );
+  EventTimerNow    = 0;
+  EventTimersArmed = 0;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -106,10 +124,17 @@ eventTimerRestart( EventTimer        *me,
                    EventTimerCounter timeTicks )
 {
     REQUIRE( timeTicks > 0 );
+    REQUIRE( timeTicks <= EVENT_TIMER_MAX_TICKS );
 
     CRITICAL_SECTION_VAR();
     CRITICAL_SECTION_START();
-    me->counter = timeTicks;
+    if( me->timeoutTask != 0 )
+    {
+        // Move the timer to the slot matching the new expiry
+        eventTimerUnlink( me );
+        me->expires = EventTimerNow + timeTicks;
+        eventTimerLink( me );
+    }
     CRITICAL_SECTION_END();
 }
 
@@ -140,46 +165,71 @@ eventTimerStopIfActive( EventTimer *me )
 PUBLIC void
 eventTimerTick( void )
 {
-  EventTimer *t;   //<! Current timer to evaluate
+  EventTimer **slot;  //<! Level 0 slot due this tick
+  EventTimer *t;      //<! Current timer to evaluate
+  uint32_t   level;
 
-  t = EventTimerListHead;
-  while( t != 0 )
+  EventTimerNow++;
+
+  // Each time a level wraps, the current slot of the level above is
+  // redistributed over the lower levels.
+  level = 0;
+  while( level < ( EVENT_TIMER_WHEEL_LEVELS - 1 )
+         && eventTimerCascade( level + 1 ) == 0 )
   {
-    if( --t->counter == 0 )  // when we reach 0 we fire the event
-    {
-      ASSERT( t->timeoutTask  != 0 );
-      ASSERT( t->timeoutEvent != 0 );
+    level++;
+  }
+
+  // Only timers that expire this tick are in the slot. Re-armed timers
+  // always land in a later slot so the loop terminates.
+  slot = &EventTimerWheel[0][EventTimerNow & ( EVENT_TIMER_WHEEL_SLOTS - 1 )];
+  while( ( t = *slot ) != 0 )
+  {
+    ASSERT( t->timeoutTask  != 0 );
+    ASSERT( t->timeoutEvent != 0 );
+    ASSERT( t->expires      == EventTimerNow );
 
-      // Fire the event
-      if( stateTaskPostFIFO( (StateTask*)t->timeoutTask,
-                             t->timeoutEvent ) )
+    eventTimerUnlink( t );
+
+    // Fire the event through the lock-free inbox
+    if( stateTaskPostInbox( (StateTask*)t->timeoutTask,
+                            t->timeoutEvent ) )
+    {
+      if( t->interval != 0 )       // Multishot timer?
       {
-        if( t->interval != 0 )       // Multishot timer?
-        {
-          t->counter = t->interval;  // Rearm multishot timers
-        }
-        else
-        {
-          eventTimerRemove( t );     // Remove single shot timers
-        }
+        t->expires = EventTimerNow + t->interval;  // Rearm multishot timers
+        eventTimerLink( t );
       }
       else
       {
-        // Failed to queue the timer event. As a fallback measure, bump
-        // the counter up and allow it to be tried again the next tick.
-        t->counter++;
+        // Flag single shot timers as inactive
+        t->timeoutEvent = 0;
+        t->timeoutTask  = 0;
+        EventTimersArmed--;
       }
     }
-
-    // This is safe because the eventTimerRemove leaves
-    // the next and previous timers alone.
-    t = t->next;
+    else
+    {
+      // Failed to queue the timer event. As a fallback measure, bump
+      // the expiry up and allow it to be tried again the next tick.
+      t->expires = EventTimerNow + 1;
+      eventTimerLink( t );
+    }
   }
 }
 
+/* -------------------------------------------------------------------------- */
+
+//! Return true when there are one or more timers running
+PUBLIC bool
+eventTimersRunning( void )
+{
+  return ( EventTimersArmed != 0 );
+}
+
 /* ----------------------- Private Functions ------------------------------- */
 
-//! Create a new timer and link it in the list for servicing.
+//! Arm a timer and link it in the wheel for servicing.
 PRIVATE void
 eventTimerAdd( EventTimer              *timer,
                const StateTask         *timeoutTask,
@@ -193,60 +243,82 @@ eventTimerAdd( EventTimer              *timer,
     REQUIRE( timeoutTask     != 0 );
     REQUIRE( timeoutEvent    != 0 );
     REQUIRE( timeTicks       >  0 );
+    REQUIRE( timeTicks       <= EVENT_TIMER_MAX_TICKS );
 
     // Setup the timer data
     timer->timeoutTask  = timeoutTask;
     timer->timeoutEvent = timeoutEvent;
-    timer->counter      = timeTicks;
 
-    // Link timer into the list (just at the beginning...)
     CRITICAL_SECTION_VAR();
     CRITICAL_SECTION_START();
-    if( EventTimerListHead == 0 )
-    {
-        // New and only event in queue.
+    timer->expires = EventTimerNow + timeTicks;
+    eventTimerLink( timer );
+    EventTimersArmed++;
+    CRITICAL_SECTION_END();
+}
 
-        // Make EventTimerListHead point to this event.
-        EventTimerListHead = timer;
+/* -------------------------------------------------------------------------- */
 
-        // Clear the next and previous pointers.
-        timer->next           = 0;
-        timer->previous       = 0;
-    }
-    else
-    {
-        // Existing events in the queue.
+//! Remove an existing timer from the wheel
+PRIVATE void eventTimerRemove( EventTimer *timer )
+{
+    // check that this timer was actually in use.
+    REQUIRE( timer->timeoutTask != 0 );
 
-        // Make this event point to the current queue head.
-        timer->next           = EventTimerListHead;
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_START();
 
-        // Queue head event point to this event.
-        timer->next->previous = timer;
+    eventTimerUnlink( timer );
+    EventTimersArmed--;
 
-        // Current queue head event becomes this event.
-        EventTimerListHead = timer;
+    // Flag this timer as inactive
+    timer->expires      = 0;
+    timer->interval     = 0;
+    timer->timeoutEvent = 0;
+    timer->timeoutTask  = 0;
 
-        // At the head of the queue, there is no previous.
-        timer->previous       = 0;
-    }
     CRITICAL_SECTION_END();
 }
 
 /* -------------------------------------------------------------------------- */
 
-//! Remove an existing timer from the service list
-PRIVATE void eventTimerRemove( EventTimer *timer )
+//! Link a timer at the head of the wheel slot for its expiry tick.
+/// The level is picked from the distance to the expiry so the timer is
+/// cascaded down exactly when its level 0 slot comes around.
+/// Must be called with interrupts locked.
+PRIVATE void
+eventTimerLink( EventTimer *timer )
 {
-    // check that this timer was actually in use.
-    REQUIRE( timer->timeoutTask != 0 );
+    EventTimerCounter delta = timer->expires - EventTimerNow;
+    uint32_t          level = 0;
 
-    CRITICAL_SECTION_VAR();
-    CRITICAL_SECTION_START();
+    while( level < ( EVENT_TIMER_WHEEL_LEVELS - 1 )
+           && delta >= ( 1UL << ( EVENT_TIMER_WHEEL_BITS * ( level + 1 ) ) ) )
+    {
+        level++;
+    }
+
+    timer->slot = &EventTimerWheel[level][( timer->expires >> ( EVENT_TIMER_WHEEL_BITS * level ) )
+                                          & ( EVENT_TIMER_WHEEL_SLOTS - 1 )];
+
+    timer->previous = 0;
+    timer->next     = *timer->slot;
+    if( timer->next != 0 )
+    {
+        timer->next->previous = timer;
+    }
+    *timer->slot = timer;
+}
 
-    // Remove timer from the tick handler chain
+/* -------------------------------------------------------------------------- */
+
+//! Unlink a timer from its wheel slot. Must be called with interrupts locked.
+PRIVATE void
+eventTimerUnlink( EventTimer *timer )
+{
     if( timer->previous == 0 )
     {
-        EventTimerListHead = timer->next;
+        *timer->slot = timer->next;
     }
     else
     {
@@ -258,16 +330,37 @@ PRIVATE void eventTimerRemove( EventTimer *timer )
         timer->next->previous = timer->previous;
     }
 
-    // Flag this timer as inactive but leave the next and
-    // previous pointers alone as they are still needed in
-    // eventTimerTick function to traverse the list of timers.
-    // They get re-initialised when the timer is Added again.
-    timer->counter      = 0;
-    timer->interval     = 0;
-    timer->timeoutEvent = 0;
-    timer->timeoutTask  = 0;
+    timer->next     = 0;
+    timer->previous = 0;
+    timer->slot     = 0;
+}
 
-    CRITICAL_SECTION_END();
+/* -------------------------------------------------------------------------- */
+
+//! Redistribute the current slot of a level once the level below wrapped.
+/// Returns the slot index so the caller knows when the next level wrapped too.
+PRIVATE uint32_t
+eventTimerCascade( uint32_t level )
+{
+    uint32_t   shift = EVENT_TIMER_WHEEL_BITS * level;
+    uint32_t   index;
+    EventTimer *t;
+
+    // Nothing to do unless all the lower level indexes just wrapped to 0
+    if( ( EventTimerNow & ( ( 1UL << shift ) - 1 ) ) != 0 )
+    {
+        return 1;
+    }
+
+    index = ( EventTimerNow >> shift ) & ( EVENT_TIMER_WHEEL_SLOTS - 1 );
+
+    while( ( t = EventTimerWheel[level][index] ) != 0 )
+    {
+        eventTimerUnlink( t );
+        eventTimerLink( t );
+    }
+
+    return index;
 }
 
 /* ----- End ---------------------------------------------------------------- */
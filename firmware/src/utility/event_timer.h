@@ -33,6 +33,19 @@ extern "C" {
 #include "global.h"
 #include "state_task.h"
 
+/* ----- Defines ------------------------------------------------------------ */
+
+//! Armed timers are kept in a hierarchical timing wheel. Each level has
+/// 2^EVENT_TIMER_WHEEL_BITS slots and covers that many times the range of
+/// the level below it, so arming, stopping and ticking don't depend on the
+/// number of armed timers.
+#define EVENT_TIMER_WHEEL_BITS   6U
+#define EVENT_TIMER_WHEEL_SLOTS  ( 1U << EVENT_TIMER_WHEEL_BITS )
+#define EVENT_TIMER_WHEEL_LEVELS 5U
+
+//! Longest timeout the wheel can hold, in ticks
+#define EVENT_TIMER_MAX_TICKS    ( ( 1UL << ( EVENT_TIMER_WHEEL_BITS * EVENT_TIMER_WHEEL_LEVELS ) ) - 1U )
+
 /* ----- Types -------------------------------------------------------------- */
 
 //! Declare the size of the timer counters used.
@@ -43,9 +56,10 @@ struct EventTimer
 {
   const StateEvent       *timeoutEvent; //<! signal to generate upon timeout
   const StateTask        *timeoutTask;  //<! active task to deliver the event to
-  EventTimer        *next;         //<! link to next timer in the list
-  EventTimer        *previous;     //<! link to previous timer in the list
-  EventTimerCounter counter;       //<! timer counting down to 0 to fire the event
+  EventTimer        *next;         //<! link to next timer in the wheel slot
+  EventTimer        *previous;     //<! link to previous timer in the wheel slot
+  EventTimer        **slot;        //<! wheel slot the timer is linked into
+  EventTimerCounter expires;       //<! tick count at which the event fires
   EventTimerCounter interval;      //<! reload value for repeating timers. 0 for single shot
 };
 
@@ -98,7 +112,9 @@ eventTimerIsActive( EventTimer *me );
 PUBLIC void
 eventTimerStopIfActive( EventTimer *me );
 
-//! eventTimerTick to be called from the system tick interrrupt handler
+//! eventTimerTick to be called from the system tick interrrupt handler.
+/// Any periodic interrupt can drive it, timeouts are counted in calls to
+/// this function (see MS_TO_TICKS/US_TO_TICKS).
 PUBLIC void
 eventTimerTick( void );
 
@@ -12,15 +12,16 @@
 
 /* ----- System Includes ---------------------------------------------------- */
 
+#include <string.h>
 
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "fifo.h"
+#include "qassert.h"
 
-/* ----- Private Prototypes ------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 
-PRIVATE uint32_t
-fifo_next( fifo_t * restrict f, uint32_t index );
+DEFINE_THIS_FILE; /* Used for ASSERT checks to define __FILE__ only once */
 
 /* ----- Public Functions --------------------------------------------------- */
 
@@ -29,229 +30,213 @@ fifo_next( fifo_t * restrict f, uint32_t index );
 PUBLIC void
 fifo_init( fifo_t * restrict f, uint8_t * buf, uint32_t buf_size )
 {
-     f->head     = 0;
-     f->tail     = 0;
-     f->capacity = buf_size;
-     f->buf      = buf;
+    REQUIRE( buf );
+
+    // The free running indexes rely on masking instead of wrapping
+    REQUIRE( buf_size > 0 && ( buf_size & ( buf_size - 1U ) ) == 0 );
+
+    f->buf  = buf;
+    f->mask = buf_size - 1U;
+    f->head = 0;
+    f->tail = 0;
+    f->max  = 0;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data in use in the fifo.
-  * This can be at max the capacity less 1
-  */
+/** Returns the number of bytes the fifo can hold. */
 
 PUBLIC uint32_t
 fifo_size( fifo_t * restrict f )
 {
-    return f->capacity - 1;
+    return f->mask + 1U;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data in use in the fifo.
-  * This can be at max the capacity less 1
-  */
-
 PUBLIC uint32_t
 fifo_used( fifo_t * restrict f )
 {
-    if( f->head != f->tail )
-    {
-        if( f->head > f->tail )
-        {
-            return f->head - f->tail;
-        }
-        else
-        {
-            return f->head - f->tail + f->capacity;
-        }
-    }
-    return 0;
+    return f->head - f->tail;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data in a sequential run in the fifo
-  * i.e doesn't count bytes which cross over the overflow boundary
-  * This can be at max the capacity less 1
-  */
-
 PUBLIC uint32_t
-fifo_used_linear( fifo_t * restrict f )
+fifo_free( fifo_t * restrict f )
 {
-    if( f->head != f->tail )
-    {
-        if( f->head > f->tail )
-        {
-            return f->head - f->tail;
-        }
-        else
-        {
-            return f->capacity - f->tail;   // from tail to end of buffer
-        }
-    }
-    return 0;
+    return fifo_size( f ) - fifo_used( f );
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data free in the fifo. */
-
 PUBLIC uint32_t
-fifo_free( fifo_t * restrict f )
+fifo_high_water( fifo_t * restrict f )
 {
-    return fifo_size( f ) - fifo_used( f );
+    return f->max;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Write a byte to the FIFO. Return true when OK */
-
 PUBLIC bool
 fifo_put( fifo_t * restrict f, const uint8_t ch )
 {
-    const uint32_t new_head = fifo_next( f, f->head );
-    if( new_head != f->tail )
+    uint8_t *span;
+
+    if( fifo_write_span( f, &span ) == 0 )
     {
-        f->buf[f->head] = ch;
-        f->head = new_head;
-        return true;    /* successfully added to queue */
+        return false;    // no more room
     }
-    return false; //no more room
+
+    *span = ch;
+    fifo_write_commit( f, 1 );
+
+    return true;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Get a byte from the FIFO. Return NULL when empty */
-
-PUBLIC uint8_t *
-fifo_get( fifo_t * restrict f )
+PUBLIC bool
+fifo_get( fifo_t * restrict f, uint8_t * ch )
 {
-    if( f->tail != f->head )
+    if( !fifo_peek( f, ch ) )
     {
-        uint8_t * ch = &f->buf[f->tail];
-        f->tail = fifo_next( f, f->tail );
-        return ch;
+        return false;
     }
-    return NULL;
+
+    fifo_read_commit( f, 1 );
+
+    return true;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Peek a byte from the FIFO. Return NULL when empty */
-
-PUBLIC uint8_t *
-fifo_peek( fifo_t * restrict f )
+PUBLIC bool
+fifo_peek( fifo_t * restrict f, uint8_t * ch )
 {
-    if( f->tail != f->head )
+    const uint8_t *span;
+
+    if( fifo_read_span( f, &span ) == 0 )
     {
-        uint8_t * ch = &f->buf[f->tail];
-        return ch;
+        return false;
     }
-    return NULL;
+
+    *ch = *span;
+
+    return true;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Writes up to nbytes bytes to the FIFO
- *  If the head runs in to the tail, not all bytes are written
- *  The number of bytes written is returned
- */
-
 PUBLIC uint32_t
 fifo_write( fifo_t * restrict f, const uint8_t * buf, uint32_t nbytes )
 {
-     uint32_t count = 0;
-     for( uint32_t i = 0; i < nbytes; i++ )
-     {
-         if( fifo_put( f, buf[i] ) )
-         {
-             count++;
-         }
-         else
-         {
-             break;
-         }
+    uint32_t count = 0;
+
+    // At most two spans, up to the end of the buffer then from its start
+    for( uint8_t pass = 0; pass < 2 && count < nbytes; pass++ )
+    {
+        uint8_t *span;
+        uint32_t length = MIN( fifo_write_span( f, &span ), nbytes - count );
+
+        if( length == 0 )
+        {
+            break;
+        }
+
+        memcpy( span, &buf[count], length );
+        fifo_write_commit( f, length );
+        count += length;
     }
+
     return count;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Reads nbytes bytes from the FIFO. The number of bytes read is returned */
-
 PUBLIC uint32_t
 fifo_read( fifo_t * restrict f, uint8_t * buf, uint32_t nbytes )
 {
-     uint32_t count = 0;
-     for( uint32_t i = 0; i < nbytes; i++ )
-     {
-         uint8_t * p = fifo_get( f );
-         if( p )
-         {
-             buf[i] = *p;
-             count++;
-         }
-         else
-         {
-             break;
-         }
-     }
-     return count;
+    uint32_t count = 0;
+
+    for( uint8_t pass = 0; pass < 2 && count < nbytes; pass++ )
+    {
+        const uint8_t *span;
+        uint32_t       length = MIN( fifo_read_span( f, &span ), nbytes - count );
+
+        if( length == 0 )
+        {
+            break;
+        }
+
+        memcpy( &buf[count], span, length );
+        fifo_read_commit( f, length );
+        count += length;
+    }
+
+    return count;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns a pointer to the tail position. If the nbytes length is illegal, returns null */
+PUBLIC uint32_t
+fifo_write_span( fifo_t * restrict f, uint8_t ** span )
+{
+    uint32_t head   = f->head;
+    uint32_t offset = head & f->mask;
+    uint32_t room   = fifo_size( f ) - ( head - f->tail );
 
-PUBLIC uint32_t*
-fifo_get_tail_ptr( fifo_t * restrict f, uint32_t nbytes )
+    // Don't write into space before seeing the tail that released it
+    MEMORY_BARRIER();
+
+    *span = &f->buf[offset];
+
+    return MIN( room, fifo_size( f ) - offset );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+fifo_write_commit( fifo_t * restrict f, uint32_t nbytes )
 {
-    uint32_t *ptr = NULL;
+    uint32_t head = f->head + nbytes;
+    uint32_t used = head - f->tail;
 
-    if( nbytes <= fifo_used_linear(f)  )
+    // The data has to be in place before the consumer can see it
+    MEMORY_BARRIER();
+    f->head = head;
+
+    if( used > f->max )
     {
-        ptr = &f->buf[f->tail];
+        f->max = used;
     }
-
-    return ptr;
 }
 
 /* -------------------------------------------------------------------------- */
 
-/** Moves/flushes the tail forward by nbytes */
-
 PUBLIC uint32_t
-fifo_skip( fifo_t * restrict f, uint32_t nbytes )
+fifo_read_span( fifo_t * restrict f, const uint8_t ** span )
 {
-    if( nbytes <= fifo_used_linear(f) )
-    {
-        f->tail += nbytes;
+    uint32_t tail   = f->tail;
+    uint32_t offset = tail & f->mask;
+    uint32_t used   = f->head - tail;
 
-        if( f->tail >= f->capacity )
-        {
-            f->tail = 0;
-        }
+    // Don't read the data before seeing the head that published it
+    MEMORY_BARRIER();
 
-        return nbytes;
-    }
+    *span = &f->buf[offset];
 
-    return 0;
+    return MIN( used, fifo_size( f ) - offset );
 }
 
-/* ----- Private Functions -------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 
-PRIVATE uint32_t
-fifo_next( fifo_t * restrict f, uint32_t index )
+PUBLIC void
+fifo_read_commit( fifo_t * restrict f, uint32_t nbytes )
 {
-    uint32_t current = index;
-    current++;
-    if( current >= f->capacity )
-    {
-        current = 0;
-    }
-    return current;
+    // Finish with the data before handing the space back
+    MEMORY_BARRIER();
+    f->tail += nbytes;
 }
 
 /* ----- End ---------------------------------------------------------------- */
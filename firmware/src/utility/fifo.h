@@ -3,7 +3,13 @@
  *
  * @ingroup   utility
  *
- * @brief     Basic buffer based FIFO capability.
+ * @brief     Buffer based byte FIFO for one producer and one consumer, e.g.
+ *            an interrupt handler feeding the main loop. Neither side locks
+ *            out interrupts.
+ *
+ * @note      Buffer sizes are a power of two. The span functions hand out the
+ *            contiguous region at the head or tail so it can be filled or
+ *            drained with memcpy or DMA, then committed.
  *
  * @author    Marco Hess <marcoh@applidyne.com.au>
  *
@@ -30,10 +36,11 @@ extern "C" {
 
 typedef struct
 {
-     uint8_t * buf;
-     uint32_t  head;
-     uint32_t  tail;
-     uint32_t  capacity;
+     uint8_t *         buf;
+     uint32_t          mask;      // size - 1
+     volatile uint32_t head;      // free running, only written by the producer
+     volatile uint32_t tail;      // free running, only written by the consumer
+     uint32_t          max;       // most bytes held at once since init, kept by the producer
 } fifo_t;
 
 /* ----- Public Functions --------------------------------------------------- */
@@ -52,24 +59,24 @@ fifo_size( fifo_t * restrict f );
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data used in the fifo. */
+/** Returns the amount of data used in the fifo, a snapshot from the producer. */
 
 PUBLIC uint32_t
 fifo_used( fifo_t * restrict f );
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of data in the fifo _in_ a sequential block of memory. */
+/** Returns the amount of free space in the fifo, a snapshot from the consumer. */
 
 PUBLIC uint32_t
-fifo_used_linear( fifo_t * restrict f );
+fifo_free( fifo_t * restrict f );
 
 /* -------------------------------------------------------------------------- */
 
-/** Returns the amount of free space in the fifo. */
+/** Returns the most data held in the fifo at once since it was initialised */
 
 PUBLIC uint32_t
-fifo_free( fifo_t * restrict f );
+fifo_high_water( fifo_t * restrict f );
 
 /* -------------------------------------------------------------------------- */
 
@@ -80,17 +87,17 @@ fifo_put( fifo_t * restrict f, const uint8_t ch );
 
 /* -------------------------------------------------------------------------- */
 
-/** Get a byte from the FIFO. Return NULL when empty */
+/** Get a byte from the FIFO. Return false when empty */
 
-PUBLIC uint8_t *
-fifo_get( fifo_t * restrict f );
+PUBLIC bool
+fifo_get( fifo_t * restrict f, uint8_t * ch );
 
 /* -------------------------------------------------------------------------- */
 
-/** Peek a byte from the FIFO. Return NULL when empty */
+/** Peek a byte from the FIFO. Return false when empty */
 
-PUBLIC uint8_t *
-fifo_peek( fifo_t * restrict f );
+PUBLIC bool
+fifo_peek( fifo_t * restrict f, uint8_t * ch );
 
 /* -------------------------------------------------------------------------- */
 
@@ -111,21 +118,37 @@ fifo_read( fifo_t * restrict f, uint8_t * buf, uint32_t nbytes );
 
 /* -------------------------------------------------------------------------- */
 
-/** Get the pointer to the tail, if the proposed nbytes is legal
- *  Only use this function while promising that underlying data isn't mutated
+/** Producer side. Points span at the free space after the head, up to the end
+ *  of the buffer, and returns its length. Nothing is visible to the consumer
+ *  until fifo_write_commit().
  */
 
-PUBLIC uint32_t*
-fifo_get_tail_ptr( fifo_t * restrict f, uint32_t nbytes );
+PUBLIC uint32_t
+fifo_write_span( fifo_t * restrict f, uint8_t ** span );
+
+/* -------------------------------------------------------------------------- */
+
+/** Producer side. Publish nbytes written into the span */
+
+PUBLIC void
+fifo_write_commit( fifo_t * restrict f, uint32_t nbytes );
 
 /* -------------------------------------------------------------------------- */
 
-/** Moves the tail forwards by nbytes, functionally skipping data (partial flush)
- *  Returns number bytes flushed
+/** Consumer side. Points span at the data after the tail, up to the end of
+ *  the buffer, and returns its length. The data stays put until
+ *  fifo_read_commit(), call again after that for any that wrapped around.
  */
 
 PUBLIC uint32_t
-fifo_skip( fifo_t * restrict f, uint32_t nbytes );
+fifo_read_span( fifo_t * restrict f, const uint8_t ** span );
+
+/* -------------------------------------------------------------------------- */
+
+/** Consumer side. Hand nbytes of the span back to the producer */
+
+PUBLIC void
+fifo_read_commit( fifo_t * restrict f, uint32_t nbytes );
 
 /* ----- End ---------------------------------------------------------------- */
 
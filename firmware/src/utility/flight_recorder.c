@@ -0,0 +1,179 @@
+/**
+ * @file      flight_recorder.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Always-on ring of dispatched events and queue overruns.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "flight_recorder.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Marks the section as holding a ring left by a previous run
+#define FLIGHT_RECORDER_MAGIC 0x464C5431UL
+
+#define FLIGHT_RECORDER_MASK ( FLIGHT_RECORDER_DEPTH - 1U )
+
+typedef struct
+{
+    uint32_t       magic;
+    uint32_t       recorded;      // total records written, next slot is recorded & MASK
+    uint32_t       boots;
+    uint16_t       fault_line;
+    uint8_t        frozen;
+    FlightRecord_t records[FLIGHT_RECORDER_DEPTH];
+} FlightRecorder_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+// Not zeroed or initialised by the startup code
+PRIVATE FlightRecorder_t __attribute__( ( section( ".noinit" ) ) ) recorder;
+
+PRIVATE bool retained;
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE void
+flight_recorder_log( FlightRecordType_t type, uint8_t task, uint16_t signal, uint8_t depth, uint32_t started );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_init( void )
+{
+    retained = ( recorder.magic == FLIGHT_RECORDER_MAGIC );
+
+    if( !retained )
+    {
+        memset( &recorder, 0, sizeof( recorder ) );
+        recorder.magic = FLIGHT_RECORDER_MAGIC;
+    }
+
+    recorder.boots++;
+
+    // Mark where this run starts, unless that would push a fault out
+    flight_recorder_log( FLIGHT_RECORD_BOOT, 0, 0, 0, CYCLE_COUNT() );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_dispatch( uint8_t task, uint16_t signal, uint8_t depth, uint32_t started )
+{
+    flight_recorder_log( FLIGHT_RECORD_DISPATCH, task, signal, depth, started );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_overrun( uint8_t task, uint16_t signal, uint8_t depth )
+{
+    flight_recorder_log( FLIGHT_RECORD_OVERRUN, task, signal, depth, CYCLE_COUNT() );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_fault( uint16_t line )
+{
+    if( recorder.magic != FLIGHT_RECORDER_MAGIC )
+    {
+        return;    // faulted before the recorder was started
+    }
+
+    flight_recorder_log( FLIGHT_RECORD_FAULT, 0, line, 0, CYCLE_COUNT() );
+    recorder.fault_line = line;
+    recorder.frozen     = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_clear( void )
+{
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_START();
+    recorder.recorded   = 0;
+    recorder.boots      = 1;
+    recorder.fault_line = 0;
+    recorder.frozen     = false;
+    CRITICAL_SECTION_END();
+
+    retained = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_status( FlightRecorderStatus_t *status )
+{
+    status->recorded   = recorder.recorded;
+    status->boots      = recorder.boots;
+    status->fault_line = recorder.fault_line;
+    status->retained   = retained;
+    status->frozen     = recorder.frozen;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint8_t
+flight_recorder_read_page( uint8_t page, FlightRecord_t records[FLIGHT_RECORDER_PAGE] )
+{
+    uint8_t count = 0;
+
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_START();
+
+    uint32_t held   = MIN( recorder.recorded, FLIGHT_RECORDER_DEPTH );
+    uint32_t oldest = recorder.recorded - held;
+    uint32_t offset = (uint32_t)page * FLIGHT_RECORDER_PAGE;
+
+    while( count < FLIGHT_RECORDER_PAGE && offset + count < held )
+    {
+        records[count] = recorder.records[( oldest + offset + count ) & FLIGHT_RECORDER_MASK];
+        count++;
+    }
+
+    CRITICAL_SECTION_END();
+
+    return count;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+PRIVATE void
+flight_recorder_log( FlightRecordType_t type, uint8_t task, uint16_t signal, uint8_t depth, uint32_t started )
+{
+    uint32_t now = CYCLE_COUNT();
+
+    // Posts from interrupts can land between a dispatch and its record
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_START();
+
+    if( !recorder.frozen )
+    {
+        FlightRecord_t *record = &recorder.records[recorder.recorded & FLIGHT_RECORDER_MASK];
+
+        record->timestamp = started;
+        record->cycles    = now - started;
+        record->signal    = signal;
+        record->task      = task;
+        record->depth     = depth;
+        record->type      = type;
+        record->boot      = (uint8_t)recorder.boots;
+        record->sequence  = (uint16_t)recorder.recorded;
+
+        recorder.recorded++;
+    }
+
+    CRITICAL_SECTION_END();
+}
+
+/* ----- End ---------------------------------------------------------------- */
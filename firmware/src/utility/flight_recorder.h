@@ -0,0 +1,125 @@
+/**
+ * @file      flight_recorder.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Always-on ring of dispatched events and queue overruns, kept in
+ *            a RAM section the startup code leaves alone so the history from
+ *            before a soft reset or fault can be read out afterwards.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Power of two
+#define FLIGHT_RECORDER_DEPTH 256U
+
+// Records handed out per read, sized to fit a single UI message
+#define FLIGHT_RECORDER_PAGE  8U
+
+// Fault line recorded by the hard fault handler
+#define FLIGHT_RECORDER_HARD_FAULT 0xFFFFU
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef enum
+{
+    FLIGHT_RECORD_DISPATCH = 0,    // task handled an event
+    FLIGHT_RECORD_OVERRUN,         // event didn't fit in the task queue
+    FLIGHT_RECORD_BOOT,            // recorder started after a reset
+    FLIGHT_RECORD_FAULT,           // assert or hard fault, 'signal' holds the line
+} FlightRecordType_t;
+
+typedef struct
+{
+    uint32_t timestamp;    // DWT cycle count when the record was made
+    uint32_t cycles;       // cycles spent in the handler
+    uint16_t signal;
+    uint8_t  task;         // task id the event was for
+    uint8_t  depth;        // events in the task queue at the time
+    uint8_t  type;         // FlightRecordType_t
+    uint8_t  boot;         // low byte of the boot count
+    uint16_t sequence;     // low bits of the record number
+} FlightRecord_t;
+
+typedef struct
+{
+    uint32_t recorded;     // records written since the ring was last cleared
+    uint32_t boots;        // resets seen since the ring was last cleared
+    uint16_t fault_line;   // line of the last assert, 0 if none
+    uint8_t  retained;     // history from before this reset was kept
+    uint8_t  frozen;       // recording paused to preserve a fault
+} FlightRecorderStatus_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Start recording. Keeps the previous contents when they survived the reset,
+ *  and stays frozen if they end with a fault so it isn't overwritten.
+ */
+
+PUBLIC void
+flight_recorder_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Log a handled event. 'started' is the cycle count before dispatching. */
+
+PUBLIC void
+flight_recorder_dispatch( uint8_t task, uint16_t signal, uint8_t depth, uint32_t started );
+
+/* -------------------------------------------------------------------------- */
+
+/** Log an event that couldn't be queued for a task */
+
+PUBLIC void
+flight_recorder_overrun( uint8_t task, uint16_t signal, uint8_t depth );
+
+/* -------------------------------------------------------------------------- */
+
+/** Log a fault and stop recording, safe to call from the assert handler */
+
+PUBLIC void
+flight_recorder_fault( uint16_t line );
+
+/* -------------------------------------------------------------------------- */
+
+/** Drop the contents and resume recording */
+
+PUBLIC void
+flight_recorder_clear( void );
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+flight_recorder_status( FlightRecorderStatus_t *status );
+
+/* -------------------------------------------------------------------------- */
+
+/** Copy out a page of records, page 0 holds the oldest ones still in the ring.
+ *  Returns the number of records copied, 0 past the end.
+ */
+
+PUBLIC uint8_t
+flight_recorder_read_page( uint8_t page, FlightRecord_t records[FLIGHT_RECORDER_PAGE] );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* FLIGHT_RECORDER_H */
@@ -0,0 +1,86 @@
+/**
+ * @file      latency_histogram.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Log2 histogram of latencies in CPU cycles.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "latency_histogram.h"
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+latency_histogram_clear( LatencyHistogram_t *histogram )
+{
+    memset( histogram->bucket, 0, sizeof( histogram->bucket ) );
+    histogram->min   = UINT32_MAX;
+    histogram->max   = 0;
+    histogram->count = 0;
+    histogram->total = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+latency_histogram_add( LatencyHistogram_t *histogram, uint32_t cycles )
+{
+    // Position of the highest set bit, one CLZ instruction on the M4
+    uint32_t bits   = 32U - (uint32_t)__builtin_clz( cycles | 1U );
+    uint32_t bucket = 0;
+
+    if( bits > LATENCY_HISTOGRAM_FIRST_BITS )
+    {
+        bucket = MIN( bits - LATENCY_HISTOGRAM_FIRST_BITS, LATENCY_HISTOGRAM_BUCKETS - 1U );
+    }
+
+    histogram->bucket[bucket]++;
+
+    if( cycles < histogram->min )
+    {
+        histogram->min = cycles;
+    }
+
+    if( cycles > histogram->max )
+    {
+        histogram->max = cycles;
+    }
+
+    histogram->count++;
+    histogram->total += cycles;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+latency_histogram_report( LatencyHistogram_t *histogram, LatencyReport_t *report )
+{
+    // Updated from handlers above the kernel priority
+    CRITICAL_SECTION_VAR();
+    CRITICAL_SECTION_ALL_START();
+
+    memcpy( report->bucket, histogram->bucket, sizeof( report->bucket ) );
+
+    if( histogram->count )
+    {
+        report->min = histogram->min;
+        report->avg = (uint32_t)( histogram->total / histogram->count );
+    }
+    else
+    {
+        report->min = 0;
+        report->avg = 0;
+    }
+    report->max   = histogram->max;
+    report->count = histogram->count;
+
+    CRITICAL_SECTION_ALL_END();
+}
+
+/* ----- End ---------------------------------------------------------------- */
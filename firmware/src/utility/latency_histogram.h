@@ -0,0 +1,78 @@
+/**
+ * @file      latency_histogram.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Log2 histogram of latencies in CPU cycles, accumulated until it
+ *            is cleared so rare late events stay visible.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Bucket 0 holds latencies below 2^LATENCY_HISTOGRAM_FIRST_BITS cycles, each
+// following bucket doubles the range and the last one takes everything above
+#define LATENCY_HISTOGRAM_BUCKETS   16U
+#define LATENCY_HISTOGRAM_FIRST_BITS 4U
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t bucket[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t total;
+} LatencyHistogram_t;
+
+// Summary as sent to the UI, max - min is the jitter
+typedef struct
+{
+    uint32_t bucket[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t count;
+} LatencyReport_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void
+latency_histogram_clear( LatencyHistogram_t *histogram );
+
+/* -------------------------------------------------------------------------- */
+
+/** Count one latency, in CPU cycles */
+
+PUBLIC void
+latency_histogram_add( LatencyHistogram_t *histogram, uint32_t cycles );
+
+/* -------------------------------------------------------------------------- */
+
+/** Copy out the histogram, safe against updates from interrupt handlers */
+
+PUBLIC void
+latency_histogram_report( LatencyHistogram_t *histogram, LatencyReport_t *report );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* LATENCY_HISTOGRAM_H */
@@ -0,0 +1,153 @@
+/**
+ * @file      memory_watermark.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     High-water marks for the main stack, event pools, queues and
+ *            byte FIFOs.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "memory_watermark.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define MEMORY_WATERMARK_MAGIC 0x4D454D31UL
+
+// Pattern left in stack words that have never been written
+#define MEMORY_WATERMARK_PAINT 0xC5C5C5C5UL
+
+// Words left unpainted below the painting function's own frame
+#define MEMORY_WATERMARK_MARGIN 64U
+
+typedef struct
+{
+    uint32_t           magic;
+    MemoryWatermarks_t marks;
+} MemoryWatermarkRecord_t;
+
+/* ----- Private Variables -------------------------------------------------- */
+
+#ifdef STM32F429xx
+// Provided by the linker script
+extern uint32_t _estack;
+extern uint32_t _end;
+extern uint32_t _Min_Heap_Size;
+#endif
+
+// Not zeroed or initialised by the startup code
+PRIVATE MemoryWatermarkRecord_t __attribute__( ( section( ".noinit" ) ) ) record;
+
+PRIVATE MemoryWatermarks_t previous;
+PRIVATE bool               previous_valid;
+
+/* ----- Private Functions -------------------------------------------------- */
+
+#ifdef STM32F429xx
+PRIVATE uint32_t *
+memory_watermark_stack_bottom( void );
+#endif
+
+/* ----- Public Functions --------------------------------------------------- */
+
+PUBLIC void __attribute__( ( noinline ) )
+memory_watermark_paint_stack( void )
+{
+#ifdef STM32F429xx
+    uint32_t *word = memory_watermark_stack_bottom();
+    uint32_t *top  = (uint32_t *)__builtin_frame_address( 0 ) - MEMORY_WATERMARK_MARGIN;
+
+    while( word < top )
+    {
+        *word++ = MEMORY_WATERMARK_PAINT;
+    }
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+memory_watermark_stack_used( void )
+{
+#ifdef STM32F429xx
+    uint32_t *word = memory_watermark_stack_bottom();
+
+    while( word < &_estack && *word == MEMORY_WATERMARK_PAINT )
+    {
+        word++;
+    }
+
+    return (uint32_t)( (uintptr_t)&_estack - (uintptr_t)word );
+#else
+    return 0;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC uint32_t
+memory_watermark_stack_size( void )
+{
+#ifdef STM32F429xx
+    return (uint32_t)( (uintptr_t)&_estack - ( (uintptr_t)&_end + (uintptr_t)&_Min_Heap_Size ) );
+#else
+    return 0;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+memory_watermark_init( void )
+{
+    previous_valid = ( record.magic == MEMORY_WATERMARK_MAGIC );
+
+    if( previous_valid )
+    {
+        previous = record.marks;
+    }
+
+    memset( &record, 0, sizeof( record ) );
+    record.magic = MEMORY_WATERMARK_MAGIC;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void
+memory_watermark_save( const MemoryWatermarks_t *marks )
+{
+    record.marks = *marks;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+memory_watermark_previous( MemoryWatermarks_t *marks )
+{
+    if( previous_valid )
+    {
+        *marks = previous;
+    }
+
+    return previous_valid;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+#ifdef STM32F429xx
+PRIVATE uint32_t *
+memory_watermark_stack_bottom( void )
+{
+    uintptr_t bottom = (uintptr_t)&_end + (uintptr_t)&_Min_Heap_Size;
+    uintptr_t window = (uintptr_t)&_estack - MEMORY_WATERMARK_STACK_WINDOW;
+
+    return (uint32_t *)( ( MAX( bottom, window ) + 3U ) & ~(uintptr_t)3U );
+}
+#endif
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,106 @@
+/**
+ * @file      memory_watermark.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     High-water marks for the main stack, event pools, queues and
+ *            byte FIFOs. The stack is painted at boot and scanned for the
+ *            deepest write, and the latest summary is kept in RAM the startup
+ *            code leaves alone so the previous run can be read after a reset.
+ */
+
+#ifndef MEMORY_WATERMARK_H
+#define MEMORY_WATERMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+#define MEMORY_WATERMARK_POOLS  3U
+#define MEMORY_WATERMARK_QUEUES 8U
+#define MEMORY_WATERMARK_FIFOS  6U
+
+// Bytes below the top of RAM that are painted and scanned, bounds the scan time
+#define MEMORY_WATERMARK_STACK_WINDOW 16384U
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t stack_used;                                // deepest stack use seen, bytes
+    uint32_t stack_size;                                // bytes available to the stack
+    uint16_t pool_peak[MEMORY_WATERMARK_POOLS];         // most events allocated at once
+    uint16_t pool_size[MEMORY_WATERMARK_POOLS];
+    uint16_t fifo_peak[MEMORY_WATERMARK_FIFOS];         // most bytes buffered at once
+    uint16_t fifo_size[MEMORY_WATERMARK_FIFOS];
+    uint8_t  queue_peak[MEMORY_WATERMARK_QUEUES];       // most events queued at once
+    uint8_t  queue_size[MEMORY_WATERMARK_QUEUES];
+} MemoryWatermarks_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Fill the unused stack with a known pattern. Call first thing in main,
+ *  before the call depth grows.
+ */
+
+PUBLIC void
+memory_watermark_paint_stack( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Bytes of stack used so far, found by scanning for the lowest overwritten
+ *  word. Saturates at MEMORY_WATERMARK_STACK_WINDOW.
+ */
+
+PUBLIC uint32_t
+memory_watermark_stack_used( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Bytes between the end of the reserved heap and the top of RAM */
+
+PUBLIC uint32_t
+memory_watermark_stack_size( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Pick up the summary left by the previous run, if it survived the reset,
+ *  and start a fresh one for this run.
+ */
+
+PUBLIC void
+memory_watermark_init( void );
+
+/* -------------------------------------------------------------------------- */
+
+/** Store the current marks so they survive a soft reset */
+
+PUBLIC void
+memory_watermark_save( const MemoryWatermarks_t *marks );
+
+/* -------------------------------------------------------------------------- */
+
+/** Copy out the summary from the previous run. Returns false when there
+ *  wasn't one, e.g. after a power cycle.
+ */
+
+PUBLIC bool
+memory_watermark_previous( MemoryWatermarks_t *marks );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* MEMORY_WATERMARK_H */
@@ -14,6 +14,7 @@
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "state_task.h"
+#include "flight_recorder.h"
 #include "qassert.h"
 #include "state_event.h"
 
@@ -46,11 +47,25 @@ stateTaskCreate( StateTask    * restrict me,
     eventQueueInit( &me->eventQueue,   eventQueueData,   eventQueueSize );
     eventQueueInit( &me->requestQueue, requestQueueData, requestQueueSize );
 
+    // No inbox until one is added
+    me->inbox.entries = NULL;
+
     return me;
 }
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC void
+stateTaskAddInbox( StateTask  *me,
+                   StateEvent *inboxData[],
+                   uint16_t   inboxStamps[],
+                   uint16_t   inboxSize )
+{
+    eventSpscInit( &me->inbox, inboxData, inboxStamps, inboxSize );
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC bool
 stateTaskPostFIFO( StateTask *t, const StateEvent *e )
 {
@@ -63,6 +78,8 @@ stateTaskPostFIFO( StateTask *t, const StateEvent *e )
                 t->ready = true;
                 return true;
             }
+
+            flight_recorder_overrun( t->id, e->signal, eventQueueUsed( &t->eventQueue ) );
         }
     }
     return false;    // Failed to queue the event (also for a NULL event).
@@ -82,6 +99,37 @@ stateTaskPostLIFO( StateTask *t, const StateEvent *e )
                 t->ready = true;
                 return true;
             }
+
+            flight_recorder_overrun( t->id, e->signal, eventQueueUsed( &t->eventQueue ) );
+        }
+    }
+    return false;    // Failed to queue the event (also for a NULL event).
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC bool
+stateTaskPostInbox( StateTask *t, const StateEvent *e )
+{
+    if( t && t->inbox.entries == NULL )
+    {
+        return stateTaskPostFIFO( t, e );
+    }
+
+    if( e )
+    {
+        if( t )
+        {
+            // Stamped with what the event queue has taken in so far
+            if( eventSpscPut( &t->inbox, (StateEvent*)e, eventQueueStamp( &t->eventQueue ) ) )
+            {
+                // Only after the event is visible, see stateTaskerRunEvent
+                MEMORY_BARRIER();
+                t->ready = true;
+                return true;
+            }
+
+            flight_recorder_overrun( t->id, e->signal, (uint8_t)MIN( eventSpscUsed( &t->inbox ), UINT8_MAX ) );
         }
     }
     return false;    // Failed to queue the event (also for a NULL event).
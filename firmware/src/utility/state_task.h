@@ -23,9 +23,11 @@ extern "C" {
 /* ----- Local Includes ----------------------------------------------------- */
 
 #include "global.h"
+#include "cycle_stats.h"
 #include "state_hsm.h"
 #include "state_event.h"
 #include "event_queue.h"
+#include "event_spsc.h"
 #include "event_pool.h"
 
 /* ----- Defines ------------------------------------------------------------ */
@@ -44,9 +46,11 @@ typedef struct
     uint32_t      waiting;
     uint32_t      burst_max;
     uint32_t      waiting_max;
+    CycleStats_t  cycles;               /** time spent handling events */
     void *        tasker;
     EventQueue    eventQueue;
     EventQueue    requestQueue;
+    EventSpsc     inbox;                /** lock-free queue fed by the event timers */
 } StateTask;
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
@@ -63,6 +67,13 @@ stateTaskPostFIFO( StateTask *t, const StateEvent *e );
 PUBLIC bool
 stateTaskPostLIFO( StateTask *t, const StateEvent *e );
 
+//! Queue an event through the task's lock-free inbox. The inbox has a single
+/// producer, the event timer tick interrupt. Each event is stamped against
+/// the regular event queue so the two are handled in the order they were
+/// posted. Falls back to stateTaskPostFIFO for tasks without an inbox.
+PUBLIC bool
+stateTaskPostInbox( StateTask *t, const StateEvent *e );
+
 //! Flush/discard all request on the request queue
 PUBLIC void
 stateTaskFlushRequests( StateTask *t );
@@ -89,6 +100,14 @@ stateTaskCreate( StateTask    * restrict me,
                  StateEvent   * restrict requestQueueData[],
                  uint8_t      requestQueueSize );
 
+//! Give the task a lock-free inbox, size is a power of two with a stamp
+/// for each entry
+PUBLIC void
+stateTaskAddInbox( StateTask  *me,
+                   StateEvent *inboxData[],
+                   uint16_t   inboxStamps[],
+                   uint16_t   inboxSize );
+
 /* ----- End ---------------------------------------------------------------- */
 
 #ifdef __cplusplus
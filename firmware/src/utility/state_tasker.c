@@ -17,6 +17,7 @@
 #include "state_tasker.h"
 #include "qassert.h"
 #include "event_queue.h"
+#include "flight_recorder.h"
 #include "state_event.h"
 
 /* -------------------------------------------------------------------------- */
@@ -32,6 +33,9 @@ stateTaskerBumpWaiting( StateTasker_t * me );
 PRIVATE StateTask  *
 stateTaskerNext( StateTasker_t * me );
 
+PRIVATE StateEvent *
+stateTaskerGetInbox( StateTask * task, uint8_t * depth );
+
 /* ----- Public Functions --------------------------------------------------- */
 
 /** Init the initial tasker data structures
@@ -68,6 +72,7 @@ stateTaskerAddTask( StateTasker_t *me,
     task->waiting     = 0;
     task->burst_max   = 0;
     task->waiting_max = 0;
+    cycle_stats_clear( &task->cycles );
 
     task->tasker      = me;     /* Keep reference to tasker */
 
@@ -104,11 +109,19 @@ stateTaskerRunEvent( StateTasker_t * me )
     if( me->current )
     {
         StateEvent *e;
+        uint8_t    depth;
+        uint32_t   started;
+
+        // Timer events come through the inbox without locking, in order
+        // with the events queued before them
+        e = stateTaskerGetInbox( me->current, &depth );
 
+        if( e == NULL )
         {
             CRITICAL_SECTION_VAR();
             CRITICAL_SECTION_START();
-            e = eventQueueGet( &me->current->eventQueue );
+            depth = eventQueueUsed( &me->current->eventQueue );
+            e     = eventQueueGet( &me->current->eventQueue );
             CRITICAL_SECTION_END();
         }
         me->current->waiting = 0;
@@ -120,13 +133,18 @@ stateTaskerRunEvent( StateTasker_t * me )
                 me->current->burst_max = me->current->burst;
             }
         }
+        started = CYCLE_COUNT();
         hsmDispatch( (Hsm*)me->current, e );
+        cycle_stats_add( &me->current->cycles, started );
+        flight_recorder_dispatch( me->current->id, e->signal, depth, started );
         eventPoolGarbageCollect( e );
 
         {
             CRITICAL_SECTION_VAR();
             CRITICAL_SECTION_START();
-            if( eventQueueUsed( &me->current->eventQueue ) == 0 )
+            if( eventQueueUsed( &me->current->eventQueue ) == 0
+                && ( me->current->inbox.entries == NULL
+                     || eventSpscUsed( &me->current->inbox ) == 0 ) )
             {
                 me->current->burst = 0;
                 me->current->ready = false;
@@ -218,4 +236,26 @@ stateTaskerNext( StateTasker_t * me )
     return NULL;
 }
 
+/* -------------------------------------------------------------------------- */
+
+/** Take the next event from the task's inbox, NULL when it has none or
+ *  the regular queue still holds events posted before it.
+ */
+
+PRIVATE StateEvent *
+stateTaskerGetInbox( StateTask * task, uint8_t * depth )
+{
+    uint16_t stamp;
+
+    if( task->inbox.entries == NULL
+        || !eventSpscPeekStamp( &task->inbox, &stamp )
+        || !eventQueueReached( &task->eventQueue, stamp ) )
+    {
+        return NULL;
+    }
+
+    *depth = (uint8_t)MIN( eventSpscUsed( &task->inbox ), UINT8_MAX );
+    return eventSpscGet( &task->inbox );
+}
+
 /* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,131 @@
+/**
+ * @file      sync_index.c
+ *
+ * @ingroup   utility
+ *
+ * @brief     Maps identifiers of events held in a FIFO request queue to their
+ *            position in the queue, so a sync request can find any queued ID
+ *            without walking the queue.
+ *
+ * @note      Queue positions are derived from a running count of added events
+ *            and the queue's current depth, so events removed from the head
+ *            (or a cleared queue) need no bookkeeping here.
+ *
+ *            ID's that share an entry while both are queued fall back to a
+ *            scan of the mirrored ID's, the index can't say which came first.
+ */
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <string.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "sync_index.h"
+
+/* ----- Private Prototypes ------------------------------------------------- */
+
+PRIVATE bool
+sync_index_is_queued( sync_index_t * restrict index, sync_index_entry_t *entry, uint8_t queued );
+
+PRIVATE bool
+sync_index_scan( sync_index_t * restrict index, uint16_t id, uint8_t queued, uint8_t *position );
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Clear the index, call before the queue sees any events */
+
+PUBLIC void
+sync_index_init( sync_index_t * restrict index )
+{
+    memset( index, 0, sizeof( sync_index_t ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+/** Record an event with this id was just put on the tail of the queue */
+
+PUBLIC void
+sync_index_add( sync_index_t * restrict index, uint16_t id, uint8_t queued )
+{
+    sync_index_entry_t *entry = &index->entries[id & ( SYNC_INDEX_SIZE - 1 )];
+
+    index->ids[index->added & ( SYNC_INDEX_SIZE - 1 )] = id;
+
+    if( !sync_index_is_queued( index, entry, queued ) )
+    {
+        entry->id       = id;
+        entry->sequence = index->added;
+    }
+    else if( entry->id != id )
+    {
+        // Another queued id holds the entry, keep it and leave this one to the scan
+        index->collided   = index->added;
+        index->collisions = true;
+    }
+
+    // Otherwise the earliest event for the id is kept, so a sync starts at the first of them
+    index->added++;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/** Find how many events are ahead of the first queued event with this id */
+
+PUBLIC bool
+sync_index_find( sync_index_t * restrict index, uint16_t id, uint8_t queued, uint8_t *position )
+{
+    sync_index_entry_t *entry = &index->entries[id & ( SYNC_INDEX_SIZE - 1 )];
+
+    // While an unindexed event is queued, the entry might not be the earliest for its id
+    if( index->collisions && ( index->added - index->collided ) <= queued )
+    {
+        return sync_index_scan( index, id, queued, position );
+    }
+
+    if( entry->id != id || !sync_index_is_queued( index, entry, queued ) )
+    {
+        return false;
+    }
+
+    // The oldest event still queued was added 'queued' events ago
+    uint32_t oldest = index->added - queued;
+    *position       = (uint8_t)( entry->sequence - oldest );
+
+    return true;
+}
+
+/* ----- Private Functions -------------------------------------------------- */
+
+/** An entry is still in the queue when it was added no more than 'queued' events ago */
+
+PRIVATE bool
+sync_index_is_queued( sync_index_t * restrict index, sync_index_entry_t *entry, uint8_t queued )
+{
+    uint32_t age = index->added - entry->sequence;
+
+    return ( age > 0 ) && ( age <= queued );
+}
+
+/* -------------------------------------------------------------------------- */
+
+/** Walk the mirrored ids from the head of the queue */
+
+PRIVATE bool
+sync_index_scan( sync_index_t * restrict index, uint16_t id, uint8_t queued, uint8_t *position )
+{
+    uint32_t oldest = index->added - queued;
+
+    for( uint8_t ahead = 0; ahead < queued; ahead++ )
+    {
+        if( index->ids[( oldest + ahead ) & ( SYNC_INDEX_SIZE - 1 )] == id )
+        {
+            *position = ahead;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* ----- End ---------------------------------------------------------------- */
@@ -0,0 +1,85 @@
+/**
+ * @file      sync_index.h
+ *
+ * @ingroup   utility
+ *
+ * @brief     Maps identifiers of events held in a FIFO request queue to their
+ *            position in the queue, so a sync request can find any queued ID
+ *            without walking the queue.
+ */
+
+#ifndef SYNC_INDEX_H
+#define SYNC_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----- System Includes ---------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----- Local Includes ----------------------------------------------------- */
+
+#include "global.h"
+
+/* ----- Defines ------------------------------------------------------------ */
+
+// Power of two, and larger than the deepest queue being indexed
+#define SYNC_INDEX_SIZE 256
+
+#define SYNC_INDEX_FITS( depth_ ) ( ( depth_ ) < SYNC_INDEX_SIZE )
+
+/* ----- Types -------------------------------------------------------------- */
+
+typedef struct
+{
+    uint16_t id;          // identifier of the event
+    uint32_t sequence;    // value of 'added' when the event was queued
+} sync_index_entry_t;
+
+typedef struct
+{
+    sync_index_entry_t entries[SYNC_INDEX_SIZE];    // by id
+    uint16_t           ids[SYNC_INDEX_SIZE];        // by sequence, mirrors the queue for when an id couldn't be indexed
+    uint32_t           added;                       // count of events put into the queue
+    uint32_t           collided;                    // value of 'added' when the latest unindexed event was queued
+    bool               collisions;                  // an event has ever been left out of entries[]
+} sync_index_t;
+
+/* ----- Public Functions --------------------------------------------------- */
+
+/** Clear the index, call before the queue sees any events */
+
+PUBLIC void
+sync_index_init( sync_index_t * restrict index );
+
+/* -------------------------------------------------------------------------- */
+
+/** Record an event with this id was just put on the tail of the queue.
+ *  'queued' is the number of events in the queue before this one was added.
+ *  When several queued events share an id, the earliest one is kept. An id
+ *  landing on an entry held by a different queued id is left out, and
+ *  lookups scan instead until it has left the queue.
+ */
+
+PUBLIC void
+sync_index_add( sync_index_t * restrict index, uint16_t id, uint8_t queued );
+
+/* -------------------------------------------------------------------------- */
+
+/** Find how many events are ahead of the first queued event with this id.
+ *  'queued' is the number of events currently in the queue.
+ *  Returns false when the id isn't in the queue.
+ */
+
+PUBLIC bool
+sync_index_find( sync_index_t * restrict index, uint16_t id, uint8_t queued, uint8_t *position );
+
+/* ----- End ---------------------------------------------------------------- */
+
+#ifdef    __cplusplus
+}
+#endif
+#endif /* SYNC_INDEX_H */
@@ -105,6 +105,36 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Copy the functions that run from SRAM */
+  movs  r1, #0
+  b  LoopCopyRamfunc
+
+CopyRamfunc:
+  ldr  r3, =_siramfunc
+  ldr  r3, [r3, r1]
+  str  r3, [r0, r1]
+  adds  r1, r1, #4
+
+LoopCopyRamfunc:
+  ldr  r0, =_sramfunc
+  ldr  r3, =_eramfunc
+  adds  r2, r0, r1
+  cmp  r2, r3
+  bcc  CopyRamfunc
+
+/* Zero fill the CCM RAM section. */
+  ldr  r2, =_sccmram
+  b  LoopFillZeroccm
+
+FillZeroccm:
+  movs  r3, #0
+  str  r3, [r2], #4
+
+LoopFillZeroccm:
+  ldr  r3, = _eccmram
+  cmp  r2, r3
+  bcc  FillZeroccm
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
 /* Call static constructors */
@@ -361,6 +361,34 @@ export type MovementMove = {
   num_points?: number
 }
 
+function encodeMovementMove(move: MovementMove) {
+  const packet = new SmartBuffer()
+
+  move.num_points = move.points.length
+
+  packet.writeUInt8(move.type)
+  packet.writeUInt8(move.reference)
+  packet.writeUInt16LE(move.id)
+  packet.writeUInt16LE(move.duration)
+  packet.writeUInt16LE(move.num_points)
+
+  for (let index = 0; index < 4; index++) {
+    const pointData = move.points[index]
+
+    if (typeof pointData !== 'undefined') {
+      packet.writeInt32LE(pointData[0] * 1000)
+      packet.writeInt32LE(pointData[1] * 1000)
+      packet.writeInt32LE(pointData[2] * 1000)
+    } else {
+      packet.writeInt32LE(0)
+      packet.writeInt32LE(0)
+      packet.writeInt32LE(0)
+    }
+  }
+
+  return packet.toBuffer()
+}
+
 /**
  * There's the possibility that the message payload is not being created each time
  */
@@ -373,31 +401,8 @@ export class InboundMotionCodec extends Codec {
     if (message.payload === null) {
       return push(message)
     }
-    const packet = new SmartBuffer()
-
-    message.payload.num_points = message.payload.points.length
-
-    packet.writeUInt8(message.payload.type)
-    packet.writeUInt8(message.payload.reference)
-    packet.writeUInt16LE(message.payload.id)
-    packet.writeUInt16LE(message.payload.duration)
-    packet.writeUInt16LE(message.payload.num_points)
-
-    for (let index = 0; index < 4; index++) {
-      const pointData = message.payload.points[index]
-
-      if (typeof pointData !== 'undefined') {
-        packet.writeInt32LE(pointData[0] * 1000)
-        packet.writeInt32LE(pointData[1] * 1000)
-        packet.writeInt32LE(pointData[2] * 1000)
-      } else {
-        packet.writeInt32LE(0)
-        packet.writeInt32LE(0)
-        packet.writeInt32LE(0)
-      }
-    }
 
-    message.payload = packet.toBuffer()
+    message.payload = encodeMovementMove(message.payload)
     return push(message)
   }
 }
@@ -421,6 +426,35 @@ export type LightMove = {
   num_points?: number
 }
 
+function encodeLightMove(move: LightMove) {
+  const packet = new SmartBuffer()
+
+  move.num_points = move.points.length
+
+  packet.writeUInt16LE(move.id)
+  packet.writeUInt16LE(move.duration)
+  packet.writeUInt8(move.type)
+  packet.writeUInt8(move.num_points)
+  packet.writeUInt8(0x00)
+  packet.writeUInt8(0x00)
+
+  for (let index = 0; index < 2; index++) {
+    const pointData = move.points[index]
+
+    if (typeof pointData !== 'undefined') {
+      packet.writeFloatLE(pointData[0])
+      packet.writeFloatLE(pointData[1])
+      packet.writeFloatLE(pointData[2])
+    } else {
+      packet.writeFloatLE(0)
+      packet.writeFloatLE(0)
+      packet.writeFloatLE(0)
+    }
+  }
+
+  return packet.toBuffer()
+}
+
 export class InboundFadeCodec extends Codec {
   filter(message: Message): boolean {
     return message.messageID === 'inlt'
@@ -430,33 +464,172 @@ export class InboundFadeCodec extends Codec {
     if (message.payload === null) {
       return push(message)
     }
+
+    message.payload = encodeLightMove(message.payload)
+    return push(message)
+  }
+}
+
+export type ReplayRequest = {
+  firstId: number
+  lastId: number
+  scale: number // 0 keeps the current playback rate
+  repeats: number
+}
+
+export class ReplayRequestCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'replay'
+  }
+
+  encode(message: Message<ReplayRequest>, push: PushCallback) {
+    if (message.payload === null) {
+      return push(message)
+    }
+
+    const request = message.payload
     const packet = new SmartBuffer()
 
-    message.payload.num_points = message.payload.points.length
-
-    packet.writeUInt16LE(message.payload.id)
-    packet.writeUInt16LE(message.payload.duration)
-    packet.writeUInt8(message.payload.type)
-    packet.writeUInt8(message.payload.num_points)
-    packet.writeUInt8(0x00)
-    packet.writeUInt8(0x00)
-
-    for (let index = 0; index < 2; index++) {
-      const pointData = message.payload.points[index]
-
-      if (typeof pointData !== 'undefined') {
-        packet.writeFloatLE(pointData[0])
-        packet.writeFloatLE(pointData[1])
-        packet.writeFloatLE(pointData[2])
-      } else {
-        packet.writeFloatLE(0)
-        packet.writeFloatLE(0)
-        packet.writeFloatLE(0)
-      }
+    packet.writeUInt16LE(request.firstId)
+    packet.writeUInt16LE(request.lastId)
+    packet.writeFloatLE(request.scale)
+    packet.writeUInt8(request.repeats)
+    packet.writeBuffer(Buffer.alloc(3)) // struct padding
+
+    return push(message.setPayload(packet.toBuffer()))
+  }
+}
+
+export enum ReliableChannel {
+  MOVEMENT = 0,
+  LIGHTING,
+}
+
+// Matches RELIABLE_WINDOW in the firmware
+export const RELIABLE_WINDOW = 16
+
+const RELIABLE_FLAG_START = 0x01
+
+export type ReliableSegment = {
+  sequence: number
+  channel: ReliableChannel
+  start: boolean
+  move: MovementMove | LightMove
+}
+
+export type ReliableAck = {
+  next: number
+  selective: number
+  channel: ReliableChannel
+  window: number
+}
+
+export class ReliableSegmentCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'rseg'
+  }
+
+  encode(message: Message<ReliableSegment>, push: PushCallback) {
+    if (message.payload === null) {
+      return push(message)
     }
 
-    message.payload = packet.toBuffer()
-    return push(message)
+    const segment = message.payload
+    const packet = new SmartBuffer()
+
+    packet.writeUInt16LE(segment.sequence)
+    packet.writeUInt8(segment.channel)
+    packet.writeUInt8(segment.start ? RELIABLE_FLAG_START : 0)
+
+    packet.writeBuffer(
+      segment.channel === ReliableChannel.MOVEMENT
+        ? encodeMovementMove(segment.move as MovementMove)
+        : encodeLightMove(segment.move as LightMove),
+    )
+
+    return push(message.setPayload(packet.toBuffer()))
+  }
+}
+
+export class ReliableAckCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'rack'
+  }
+
+  decode(message: Message<Buffer>, push: PushCallback) {
+    if (message.payload === null) {
+      return push(message)
+    }
+
+    const reader = SmartBuffer.fromBuffer(message.payload)
+
+    const ack: ReliableAck = {
+      next: reader.readUInt16LE(),
+      selective: reader.readUInt16LE(),
+      channel: reader.readUInt8(),
+      window: reader.readUInt8(),
+    }
+
+    return push(message.setPayload(ack))
+  }
+}
+
+// Matches GCODE_CHUNK_MAX in the firmware
+export const GCODE_CHUNK_MAX = 64
+
+export type GcodeStats = {
+  received: number // bytes taken since the last reset, credit is counted from here
+  moves: number
+  lines: number
+  errorLine: number
+  free: number
+  errors: number
+  dropped: number
+  busy: boolean
+}
+
+/**
+ * Up to GCODE_CHUNK_MAX characters of program text, an empty chunk asks for
+ * the free space
+ */
+export class GcodeChunkCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'gcode'
+  }
+
+  encode(message: Message<string>, push: PushCallback) {
+    if (message.payload === null) {
+      return push(message)
+    }
+
+    return push(message.setPayload(Buffer.from(message.payload, 'ascii')))
+  }
+}
+
+export class GcodeStatsCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'gc_stat'
+  }
+
+  decode(message: Message<Buffer>, push: PushCallback) {
+    if (message.payload === null) {
+      return push(message)
+    }
+
+    const reader = SmartBuffer.fromBuffer(message.payload)
+
+    const stats: GcodeStats = {
+      received: reader.readUInt32LE(),
+      moves: reader.readUInt32LE(),
+      lines: reader.readUInt32LE(),
+      errorLine: reader.readUInt32LE(),
+      free: reader.readUInt16LE(),
+      errors: reader.readUInt16LE(),
+      dropped: reader.readUInt16LE(),
+      busy: reader.readUInt8() !== 0,
+    }
+
+    return push(message.setPayload(stats))
   }
 }
 
@@ -661,6 +834,120 @@ export class PowerCalibrationCodec extends Codec {
   }
 }
 
+export const TELEMETRY_VERSION = 1
+
+export type Telemetry = {
+  version: number
+  sequence: number
+  timestamp: number
+  flags: {
+    supervisor_error: boolean
+    servo_error: boolean
+    fault_recorded: boolean
+    comms_dropped: boolean
+  }
+  cpu_load: number
+  queue: {
+    movements: number
+    lighting: number
+  }
+  position: {
+    x: number
+    y: number
+    z: number
+  }
+  servos: {
+    angle: number
+    feedback: number
+    power: number
+  }[]
+  input_voltage: number
+  temperature: {
+    ambient: number
+    regulator: number
+    external: number
+    cpu: number
+  }
+}
+
+export class TelemetryCodec extends Codec {
+  filter(message: Message): boolean {
+    return message.messageID === 'telem'
+  }
+
+  decode(
+    message: Message<Buffer>,
+    push: PushCallback<Message<Telemetry | null>>,
+  ) {
+    if (message.payload === null) {
+      return push((message as unknown) as Message<null>)
+    }
+
+    const reader = SmartBuffer.fromBuffer(message.payload)
+
+    const version = reader.readUInt8()
+
+    // A layout we don't know how to read, drop it rather than show garbage
+    if (version !== TELEMETRY_VERSION) {
+      return push((message.setPayload(null) as unknown) as Message<null>)
+    }
+
+    const servoCount = reader.readUInt8()
+    const sequence = reader.readUInt16LE()
+    const timestamp = reader.readUInt32LE()
+    const flags = reader.readUInt8()
+    const cpu_load = reader.readUInt8()
+    const movements = reader.readUInt8()
+    const lighting = reader.readUInt8()
+
+    const position = {
+      x: reader.readInt32LE() / 1000,
+      y: reader.readInt32LE() / 1000,
+      z: reader.readInt32LE() / 1000,
+    }
+
+    // Four slots are always sent, servoCount of them are fitted
+    const angles = [0, 1, 2, 3].map(() => reader.readFloatLE())
+    const feedback = [0, 1, 2, 3].map(() => reader.readInt16LE() / 10)
+    const power = [0, 1, 2, 3].map(() => reader.readInt16LE() / 10)
+
+    const input_voltage = reader.readUInt16LE() / 1000
+    const temperatures = [0, 1, 2, 3].map(() => reader.readInt16LE() / 10)
+
+    const telemetry: Telemetry = {
+      version,
+      sequence,
+      timestamp,
+      flags: {
+        supervisor_error: (flags & 0x01) !== 0,
+        servo_error: (flags & 0x02) !== 0,
+        fault_recorded: (flags & 0x04) !== 0,
+        comms_dropped: (flags & 0x08) !== 0,
+      },
+      cpu_load,
+      queue: {
+        movements,
+        lighting,
+      },
+      position,
+      servos: angles.slice(0, servoCount).map((angle, index) => ({
+        angle,
+        feedback: feedback[index],
+        power: power[index],
+      })),
+      input_voltage,
+      temperature: {
+        ambient: temperatures[0],
+        regulator: temperatures[1],
+        external: temperatures[2],
+        cpu: temperatures[3],
+      },
+    }
+
+    return push(message.setPayload(telemetry))
+  }
+}
+
 export const customCodecs = [
   new SystemDataCodec(),
   new TaskStatisticsCodec(),
@@ -679,4 +966,10 @@ export const customCodecs = [
   new RGBSettingsCodec(),
   new KinematicsInfoCodec(),
   new PowerCalibrationCodec(),
+  new TelemetryCodec(),
+  new ReplayRequestCodec(),
+  new ReliableSegmentCodec(),
+  new ReliableAckCodec(),
+  new GcodeChunkCodec(),
+  new GcodeStatsCodec(),
 ]
@@ -0,0 +1,164 @@
+import { DeviceManager } from '@electricui/core'
+
+import {
+  LightMove,
+  MovementMove,
+  RELIABLE_WINDOW,
+  ReliableAck,
+  ReliableChannel,
+  ReliableSegment,
+} from './codecs'
+
+export type ReliableSegmentWriter = (
+  deviceManager: DeviceManager,
+  segment: ReliableSegment,
+) => Promise<any>
+
+type InFlight = {
+  segment: ReliableSegment
+  sentAt: number
+}
+
+// Resend anything not acknowledged in this long
+const RETRANSMIT_TIMEOUT_MS = 250
+
+// A segment skipped over by a selective ack is resent at most this often
+const SELECTIVE_HOLDOFF_MS = 20
+
+const RETRANSMIT_POLL_MS = 50
+
+/**
+ * Signed distance from b to a in the 16 bit sequence space
+ */
+function sequenceDiff(a: number, b: number) {
+  return ((a - b + 0x8000) & 0xffff) - 0x8000
+}
+
+/**
+ * Sending half of the firmware's reliable upload transport for one channel.
+ * Keeps up to the advertised window of segments in flight, forgets them as
+ * cumulative and selective acks arrive, and resends ones that were skipped
+ * over or timed out.
+ */
+export class ReliableSender {
+  channel: ReliableChannel
+  segmentWriter: ReliableSegmentWriter
+
+  nextSequence: number = 0
+  base: number = 0 // oldest sequence not yet acknowledged
+  window: number = RELIABLE_WINDOW
+  start: boolean = true
+  inFlight: Map<number, InFlight> = new Map()
+
+  deviceManager: DeviceManager | null = null
+  timer: ReturnType<typeof setInterval> | null = null
+
+  constructor(channel: ReliableChannel, segmentWriter: ReliableSegmentWriter) {
+    this.channel = channel
+    this.segmentWriter = segmentWriter
+  }
+
+  public attach = (deviceManager: DeviceManager) => {
+    this.deviceManager = deviceManager
+    this.timer = setInterval(this.retransmitExpired, RETRANSMIT_POLL_MS)
+  }
+
+  public detach = () => {
+    if (this.timer) {
+      clearInterval(this.timer)
+      this.timer = null
+    }
+    this.deviceManager = null
+  }
+
+  /**
+   * True when the window has room for another segment
+   */
+  public canSend = () => {
+    return sequenceDiff(this.nextSequence, this.base) < this.window
+  }
+
+  public send = (move: MovementMove | LightMove) => {
+    const segment: ReliableSegment = {
+      sequence: this.nextSequence,
+      channel: this.channel,
+      start: this.start,
+      move,
+    }
+
+    this.start = false
+    this.nextSequence = (this.nextSequence + 1) & 0xffff
+
+    this.write(segment)
+  }
+
+  /**
+   * Returns true when the ack opened up the window
+   */
+  public onAck = (ack: ReliableAck) => {
+    if (ack.channel !== this.channel || sequenceDiff(ack.next, this.base) < 0) {
+      return false
+    }
+
+    this.base = ack.next
+    this.window = ack.window
+
+    let highestSelective = -1
+
+    for (const sequence of Array.from(this.inFlight.keys())) {
+      const offset = sequenceDiff(sequence, ack.next)
+
+      if (offset < 0) {
+        this.inFlight.delete(sequence)
+      } else if (offset > 0 && ack.selective & (1 << (offset - 1))) {
+        this.inFlight.delete(sequence)
+        highestSelective = Math.max(highestSelective, offset)
+      }
+    }
+
+    // Anything still missing below a segment that made it was lost on the way
+    const now = Date.now()
+
+    this.inFlight.forEach((entry, sequence) => {
+      if (
+        sequenceDiff(sequence, ack.next) < highestSelective &&
+        now - entry.sentAt > SELECTIVE_HOLDOFF_MS
+      ) {
+        this.write(entry.segment)
+      }
+    })
+
+    return this.canSend()
+  }
+
+  /**
+   * Forget what's in flight and start a new session with the next segment,
+   * for when the queues on both sides have been cleared
+   */
+  public reset = () => {
+    this.inFlight.clear()
+    this.base = this.nextSequence
+    this.window = RELIABLE_WINDOW
+    this.start = true
+  }
+
+  private retransmitExpired = () => {
+    const now = Date.now()
+
+    this.inFlight.forEach(entry => {
+      if (now - entry.sentAt > RETRANSMIT_TIMEOUT_MS) {
+        this.write(entry.segment)
+      }
+    })
+  }
+
+  private write = (segment: ReliableSegment) => {
+    this.inFlight.set(segment.sequence, { segment, sentAt: Date.now() })
+
+    if (this.deviceManager) {
+      this.segmentWriter(this.deviceManager, segment).catch(() => {
+        // left in flight, the retransmit timer picks it up
+      })
+    }
+  }
+}
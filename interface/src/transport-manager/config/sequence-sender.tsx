@@ -6,6 +6,8 @@ import {
 } from '@electricui/core'
 
 import { DeviceManagerProxyPlugin } from '@electricui/components-core'
+import { ReliableSegmentWriter, ReliableSender } from './reliable-sender'
+import { ReliableAck, ReliableChannel } from './codecs'
 
 export type QueueDepthRequester = (deviceManager: DeviceManager) => Promise<any>
 
@@ -59,6 +61,14 @@ export interface SequenceSenderPluginOptions {
    * Provide a name for the sequence sender
    */
   name?: string
+
+  /**
+   * Allows uploading through the firmware's reliable transport, see setReliable
+   */
+  reliable?: {
+    channel: ReliableChannel
+    segmentWriter: ReliableSegmentWriter
+  }
 }
 
 export type SubscribeCallback = (depth: number) => void
@@ -73,6 +83,8 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
   queueDepthChangeCallback: QueueDepthChangeCallback
   paused: boolean = true
   name: string
+  reliable: ReliableSender | null = null
+  reliableEnabled: boolean = false
 
   subscribers: Map<SubscribeCallback, boolean> = new Map()
 
@@ -89,10 +101,24 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
 
     this.name = options.name || '?'
 
+    if (options.reliable) {
+      this.reliable = new ReliableSender(
+        options.reliable.channel,
+        options.reliable.segmentWriter,
+      )
+    }
+
     this.debug = require('debug')(`electricui-sequence-sender-${this.name}`)
   }
 
   onMessage = (device: Device, message: Message) => {
+    if (this.reliable && message.messageID === 'rack') {
+      if (this.reliable.onAck(message.payload as ReliableAck)) {
+        this.writeSomethingIfWeCan()
+      }
+      return
+    }
+
     if (this.incomingQueueDepthMessageFilter(this.deviceManager!, message)) {
       const currentQueueDepth = this.incomingQueueDepthMessageTransform(
         this.deviceManager!,
@@ -107,10 +133,18 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
 
   setupProxyHandlers() {
     this.deviceManager!.on(MANAGER_EVENTS.DATA, this.onMessage)
+
+    if (this.reliable) {
+      this.reliable.attach(this.deviceManager!)
+    }
   }
 
   teardownProxyHandlers() {
     this.deviceManager!.removeListener(MANAGER_EVENTS.DATA, this.onMessage)
+
+    if (this.reliable) {
+      this.reliable.detach()
+    }
   }
 
   /**
@@ -128,6 +162,16 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
    * Checks if we can write anything
    */
   private writeSomethingIfWeCan = async () => {
+    // The transport's window does the flow control, the hardware holds back
+    // acknowledgements while its queue is nearly full
+    if (this.reliable && this.reliableEnabled) {
+      while (this.queue.length > 0 && !this.paused && this.reliable.canSend()) {
+        this.reliable.send(this.queue.shift())
+        this.setQueueRemaining(this.queue.length)
+      }
+      return
+    }
+
     // If we have allowable queue depth and there's something in the queue, write it
     if (
       this.currentQueueDepth < this.maxQueueDepth &&
@@ -191,6 +235,17 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
     }
   }
 
+  /**
+   * Upload through the reliable transport instead of acknowledged messages,
+   * only when the sender was created with the reliable option
+   */
+  public setReliable = (enabled: boolean) => {
+    if (this.reliable) {
+      this.reliableEnabled = enabled
+      this.reliable.reset()
+    }
+  }
+
   /**
    * Clear the queue
    */
@@ -199,6 +254,10 @@ export class SequenceSenderPlugin extends DeviceManagerProxyPlugin {
 
     this.queue = []
 
+    if (this.reliable) {
+      this.reliable.reset()
+    }
+
     // Tell the UI the queue has been cleared
     this.setQueueRemaining(this.queue.length)
   }
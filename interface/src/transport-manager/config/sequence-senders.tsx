@@ -6,12 +6,23 @@ import {
 } from '@electricui/core'
 
 import { DeviceManagerProxyPlugin } from '@electricui/components-core'
+import { ReliableChannel, ReliableSegment } from './codecs'
 import { SequenceSenderPlugin } from './sequence-sender'
 import { getDelta } from './actions/utils'
 
 export const movementQueueSequencer = new SequenceSenderPlugin({
   maxQueueDepth: 75,
   name: 'mv',
+  reliable: {
+    channel: ReliableChannel.MOVEMENT,
+    segmentWriter: async (
+      deviceManager: DeviceManager,
+      segment: ReliableSegment,
+    ) => {
+      // acknowledged by the transport itself rather than per message
+      return getDelta(deviceManager).write(new Message('rseg', segment))
+    },
+  },
   deviceManagerChunkWriter: async (
     deviceManager: DeviceManager,
     chunk: any,
@@ -56,6 +67,15 @@ export const movementQueueSequencer = new SequenceSenderPlugin({
 export const lightQueueSequencer = new SequenceSenderPlugin({
   maxQueueDepth: 125,
   name: 'li',
+  reliable: {
+    channel: ReliableChannel.LIGHTING,
+    segmentWriter: async (
+      deviceManager: DeviceManager,
+      segment: ReliableSegment,
+    ) => {
+      return getDelta(deviceManager).write(new Message('rseg', segment))
+    },
+  },
   deviceManagerChunkWriter: async (
     deviceManager: DeviceManager,
     chunk: any,
@@ -66,9 +66,10 @@ const serialTransportFactory = new TransportFactory(options => {
 
   // If you have runtime generated messageIDs, add them as an array as a second argument
   // `name` is added because it is requested by the metadata requester before handshake.
+  // `rack` is the reliable transport's acknowledgement, which isn't a tracked variable.
   const undefinedMessageIDGuard = new UndefinedMessageIDGuardPipeline(
     typeCache,
-    ['name'],
+    ['name', 'rack'],
   )
 
   const codecPipeline = new CodecDuplexPipeline()